@@ -0,0 +1,394 @@
+#include "bench.hpp"
+#include "util/allocation.hpp"
+#include "util/log.hpp"
+#include "util/threads.hpp"
+#include "util/trace.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Headless CPU benchmark suite
+//
+// Usage: mango_bench [--filter TEXT] [--repetitions N] [--warmup N]
+//                    [--minimum-time MS] [--pin CPU] [--json PATH]
+//
+// Runs every benchmark whose name contains TEXT. Micro benchmarks are first
+// calibrated to the number of iterations that takes at least MS milliseconds
+// (10 by default), macro benchmarks are run once and always run a single
+// iteration. Each one is then run --warmup times (2) without being measured
+// and --repetitions times (10) measured, the median is what should be
+// compared between runs.
+//
+// --pin keeps the benchmarking thread on a single logical cpu, the thread
+// pool's workers are pinned by MANGO_PINNING as usual. None of the window or
+// vulkan code is built, so this runs on machines without a gpu. --json writes
+// every measurement to PATH for comparing runs with a script.
+
+namespace
+{
+    struct Arguments
+    {
+        std::string_view                     filter;
+        std::size_t                          repetitions {10};
+        std::size_t                          warmup {2};
+        std::chrono::milliseconds            minimum_time {10};
+        std::optional<std::size_t>           pinned_cpu;
+        std::optional<std::filesystem::path> json;
+    };
+
+    std::size_t parseInteger(std::string_view string)
+    {
+        std::size_t output {0};
+
+        const auto [end, error] = std::from_chars(
+            string.data(), string.data() + string.size(), output);
+
+        util::assertFatal(
+            error == std::errc {} && end == string.data() + string.size(),
+            "Failed to parse an integer from {}",
+            string);
+
+        return output;
+    }
+
+    Arguments parseArguments(std::span<const char* const> arguments)
+    {
+        Arguments output {};
+
+        for (std::size_t i = 1; i < arguments.size(); ++i)
+        {
+            const std::string_view argument {arguments[i]};
+
+            util::assertFatal(
+                i + 1 < arguments.size(), "{} requires a value", argument);
+
+            const std::string_view value {arguments[++i]};
+
+            if (argument == "--filter")
+            {
+                output.filter = value;
+            }
+            else if (argument == "--repetitions")
+            {
+                output.repetitions = parseInteger(value);
+            }
+            else if (argument == "--warmup")
+            {
+                output.warmup = parseInteger(value);
+            }
+            else if (argument == "--minimum-time")
+            {
+                output.minimum_time = std::chrono::milliseconds {
+                    static_cast<std::chrono::milliseconds::rep>(
+                        parseInteger(value))};
+            }
+            else if (argument == "--pin")
+            {
+                output.pinned_cpu = parseInteger(value);
+            }
+            else if (argument == "--json")
+            {
+                output.json = value;
+            }
+            else
+            {
+                util::panic("Unknown argument {}", argument);
+            }
+        }
+
+        util::assertFatal(
+            output.repetitions > 0, "At least one repetition is required");
+
+        return output;
+    }
+
+    struct Result
+    {
+        const bench::Benchmark* benchmark;
+        std::size_t             iterations;
+        /// Nanoseconds per iteration of every measured repetition, sorted
+        std::vector<double>     samples;
+        double                  mean;
+        double                  standard_deviation;
+
+        [[nodiscard]] double getMedian() const
+        {
+            const std::size_t middle = this->samples.size() / 2;
+
+            return this->samples.size() % 2 == 1
+                     ? this->samples[middle]
+                     : (this->samples[middle - 1] + this->samples[middle]) / 2;
+        }
+
+        [[nodiscard]] double getItemsPerSecond() const
+        {
+            return static_cast<double>(this->benchmark->items_per_iteration)
+                 * 1e9 / this->getMedian();
+        }
+    };
+
+    std::chrono::nanoseconds
+    runOnce(const bench::Benchmark& benchmark, std::size_t iterations)
+    {
+        const std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+
+        benchmark.function(iterations);
+
+        return std::chrono::steady_clock::now() - start;
+    }
+
+    /// The number of iterations a single repetition of a micro benchmark
+    /// needs to take at least minimumTime
+    std::size_t calibrate(
+        const bench::Benchmark& benchmark, std::chrono::nanoseconds minimumTime)
+    {
+        constexpr std::size_t MaximumIterations {std::size_t {1} << 32};
+
+        std::size_t iterations {1};
+
+        while (iterations < MaximumIterations)
+        {
+            const std::chrono::nanoseconds time =
+                runOnce(benchmark, iterations);
+
+            if (time >= minimumTime)
+            {
+                break;
+            }
+
+            // Overshoot a little so that this rarely takes another round, but
+            // never grow by more than 10x off of a measurement that's mostly
+            // timer overhead
+            const double scale =
+                time.count() > 0
+                    ? 1.2 * static_cast<double>(minimumTime.count())
+                          / static_cast<double>(time.count())
+                    : 10.0;
+
+            iterations = std::min(
+                MaximumIterations,
+                std::max(
+                    iterations + 1,
+                    static_cast<std::size_t>(
+                        static_cast<double>(iterations)
+                        * std::clamp(scale, 1.0, 10.0))));
+        }
+
+        return iterations;
+    }
+
+    Result
+    measure(const bench::Benchmark& benchmark, const Arguments& arguments)
+    {
+        std::size_t iterations {1};
+
+        if (benchmark.kind == bench::Kind::Micro)
+        {
+            iterations = calibrate(benchmark, arguments.minimum_time);
+        }
+        else
+        {
+            static_cast<void>(runOnce(benchmark, iterations));
+        }
+
+        for (std::size_t i = 0; i < arguments.warmup; ++i)
+        {
+            static_cast<void>(runOnce(benchmark, iterations));
+        }
+
+        Result output {
+            .benchmark {&benchmark},
+            .iterations {iterations},
+            .samples {},
+            .mean {0.0},
+            .standard_deviation {0.0}};
+
+        output.samples.reserve(arguments.repetitions);
+
+        for (std::size_t i = 0; i < arguments.repetitions; ++i)
+        {
+            output.samples.push_back(
+                static_cast<double>(runOnce(benchmark, iterations).count())
+                / static_cast<double>(iterations));
+        }
+
+        std::ranges::sort(output.samples);
+
+        output.mean =
+            std::accumulate(output.samples.begin(), output.samples.end(), 0.0)
+            / static_cast<double>(output.samples.size());
+
+        double squaredDeviations {0.0};
+
+        for (double s : output.samples)
+        {
+            squaredDeviations += (s - output.mean) * (s - output.mean);
+        }
+
+        output.standard_deviation = std::sqrt(
+            squaredDeviations / static_cast<double>(output.samples.size()));
+
+        return output;
+    }
+
+    std::string_view getKindName(bench::Kind kind)
+    {
+        switch (kind)
+        {
+        case bench::Kind::Micro:
+            return "micro";
+        case bench::Kind::Macro:
+            return "macro";
+        }
+
+        util::unreachable();
+    }
+
+    /// Benchmark names are plain identifiers, so nothing is escaped
+    void writeJson(
+        const std::filesystem::path& path,
+        const Arguments&             arguments,
+        std::span<const Result>      results)
+    {
+        std::string output = fmt::format(
+            "{{\n  \"context\": {{\n"
+            "    \"hardware_threads\": {},\n"
+            "    \"workers\": {},\n"
+            "    \"pinned_cpu\": {},\n"
+            "    \"repetitions\": {},\n"
+            "    \"warmup\": {},\n"
+            "    \"minimum_time_ms\": {},\n"
+            "    \"tracing\": {},\n"
+            "    \"allocation_hooks\": {}\n"
+            "  }},\n  \"benchmarks\": [",
+            std::thread::hardware_concurrency(),
+            util::getThreadPool().getNumberOfWorkers(),
+            arguments.pinned_cpu.has_value()
+                ? std::to_string(*arguments.pinned_cpu)
+                : std::string {"null"},
+            arguments.repetitions,
+            arguments.warmup,
+            arguments.minimum_time.count(),
+            MANGO_TRACING != 0,
+            util::AllocationHooksEnabled);
+
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& r = results[i];
+
+            fmt::format_to(
+                std::back_inserter(output),
+                "{}\n    {{\"name\": \"{}\", \"kind\": \"{}\", "
+                "\"iterations\": {}, \"items_per_iteration\": {},\n"
+                "     \"median_ns\": {:.3f}, \"mean_ns\": {:.3f}, "
+                "\"min_ns\": {:.3f}, \"max_ns\": {:.3f}, "
+                "\"stddev_ns\": {:.3f}, \"items_per_second\": {:.1f},\n"
+                "     \"samples_ns\": [",
+                i == 0 ? "" : ",",
+                r.benchmark->name,
+                getKindName(r.benchmark->kind),
+                r.iterations,
+                r.benchmark->items_per_iteration,
+                r.getMedian(),
+                r.mean,
+                r.samples.front(),
+                r.samples.back(),
+                r.standard_deviation,
+                r.getItemsPerSecond());
+
+            for (std::size_t j = 0; j < r.samples.size(); ++j)
+            {
+                fmt::format_to(
+                    std::back_inserter(output),
+                    "{}{:.3f}",
+                    j == 0 ? "" : ", ",
+                    r.samples[j]);
+            }
+
+            output += "]}";
+        }
+
+        output += "\n  ]\n}\n";
+
+        std::ofstream file {path, std::ios::binary};
+
+        if (!file)
+        {
+            util::logWarn("Failed to open {} for the results", path.string());
+
+            return;
+        }
+
+        file.write(output.data(), static_cast<std::streamsize>(output.size()));
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const Arguments arguments =
+        parseArguments({argv, static_cast<std::size_t>(argc)});
+
+    if (arguments.pinned_cpu.has_value())
+    {
+        const std::array<std::size_t, 1> cpus {*arguments.pinned_cpu};
+
+        if (!util::pinCurrentThread(cpus))
+        {
+            util::logWarn(
+                "Failed to pin to cpu {}, results will be noisier",
+                *arguments.pinned_cpu);
+        }
+    }
+
+    bench::Suite suite {};
+
+    bench::addUtilBenchmarks(suite);
+    bench::addWorldBenchmarks(suite);
+
+    std::vector<Result> results {};
+
+    for (const bench::Benchmark& b : suite.getBenchmarks())
+    {
+        if (!b.name.contains(arguments.filter))
+        {
+            continue;
+        }
+
+        const Result& r = results.emplace_back(measure(b, arguments));
+
+        util::logLog(
+            "{:<28} | {:>10} iterations | median {:>14.1f} ns | min {:>14.1f} "
+            "ns | stddev {:5.1f}% | {:.4g} items/s",
+            b.name,
+            r.iterations,
+            r.getMedian(),
+            r.samples.front(),
+            100.0 * r.standard_deviation / r.mean,
+            r.getItemsPerSecond());
+    }
+
+    util::assertFatal(
+        !results.empty(), "No benchmark matches --filter {}", arguments.filter);
+
+    if (arguments.json.has_value())
+    {
+        writeJson(*arguments.json, arguments, results);
+    }
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+#ifndef SRC_BENCH_BENCH_HPP
+#define SRC_BENCH_BENCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Harness of mango_bench, see bench.cpp for how benchmarks are run
+
+namespace bench
+{
+    enum class Kind : std::uint8_t
+    {
+        /// A single operation, run as many times as it takes to fill the
+        /// minimum time of a repetition
+        Micro,
+        /// A whole workload, run exactly once per repetition
+        Macro,
+    };
+
+    /// Runs whatever is being measured iterations times in a row
+    ///
+    /// The first call is never measured, so setup that's too expensive to
+    /// repeat every repetition can be done lazily by it.
+    using Function = std::function<void(std::size_t iterations)>;
+
+    struct Benchmark
+    {
+        std::string_view name;
+        Kind             kind;
+        /// Processed by each iteration, used for the items per second
+        std::size_t      items_per_iteration;
+        Function         function;
+    };
+
+    class Suite
+    {
+    public:
+        Suite()  = default;
+        ~Suite() = default;
+
+        Suite(const Suite&)             = delete;
+        Suite(Suite&&)                  = delete;
+        Suite& operator= (const Suite&) = delete;
+        Suite& operator= (Suite&&)      = delete;
+
+        /// Name has to have static storage duration
+        void add(
+            std::string_view name,
+            Kind             kind,
+            std::size_t      itemsPerIteration,
+            Function         function)
+        {
+            this->benchmarks.push_back(Benchmark {
+                .name {name},
+                .kind {kind},
+                .items_per_iteration {itemsPerIteration},
+                .function {std::move(function)}});
+        }
+
+        [[nodiscard]] std::span<const Benchmark> getBenchmarks() const
+        {
+            return this->benchmarks;
+        }
+
+    private:
+        std::vector<Benchmark> benchmarks;
+    };
+
+    /// Keeps the optimizer from removing the computation of value, or from
+    /// assuming anything about it afterwards when it isn't a temporary
+    template<class T>
+    inline void doNotOptimize(const T& value)
+    {
+        asm volatile("" : : "r"(&value) : "memory");
+    }
+
+    /// util::Vector, util::Matrix, noise, crc64, UUID, the thread pool and the
+    /// logger, see util_bench.cpp
+    void addUtilBenchmarks(Suite&);
+
+    /// VoxelVolume, VoxelOctree, meshing and world generation, see
+    /// world_bench.cpp
+    void addWorldBenchmarks(Suite&);
+} // namespace bench
+
+#endif // SRC_BENCH_BENCH_HPP
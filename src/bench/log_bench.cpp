@@ -0,0 +1,244 @@
+#include "util/log.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#include <fmt/chrono.h>
+#pragma clang diagnostic pop
+
+// Log line formatting microbenchmark
+//
+// Usage: mango_log_bench [--lines N] [--repetitions N]
+//
+// Formats the same lines the way the logger thread does and the way every
+// line used to be formatted, with the local time and source location
+// formatted from scratch each time, and reports the average time per line.
+
+namespace
+{
+    struct Arguments
+    {
+        std::size_t lines {100000};
+        std::size_t repetitions {5};
+    };
+
+    Arguments parseArguments(std::span<const char* const> arguments)
+    {
+        Arguments output {};
+
+        for (std::size_t i = 1; i < arguments.size(); ++i)
+        {
+            const std::string_view argument {arguments[i]};
+
+            util::assertFatal(
+                i + 1 < arguments.size(), "{} requires a value", argument);
+
+            const std::string_view value {arguments[++i]};
+
+            std::size_t parsed {0};
+
+            const auto [end, error] = std::from_chars(
+                value.data(), value.data() + value.size(), parsed);
+
+            util::assertFatal(
+                error == std::errc {} && end == value.data() + value.size()
+                    && parsed > 0,
+                "Failed to parse a positive integer from {}",
+                value);
+
+            if (argument == "--lines")
+            {
+                output.lines = parsed;
+            }
+            else if (argument == "--repetitions")
+            {
+                output.repetitions = parsed;
+            }
+            else
+            {
+                util::panic("Unknown argument {}", argument);
+            }
+        }
+
+        return output;
+    }
+
+    /// Runs pattern once to warm up and then repetitions more times, returns
+    /// the fastest of the measured runs
+    template<class F>
+    std::chrono::nanoseconds measure(std::size_t repetitions, F pattern)
+    {
+        pattern();
+
+        std::chrono::nanoseconds best {std::chrono::nanoseconds::max()};
+
+        for (std::size_t i = 0; i < repetitions; ++i)
+        {
+            const auto start = std::chrono::steady_clock::now();
+
+            pattern();
+
+            best = std::min<std::chrono::nanoseconds>(
+                best, std::chrono::steady_clock::now() - start);
+        }
+
+        return best;
+    }
+
+    /// How each line was formatted before util::detail::LineFormatter
+    std::string formatLineUncached(
+        std::int64_t     timestamp,
+        std::string_view file,
+        std::size_t      line,
+        util::Level      level,
+        std::string_view message)
+    {
+        const std::chrono::system_clock::time_point time {
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds {timestamp})};
+
+        std::string workingString = fmt::format(
+            "{:0%b %m/%d/%Y %I:%M}:{:%S}",
+            fmt::localtime(std::chrono::system_clock::to_time_t(time)),
+            time);
+
+        workingString.erase(std::min<std::size_t>(30, workingString.size()));
+
+        workingString.at(workingString.size() - 7) = ':';
+        workingString.insert(workingString.size() - 3, ":");
+
+        return fmt::format(
+            "[{0}] [{1}:{2}] [{3}] {4}\n",
+            workingString,
+            util::detail::trimSourcePath(file),
+            line,
+            util::detail::getLevelName(level),
+            message);
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const Arguments arguments =
+        parseArguments({argv, static_cast<std::size_t>(argc)});
+
+    constexpr std::string_view Format {"Generated chunk {} in {:.3f}ms | {}"};
+    constexpr std::int64_t     LineInterval {1000};
+
+    const std::size_t      chunk {1234};
+    const double           milliseconds {5.678};
+    const std::string_view stage {"Density"};
+    const std::int64_t     start = util::detail::getTimestamp();
+
+    // The same arguments a deferred log call would have recorded
+    std::array<std::byte, 64> encoded {};
+    std::byte*                encodedEnd = encoded.data();
+
+    encodedEnd = util::detail::encodeArgument(encodedEnd, chunk);
+    encodedEnd = util::detail::encodeArgument(encodedEnd, milliseconds);
+    encodedEnd = util::detail::encodeArgument(encodedEnd, stage);
+
+    const std::span<const std::byte> encodedArguments {
+        encoded.data(), encodedEnd};
+
+    std::size_t totalSize {0};
+
+    util::detail::LineFormatter formatter {};
+    std::string                 output {};
+
+    // Without the message only the prefix is measured, formatting the
+    // message itself costs about the same either way
+    const auto formatUncached = [&](bool withMessage)
+    {
+        return measure(
+            arguments.repetitions,
+            [&]
+            {
+                for (std::size_t i = 0; i < arguments.lines; ++i)
+                {
+                    const std::string line = formatLineUncached(
+                        start + static_cast<std::int64_t>(i) * LineInterval,
+                        __FILE__,
+                        __LINE__,
+                        util::Level::Log,
+                        withMessage ? fmt::vformat(
+                            Format,
+                            fmt::make_format_args(chunk, milliseconds, stage))
+                                    : std::string {});
+
+                    totalSize += line.size();
+                }
+            });
+    };
+
+    const auto formatCached = [&](bool withMessage)
+    {
+        return measure(
+            arguments.repetitions,
+            [&]
+            {
+                for (std::size_t i = 0; i < arguments.lines; ++i)
+                {
+                    formatter.appendPrefix(
+                        output,
+                        start + static_cast<std::int64_t>(i) * LineInterval,
+                        util::detail::trimSourcePath(__FILE__),
+                        __LINE__,
+                        util::Level::Log);
+
+                    if (withMessage)
+                    {
+                        util::detail::appendArguments(
+                            output, Format, encodedArguments, 3);
+                    }
+
+                    output.push_back('\n');
+
+                    totalSize += output.size();
+                    output.clear();
+                }
+            });
+    };
+
+    const auto perLine = [&](std::chrono::nanoseconds time)
+    {
+        return static_cast<double>(time.count())
+             / static_cast<double>(arguments.lines);
+    };
+
+    const auto report = [&](std::string_view name,
+                             std::chrono::nanoseconds uncached,
+                             std::chrono::nanoseconds cached)
+    {
+        util::logLog(
+            "{:<6} | uncached {:8.1f} ns/line | cached {:8.1f} ns/line | "
+            "{:.1f}x faster",
+            name,
+            perLine(uncached),
+            perLine(cached),
+            perLine(uncached) / perLine(cached));
+    };
+
+    const std::chrono::nanoseconds uncachedPrefix = formatUncached(false);
+    const std::chrono::nanoseconds cachedPrefix   = formatCached(false);
+    const std::chrono::nanoseconds uncachedLine   = formatUncached(true);
+    const std::chrono::nanoseconds cachedLine     = formatCached(true);
+
+    util::logLog(
+        "Lines: {} | Repetitions: {} | Characters: {}",
+        arguments.lines,
+        arguments.repetitions,
+        totalSize);
+    report("Prefix", uncachedPrefix, cachedPrefix);
+    report("Line", uncachedLine, cachedLine);
+
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include "util/allocation.hpp"
+#include "util/log.hpp"
+#include "util/threads.hpp"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Thread pool task submission microbenchmark
+//
+// Usage: mango_task_bench [--tasks N] [--repetitions N]
+//
+// Reports the average time per task and the number of heap allocations per
+// task for a few submission patterns. Every pattern is warmed up once before
+// it's measured so that the pools and queues have already grown, after that
+// the allocation count is expected to be zero. Allocations are counted by
+// util/allocation.hpp's hooks, which are always built into this benchmark.
+
+namespace
+{
+    struct Arguments
+    {
+        std::size_t tasks {100000};
+        std::size_t repetitions {5};
+    };
+
+    Arguments parseArguments(std::span<const char* const> arguments)
+    {
+        Arguments output {};
+
+        for (std::size_t i = 1; i < arguments.size(); ++i)
+        {
+            const std::string_view argument {arguments[i]};
+
+            util::assertFatal(
+                i + 1 < arguments.size(), "{} requires a value", argument);
+
+            const std::string_view value {arguments[++i]};
+
+            std::size_t parsed {0};
+
+            const auto [end, error] = std::from_chars(
+                value.data(), value.data() + value.size(), parsed);
+
+            util::assertFatal(
+                error == std::errc {} && end == value.data() + value.size()
+                    && parsed > 0,
+                "Failed to parse a positive integer from {}",
+                value);
+
+            if (argument == "--tasks")
+            {
+                output.tasks = parsed;
+            }
+            else if (argument == "--repetitions")
+            {
+                output.repetitions = parsed;
+            }
+            else
+            {
+                util::panic("Unknown argument {}", argument);
+            }
+        }
+
+        return output;
+    }
+
+    struct Measurement
+    {
+        std::chrono::nanoseconds time;
+        std::uint64_t            allocations;
+    };
+
+    /// Runs pattern once to warm up and then repetitions more times, returns
+    /// the fastest of the measured runs
+    template<class F>
+    Measurement measure(std::size_t repetitions, F pattern)
+    {
+        pattern();
+
+        Measurement best {std::chrono::nanoseconds::max(), 0};
+
+        for (std::size_t i = 0; i < repetitions; ++i)
+        {
+            const std::uint64_t allocationsBefore =
+                util::getAllocationCounts().allocations;
+            const auto start = std::chrono::steady_clock::now();
+
+            pattern();
+
+            const auto          end = std::chrono::steady_clock::now();
+            const std::uint64_t allocations =
+                util::getAllocationCounts().allocations - allocationsBefore;
+
+            if (end - start < best.time)
+            {
+                best = Measurement {
+                    .time {end - start}, .allocations {allocations}};
+            }
+        }
+
+        return best;
+    }
+
+    /// Blocks until count reaches zero
+    void waitForZero(const std::atomic<std::size_t>& count)
+    {
+        std::size_t current = count.load();
+
+        while (current != 0)
+        {
+            count.wait(current);
+
+            current = count.load();
+        }
+    }
+
+    void countDown(std::atomic<std::size_t>& count)
+    {
+        if (count.fetch_sub(1) == 1)
+        {
+            count.notify_all();
+        }
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const Arguments arguments =
+        parseArguments({argv, static_cast<std::size_t>(argc)});
+
+    const std::size_t tasks = arguments.tasks;
+
+    // Allocated up front so that the measured loops don't grow it
+    std::vector<util::Future<std::size_t>> futures {};
+    futures.reserve(tasks);
+
+    // Submit a batch of tasks from outside the pool and await all of them
+    const Measurement batch = measure(
+        arguments.repetitions,
+        [&]
+        {
+            for (std::size_t i = 0; i < tasks; ++i)
+            {
+                futures.push_back(util::runAsynchronously<std::size_t>(
+                    [i]
+                    {
+                        return i;
+                    }));
+            }
+
+            std::size_t sum {0};
+
+            for (util::Future<std::size_t>& f : futures)
+            {
+                sum += f.await();
+            }
+
+            futures.clear();
+
+            util::assertFatal(
+                sum == tasks * (tasks - 1) / 2, "Bad sum {}", sum);
+        });
+
+    // Submit and await a single task at a time, mostly measures the wake up
+    const std::size_t roundTrips = std::max<std::size_t>(1, tasks / 100);
+
+    const Measurement roundTrip = measure(
+        arguments.repetitions,
+        [&]
+        {
+            for (std::size_t i = 0; i < roundTrips; ++i)
+            {
+                util::runAsynchronously<void>([] {}).await();
+            }
+        });
+
+    // Spawn every task from inside of a worker, these go straight onto the
+    // worker's own deque
+    std::atomic<std::size_t> remaining {0};
+
+    const Measurement nested = measure(
+        arguments.repetitions,
+        [&]
+        {
+            remaining.store(tasks);
+
+            util::getThreadPool().addJob(
+                [&]
+                {
+                    for (std::size_t i = 0; i < tasks; ++i)
+                    {
+                        util::getThreadPool().addJob(
+                            [&]
+                            {
+                                countDown(remaining);
+                            });
+                    }
+                });
+
+            waitForZero(remaining);
+        });
+
+    const auto report =
+        [](std::string_view name, const Measurement& m, std::size_t count)
+    {
+        util::logLog(
+            "{:<12} | {:>8.1f} ns/task | {:.3f} allocations/task",
+            name,
+            static_cast<double>(m.time.count()) / static_cast<double>(count),
+            static_cast<double>(m.allocations) / static_cast<double>(count));
+    };
+
+    util::logLog(
+        "Workers: {} | Tasks: {} | Repetitions: {}",
+        util::getThreadPool().getNumberOfWorkers(),
+        tasks,
+        arguments.repetitions);
+
+    report("Batch", batch, tasks);
+    report("Round trip", roundTrip, roundTrips);
+    report("Nested", nested, tasks);
+
+    return batch.allocations + roundTrip.allocations + nested.allocations == 0
+             ? 0
+             : 1;
+}
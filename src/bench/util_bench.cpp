@@ -0,0 +1,381 @@
+#include "bench.hpp"
+#include "util/log.hpp"
+#include "util/matrix.hpp"
+#include "util/misc.hpp"
+#include "util/noise.hpp"
+#include "util/parallel.hpp"
+#include "util/threads.hpp"
+#include "util/uuid.hpp"
+#include "util/vector.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    void addMathBenchmarks(bench::Suite& suite)
+    {
+        suite.add(
+            "Vector.Normalize",
+            bench::Kind::Micro,
+            1,
+            [](std::size_t iterations)
+            {
+                util::Vec3 vector {1.0f, 2.0f, 3.0f};
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    bench::doNotOptimize(vector);
+                    bench::doNotOptimize(vector.normalize());
+                }
+            });
+
+        suite.add(
+            "Vector.Cross",
+            bench::Kind::Micro,
+            1,
+            [](std::size_t iterations)
+            {
+                util::Vec3 l {1.0f, 2.0f, 3.0f};
+                util::Vec3 r {-4.0f, 5.0f, 0.5f};
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    bench::doNotOptimize(l);
+                    bench::doNotOptimize(r);
+                    bench::doNotOptimize(l.cross(r));
+                }
+            });
+
+        suite.add(
+            "Matrix.Multiply4x4",
+            bench::Kind::Micro,
+            1,
+            [](std::size_t iterations)
+            {
+                util::Matrix<float, 4, 4> l {
+                    util::Vec4 {1.0f, 2.0f, 3.0f, 4.0f},
+                    util::Vec4 {5.0f, 6.0f, 7.0f, 8.0f},
+                    util::Vec4 {9.0f, 1.0f, 2.0f, 3.0f},
+                    util::Vec4 {4.0f, 5.0f, 6.0f, 7.0f}};
+                util::Matrix<float, 4, 4> r {l.transpose()};
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    bench::doNotOptimize(l);
+                    bench::doNotOptimize(r);
+                    bench::doNotOptimize(l * r);
+                }
+            });
+
+        suite.add(
+            "Matrix.Inverse4x4",
+            bench::Kind::Micro,
+            1,
+            [](std::size_t iterations)
+            {
+                util::Matrix<float, 4, 4> matrix {
+                    util::Vec4 {2.0f, 0.0f, 1.0f, 0.0f},
+                    util::Vec4 {0.0f, 3.0f, 0.0f, 1.0f},
+                    util::Vec4 {1.0f, 0.0f, 4.0f, 0.0f},
+                    util::Vec4 {0.0f, 1.0f, 0.0f, 5.0f}};
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    bench::doNotOptimize(matrix);
+                    bench::doNotOptimize(matrix.inverse());
+                }
+            });
+    }
+
+    void addNoiseBenchmarks(bench::Suite& suite)
+    {
+        constexpr std::size_t RowLength {32};
+
+        suite.add(
+            "Noise.Perlin3",
+            bench::Kind::Micro,
+            1,
+            [](std::size_t iterations)
+            {
+                util::Vec3 position {0.5f, 12.25f, -3.75f};
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    position.x() += 0.37f;
+
+                    bench::doNotOptimize(util::perlin(position, 1));
+                }
+            });
+
+        suite.add(
+            "Noise.Simplex3",
+            bench::Kind::Micro,
+            1,
+            [](std::size_t iterations)
+            {
+                util::Vec3 position {0.5f, 12.25f, -3.75f};
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    position.x() += 0.37f;
+
+                    bench::doNotOptimize(util::simplex(position, 1));
+                }
+            });
+
+        suite.add(
+            "Noise.SimplexRow3",
+            bench::Kind::Micro,
+            RowLength,
+            [](std::size_t iterations)
+            {
+                std::array<float, RowLength> row {};
+                util::Vec3                   start {0.5f, 12.25f, -3.75f};
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    start.z() += 0.37f;
+
+                    util::simplexRow(start, 1.0f / 64.0f, std::span {row}, 1);
+
+                    bench::doNotOptimize(row);
+                }
+            });
+    }
+
+    void addHashingBenchmarks(bench::Suite& suite)
+    {
+        constexpr std::size_t BufferSize {4096};
+
+        suite.add(
+            "Crc64.Integer",
+            bench::Kind::Micro,
+            1,
+            [](std::size_t iterations)
+            {
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    bench::doNotOptimize(util::crc64(i));
+                }
+            });
+
+        suite.add(
+            "Crc64.4KiB",
+            bench::Kind::Micro,
+            BufferSize,
+            [](std::size_t iterations)
+            {
+                std::vector<std::byte> buffer(BufferSize);
+
+                for (std::size_t i = 0; i < buffer.size(); ++i)
+                {
+                    buffer[i] = static_cast<std::byte>(util::crc64(i));
+                }
+
+                std::uint64_t hash {0};
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    hash = util::crc64(buffer, hash);
+                }
+
+                bench::doNotOptimize(hash);
+            });
+
+        suite.add(
+            "UUID.Create",
+            bench::Kind::Micro,
+            1,
+            [](std::size_t iterations)
+            {
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    bench::doNotOptimize(util::UUID {});
+                }
+            });
+    }
+
+    void addThreadPoolBenchmarks(bench::Suite& suite)
+    {
+        constexpr std::size_t BatchSize {256};
+        constexpr std::size_t ParallelSize {std::size_t {1} << 16};
+
+        // Round trip through a worker and back
+        suite.add(
+            "ThreadPool.RunAwait",
+            bench::Kind::Micro,
+            1,
+            [](std::size_t iterations)
+            {
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    util::runAsynchronously<void>([] {}).await();
+                }
+            });
+
+        suite.add(
+            "ThreadPool.Batch256",
+            bench::Kind::Micro,
+            BatchSize,
+            [](std::size_t iterations)
+            {
+                std::vector<util::Future<void>> futures {};
+                futures.reserve(BatchSize);
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    for (std::size_t j = 0; j < BatchSize; ++j)
+                    {
+                        futures.push_back(util::runAsynchronously<void>([] {}));
+                    }
+
+                    for (util::Future<void>& f : futures)
+                    {
+                        f.await();
+                    }
+
+                    futures.clear();
+                }
+            });
+
+        suite.add(
+            "ThreadPool.ParallelFor64Ki",
+            bench::Kind::Micro,
+            ParallelSize,
+            [](std::size_t iterations)
+            {
+                std::vector<std::uint32_t> data(ParallelSize);
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    util::parallelFor(
+                        std::size_t {0},
+                        data.size(),
+                        [&](std::size_t j)
+                        {
+                            data[j] = data[j] * 3 + 1;
+                        });
+                }
+
+                bench::doNotOptimize(data);
+            });
+
+        suite.add(
+            "ThreadPool.ParallelSort64Ki",
+            bench::Kind::Micro,
+            ParallelSize,
+            [](std::size_t iterations)
+            {
+                std::vector<std::uint64_t> unsorted(ParallelSize);
+                std::vector<std::uint64_t> data(ParallelSize);
+
+                for (std::size_t i = 0; i < unsorted.size(); ++i)
+                {
+                    unsorted[i] = util::crc64(i);
+                }
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    std::ranges::copy(unsorted, data.begin());
+
+                    util::parallelSort(data);
+                }
+
+                bench::doNotOptimize(data);
+            });
+    }
+
+    void addLoggerBenchmarks(bench::Suite& suite)
+    {
+        constexpr std::string_view Format {
+            "Generated chunk {} in {:.3f}ms | {}"};
+
+        // What a call below the runtime log level costs the caller. Debug is
+        // the lowest level release builds keep, a level that's compiled out
+        // would only time an empty loop
+        if constexpr (util::MinimumLogLevel <= util::Level::Debug)
+        {
+            suite.add(
+                "Logger.Filtered",
+                bench::Kind::Micro,
+                1,
+                [](std::size_t iterations)
+                {
+                    // Module levels from MANGO_LOG_LEVEL could let this
+                    // through or change how it's filtered, so they're cleared
+                    // until the benchmark is over
+                    util::LogLevelSnapshot previous = util::saveLogLevels();
+
+                    util::restoreLogLevels(util::LogLevelSnapshot {
+                        .global {util::Level::Log}, .modules {}});
+
+                    for (std::size_t i = 0; i < iterations; ++i)
+                    {
+                        util::logDebug("Filtered {}", i);
+                    }
+
+                    util::restoreLogLevels(std::move(previous));
+                });
+        }
+
+        // What the logger thread does with every line
+        suite.add(
+            "Logger.FormatLine",
+            bench::Kind::Micro,
+            1,
+            [=](std::size_t iterations)
+            {
+                const std::size_t      chunk {1234};
+                const double           milliseconds {5.678};
+                const std::string_view stage {"Density"};
+
+                std::array<std::byte, 64> encoded {};
+                std::byte*                encodedEnd = encoded.data();
+
+                encodedEnd = util::detail::encodeArgument(encodedEnd, chunk);
+                encodedEnd =
+                    util::detail::encodeArgument(encodedEnd, milliseconds);
+                encodedEnd = util::detail::encodeArgument(encodedEnd, stage);
+
+                const std::span<const std::byte> arguments {
+                    encoded.data(), encodedEnd};
+
+                util::detail::LineFormatter formatter {};
+                std::string                 output {};
+
+                const std::int64_t start = util::detail::getTimestamp();
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    formatter.appendPrefix(
+                        output,
+                        start + static_cast<std::int64_t>(i) * 1000,
+                        util::detail::trimSourcePath(__FILE__),
+                        __LINE__,
+                        util::Level::Log);
+                    util::detail::appendArguments(
+                        output, Format, arguments, 3);
+                    output.push_back('\n');
+
+                    bench::doNotOptimize(output);
+                    output.clear();
+                }
+            });
+    }
+} // namespace
+
+void bench::addUtilBenchmarks(Suite& suite)
+{
+    addMathBenchmarks(suite);
+    addNoiseBenchmarks(suite);
+    addHashingBenchmarks(suite);
+    addThreadPoolBenchmarks(suite);
+    addLoggerBenchmarks(suite);
+}
@@ -0,0 +1,282 @@
+#include "bench.hpp"
+#include "game/world/generator.hpp"
+#include "game/world/heightmap.hpp"
+#include "game/world/voxel_octree.hpp"
+#include "util/lock.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace
+{
+    constexpr std::uint64_t Seed {0};
+    /// Chunks along each side of the generated worlds
+    constexpr std::int32_t  WorldSize {4};
+
+    const game::world::Voxel SolidVoxel {glm::vec4 {0.4f, 0.6f, 0.2f, 1.0f}};
+
+    std::vector<game::world::ChunkCoordinate> getWorldChunks()
+    {
+        std::vector<game::world::ChunkCoordinate> output {};
+
+        for (std::int32_t x = -WorldSize / 2; x < WorldSize / 2; ++x)
+        {
+            for (std::int32_t z = -WorldSize / 2; z < WorldSize / 2; ++z)
+            {
+                output.push_back(game::world::ChunkCoordinate {x, z});
+            }
+        }
+
+        return output;
+    }
+
+    /// Runs every default stage over the world, keeping the volumes
+    game::world::VoxelOctree generateWorld()
+    {
+        game::world::HeightmapCache           heightmaps {Seed};
+        util::Mutex<game::world::VoxelOctree> octree {
+            game::world::VoxelOctree {}};
+
+        std::vector<std::unique_ptr<game::world::GenerationStage>> stages =
+            game::world::makeDefaultGenerationStages(heightmaps);
+
+        stages.push_back(
+            std::make_unique<game::world::OctreeInsertionStage>(octree));
+
+        game::world::Generator generator {std::move(stages)};
+
+        generator.generate(getWorldChunks());
+
+        game::world::VoxelOctree output {};
+
+        octree.lock(
+            [&](game::world::VoxelOctree& tree)
+            {
+                output = std::move(tree);
+            });
+
+        return output;
+    }
+
+    /// A volume with a sloped surface, so that meshing has to deal with
+    /// columns of every height
+    std::unique_ptr<game::world::VoxelVolume> makeTerrainVolume()
+    {
+        constexpr std::int32_t Extent {
+            static_cast<std::int32_t>(game::world::VoxelVolume::Extent)};
+
+        std::unique_ptr<game::world::VoxelVolume> output =
+            std::make_unique<game::world::VoxelVolume>(
+                game::world::Position {0, 0, 0});
+
+        for (std::int32_t x = 0; x < Extent; ++x)
+        {
+            for (std::int32_t z = 0; z < Extent; ++z)
+            {
+                output->fillColumnFromGlobalPosition(
+                    game::world::Position {x, 0, z},
+                    (x * 7 + z * 13) % Extent,
+                    SolidVoxel);
+            }
+        }
+
+        return output;
+    }
+
+    void addVolumeBenchmarks(bench::Suite& suite)
+    {
+        constexpr std::size_t Extent {game::world::VoxelVolume::Extent};
+
+        suite.add(
+            "VoxelVolume.FillColumn",
+            bench::Kind::Micro,
+            Extent,
+            [](std::size_t iterations)
+            {
+                std::unique_ptr<game::world::VoxelVolume> volume =
+                    std::make_unique<game::world::VoxelVolume>(
+                        game::world::Position {0, 0, 0});
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    volume->fillColumnFromGlobalPosition(
+                        game::world::Position {
+                            static_cast<std::int32_t>(i % Extent),
+                            0,
+                            static_cast<std::int32_t>(i / Extent % Extent)},
+                        static_cast<std::int32_t>(Extent - 1),
+                        SolidVoxel);
+                }
+
+                bench::doNotOptimize(*volume);
+            });
+
+        suite.add(
+            "VoxelVolume.Hash",
+            bench::Kind::Micro,
+            Extent * Extent * Extent,
+            [](std::size_t iterations)
+            {
+                const std::unique_ptr<game::world::VoxelVolume> volume =
+                    makeTerrainVolume();
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    bench::doNotOptimize(volume->hash());
+                }
+            });
+
+        suite.add(
+            "VoxelVolume.Mesh",
+            bench::Kind::Micro,
+            1,
+            [](std::size_t iterations)
+            {
+                const std::unique_ptr<game::world::VoxelVolume> volume =
+                    makeTerrainVolume();
+
+                util::Mesh mesh {};
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    mesh.vertices.clear();
+                    mesh.indices.clear();
+
+                    volume->drawToMesh(mesh);
+
+                    bench::doNotOptimize(mesh);
+                }
+            });
+    }
+
+    void addOctreeBenchmarks(bench::Suite& suite)
+    {
+        // Spans a few volumes on every axis
+        constexpr std::int32_t Region {64};
+
+        suite.add(
+            "VoxelOctree.Access",
+            bench::Kind::Micro,
+            1,
+            [](std::size_t iterations)
+            {
+                game::world::VoxelOctree octree {};
+
+                for (std::int32_t x = -Region / 2; x < Region / 2; ++x)
+                {
+                    for (std::int32_t z = -Region / 2; z < Region / 2; ++z)
+                    {
+                        octree.fillColumn(
+                            x, z, -Region / 2, Region / 2 - 1, SolidVoxel);
+                    }
+                }
+
+                std::uint64_t position {0};
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    position = util::crc64(position);
+
+                    const auto coordinate = [&](std::size_t shift)
+                    {
+                        return static_cast<std::int32_t>(
+                                   (position >> shift) % Region)
+                             - Region / 2;
+                    };
+
+                    bench::doNotOptimize(octree.access(game::world::Position {
+                        coordinate(0), coordinate(16), coordinate(32)}));
+                }
+            });
+
+        suite.add(
+            "VoxelOctree.FillColumn",
+            bench::Kind::Micro,
+            Region,
+            [](std::size_t iterations)
+            {
+                game::world::VoxelOctree octree {};
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    const std::int32_t column = static_cast<std::int32_t>(
+                        i % static_cast<std::size_t>(Region * Region));
+
+                    octree.fillColumn(
+                        column % Region - Region / 2,
+                        column / Region - Region / 2,
+                        -Region / 2,
+                        Region / 2 - 1,
+                        SolidVoxel);
+                }
+
+                bench::doNotOptimize(octree);
+            });
+
+        suite.add(
+            "Heightmap.Generate",
+            bench::Kind::Micro,
+            1,
+            [](std::size_t iterations)
+            {
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    const game::world::Heightmap heightmap {
+                        game::world::ChunkCoordinate {
+                            static_cast<std::int32_t>(i % 1024),
+                            static_cast<std::int32_t>(i / 1024)},
+                        Seed};
+
+                    bench::doNotOptimize(heightmap);
+                }
+            });
+    }
+
+    void addGenerationBenchmarks(bench::Suite& suite)
+    {
+        constexpr std::size_t Chunks {
+            static_cast<std::size_t>(WorldSize * WorldSize)};
+
+        // Every stage World runs minus the upload, from an empty heightmap
+        // cache each time
+        suite.add(
+            "Worldgen.Generate4x4",
+            bench::Kind::Macro,
+            Chunks,
+            [](std::size_t iterations)
+            {
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    bench::doNotOptimize(generateWorld());
+                }
+            });
+
+        suite.add(
+            "Worldgen.OctreeDraw4x4",
+            bench::Kind::Macro,
+            Chunks,
+            [octree = std::make_shared<
+                 std::optional<game::world::VoxelOctree>>()](
+                std::size_t iterations)
+            {
+                if (!octree->has_value())
+                {
+                    octree->emplace(generateWorld());
+                }
+
+                for (std::size_t i = 0; i < iterations; ++i)
+                {
+                    bench::doNotOptimize((*octree)->draw());
+                }
+            });
+    }
+} // namespace
+
+void bench::addWorldBenchmarks(Suite& suite)
+{
+    addVolumeBenchmarks(suite);
+    addOctreeBenchmarks(suite);
+    addGenerationBenchmarks(suite);
+}
@@ -0,0 +1,359 @@
+#include "game/world/generator.hpp"
+#include "game/world/heightmap.hpp"
+#include "game/world/voxel_octree.hpp"
+#include "util/log.hpp"
+#include "util/misc.hpp"
+#include "util/threads.hpp"
+#include "util/trace.hpp"
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// Headless world generation benchmark
+//
+// Usage: mango_worldgen_bench [--seed N] [--size N] [--expect-octree HASH]
+//                             [--expect-mesh HASH] [--trace PATH]
+//
+// Generates a size by size chunk world around the origin with exactly the
+// same stages as World, minus the upload. Both hashes only depend on the seed
+// and size, so they can be compared against a known good run to check that an
+// optimization didn't change the output, the --expect flags do this and exit
+// with a failure on a mismatch. --trace writes every util::TraceZone hit
+// while generating to PATH.
+
+namespace
+{
+    struct Arguments
+    {
+        std::uint64_t                        seed {0};
+        std::int32_t                         size {16};
+        std::optional<std::uint64_t>         expected_octree_hash;
+        std::optional<std::uint64_t>         expected_mesh_hash;
+        std::optional<std::filesystem::path> trace;
+    };
+
+    template<class I>
+    I parseInteger(std::string_view string, int base)
+    {
+        I output {};
+
+        const auto [end, error] = std::from_chars(
+            string.data(), string.data() + string.size(), output, base);
+
+        util::assertFatal(
+            error == std::errc {} && end == string.data() + string.size(),
+            "Failed to parse integer from {}",
+            string);
+
+        return output;
+    }
+
+    Arguments parseArguments(std::span<const char* const> arguments)
+    {
+        Arguments output {};
+
+        for (std::size_t i = 1; i < arguments.size(); ++i)
+        {
+            const std::string_view argument {arguments[i]};
+
+            util::assertFatal(
+                i + 1 < arguments.size(), "{} requires a value", argument);
+
+            const std::string_view value {arguments[++i]};
+
+            if (argument == "--seed")
+            {
+                output.seed = parseInteger<std::uint64_t>(value, 10);
+            }
+            else if (argument == "--size")
+            {
+                output.size = parseInteger<std::int32_t>(value, 10);
+            }
+            else if (argument == "--expect-octree")
+            {
+                output.expected_octree_hash =
+                    parseInteger<std::uint64_t>(value, 16);
+            }
+            else if (argument == "--expect-mesh")
+            {
+                output.expected_mesh_hash =
+                    parseInteger<std::uint64_t>(value, 16);
+            }
+            else if (argument == "--trace")
+            {
+                output.trace = value;
+            }
+            else
+            {
+                util::panic("Unknown argument {}", argument);
+            }
+        }
+
+        constexpr std::int32_t MaximumSize {
+            static_cast<std::int32_t>(game::world::VoxelOctree::VolumeExtent)
+            / game::world::Heightmap::Extent};
+
+        util::assertFatal(
+            output.size > 0 && output.size <= MaximumSize,
+            "Size must be in [1, {}] | Received {}",
+            MaximumSize,
+            output.size);
+
+        return output;
+    }
+
+    struct ChunkResult
+    {
+        std::uint64_t mesh_hash;
+        std::size_t   voxels;
+        std::size_t   triangles;
+    };
+
+    /// Records what every chunk produced so that the results can be combined
+    /// in a deterministic order once generation is finished
+    class ResultStage final : public game::world::GenerationStage
+    {
+    public:
+        ResultStage()
+            : results {std::map<std::pair<std::int32_t, std::int32_t>,
+                                ChunkResult> {}}
+        {}
+
+        [[nodiscard]] std::string_view getName() const override
+        {
+            return "Result";
+        }
+
+        void process(game::world::Chunk& chunk) override
+        {
+            const std::uint64_t vertexHash =
+                util::crc64(std::as_bytes(std::span {chunk.mesh.vertices}));
+
+            ChunkResult result {
+                .mesh_hash {util::crc64(
+                    std::as_bytes(std::span {chunk.mesh.indices}), vertexHash)},
+                .voxels {0},
+                .triangles {chunk.mesh.indices.size() / 3},
+            };
+
+            for (game::world::ColumnSpan span : chunk.columns)
+            {
+                result.voxels +=
+                    static_cast<std::size_t>(span.top - span.bottom + 1);
+            }
+
+            this->results.lock(
+                [&](std::map<std::pair<std::int32_t, std::int32_t>,
+                             ChunkResult>& r)
+                {
+                    r[{chunk.coordinate.x, chunk.coordinate.z}] = result;
+                });
+        }
+
+        [[nodiscard]] std::map<std::pair<std::int32_t, std::int32_t>,
+                               ChunkResult>
+        takeResults()
+        {
+            std::map<std::pair<std::int32_t, std::int32_t>, ChunkResult>
+                output {};
+
+            this->results.lock(
+                [&](std::map<std::pair<std::int32_t, std::int32_t>,
+                             ChunkResult>& r)
+                {
+                    output = std::move(r);
+                });
+
+            return output;
+        }
+
+    private:
+        util::Mutex<
+            std::map<std::pair<std::int32_t, std::int32_t>, ChunkResult>>
+            results;
+    };
+
+    /// In KiB
+    std::size_t getPeakResidentSetSize()
+    {
+#ifdef _WIN32
+        return 0;
+#else
+        rusage usage {};
+
+        util::assertFatal(
+            getrusage(RUSAGE_SELF, &usage) == 0, "Failed to call getrusage");
+
+#ifdef __APPLE__
+        // bytes on macOS, KiB everywhere else
+        return static_cast<std::size_t>(usage.ru_maxrss) / 1024;
+#else
+        return static_cast<std::size_t>(usage.ru_maxrss);
+#endif // __APPLE__
+#endif // _WIN32
+    }
+
+    double perSecond(std::size_t count, std::chrono::nanoseconds time)
+    {
+        const double seconds = std::chrono::duration<double> {time}.count();
+
+        return seconds > 0.0 ? static_cast<double>(count) / seconds : 0.0;
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const Arguments arguments =
+        parseArguments({argv, static_cast<std::size_t>(argc)});
+
+    std::vector<game::world::ChunkCoordinate> chunks {};
+
+    const std::int32_t chunkMinimum = -(arguments.size / 2);
+
+    for (std::int32_t x = 0; x < arguments.size; ++x)
+    {
+        for (std::int32_t z = 0; z < arguments.size; ++z)
+        {
+            chunks.push_back(game::world::ChunkCoordinate {
+                chunkMinimum + x, chunkMinimum + z});
+        }
+    }
+
+    game::world::HeightmapCache           heightmaps {arguments.seed};
+    util::Mutex<game::world::VoxelOctree> octree {game::world::VoxelOctree {}};
+
+    std::vector<std::unique_ptr<game::world::GenerationStage>> stages =
+        game::world::makeDefaultGenerationStages(heightmaps);
+
+    stages.push_back(
+        std::make_unique<game::world::OctreeInsertionStage>(octree));
+
+    std::unique_ptr<ResultStage> resultStage = std::make_unique<ResultStage>();
+    ResultStage&                 results     = *resultStage;
+
+    stages.push_back(std::move(resultStage));
+
+    game::world::Generator generator {std::move(stages)};
+
+    if (arguments.trace.has_value())
+    {
+        util::startTracing(*arguments.trace);
+    }
+
+    generator.generate(chunks);
+    generator.logStatistics();
+
+    std::uint64_t meshHash {0};
+    std::size_t   voxels {0};
+    std::size_t   triangles {0};
+
+    for (const auto& [coordinate, result] : results.takeResults())
+    {
+        meshHash = util::crc64(
+            std::as_bytes(std::span {&result.mesh_hash, 1}), meshHash);
+        voxels += result.voxels;
+        triangles += result.triangles;
+    }
+
+    std::uint64_t octreeHash {0};
+
+    octree.lock(
+        [&](const game::world::VoxelOctree& tree)
+        {
+            octreeHash = tree.hash();
+        });
+
+    std::chrono::nanoseconds columnTime {0};
+    std::chrono::nanoseconds voxelTime {0};
+    std::chrono::nanoseconds meshingTime {0};
+    std::chrono::nanoseconds hashingTime {0};
+
+    for (const game::world::StageStatistics& s : generator.getStatistics())
+    {
+        if (s.name == "Density" || s.name == "Surface")
+        {
+            columnTime += s.busy_time;
+        }
+        else if (s.name == "Coloring")
+        {
+            voxelTime += s.busy_time;
+        }
+        else if (s.name == "Meshing")
+        {
+            meshingTime += s.busy_time;
+        }
+        else if (s.name == "Result")
+        {
+            hashingTime += s.busy_time;
+        }
+    }
+
+    const std::size_t columns =
+        chunks.size()
+        * static_cast<std::size_t>(
+            game::world::Heightmap::Extent * game::world::Heightmap::Extent);
+
+    util::logLog(
+        "Seed {} | Size {}x{} chunks | Wall time {}ms ({}ms of it hashing)",
+        arguments.seed,
+        arguments.size,
+        arguments.size,
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            generator.getLastWallTime())
+            .count(),
+        std::chrono::duration_cast<std::chrono::milliseconds>(hashingTime)
+            .count());
+    util::logLog(
+        "Columns: {} | {:.0f} columns/s (density + surface)",
+        columns,
+        perSecond(columns, columnTime));
+    util::logLog(
+        "Voxels: {} | {:.0f} voxels/s (coloring)",
+        voxels,
+        perSecond(voxels, voxelTime));
+    util::logLog(
+        "Triangles: {} | {:.0f} triangles/s (meshing)",
+        triangles,
+        perSecond(triangles, meshingTime));
+    util::logLog("Peak RSS: {} KiB", getPeakResidentSetSize());
+    util::logLog("Octree hash: {:016X}", octreeHash);
+    util::logLog("Mesh hash: {:016X}", meshHash);
+
+    bool matched = true;
+
+    if (arguments.expected_octree_hash.has_value()
+        && *arguments.expected_octree_hash != octreeHash)
+    {
+        util::logWarn(
+            "Octree hash mismatch | Expected {:016X} | Received {:016X}",
+            *arguments.expected_octree_hash,
+            octreeHash);
+
+        matched = false;
+    }
+
+    if (arguments.expected_mesh_hash.has_value()
+        && *arguments.expected_mesh_hash != meshHash)
+    {
+        util::logWarn(
+            "Mesh hash mismatch | Expected {:016X} | Received {:016X}",
+            *arguments.expected_mesh_hash,
+            meshHash);
+
+        matched = false;
+    }
+
+    util::finishTracing();
+
+    return matched ? 0 : 1;
+}
@@ -70,7 +70,7 @@ void game::entity::Cube::tick()
     this->object.transform.yawBy(1.0f * this->renderer.getDeltaTimeSeconds());
 }
 
-std::vector<const gfx::Object*> game::entity::Cube::draw() const
+void game::entity::Cube::draw(std::vector<const gfx::Object*>& objects) const
 {
-    return {dynamic_cast<const gfx::Object*>(&this->object)};
+    objects.push_back(dynamic_cast<const gfx::Object*>(&this->object));
 }
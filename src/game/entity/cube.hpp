@@ -18,8 +18,8 @@ namespace game::entity
         Cube(gfx::Renderer&, glm::vec3 position);
         ~Cube() override = default;
 
-        void                                          tick() override;
-        [[nodiscard]] std::vector<const gfx::Object*> draw() const override;
+        void tick() override;
+        void draw(std::vector<const gfx::Object*>&) const override;
 
     private:
         gfx::SimpleTriangulatedObject object;
@@ -112,8 +112,8 @@ namespace game::entity
 
     void DiskEntity::tick() {}
 
-    std::vector<const gfx::Object*> DiskEntity::draw() const
+    void DiskEntity::draw(std::vector<const gfx::Object*>& objects) const
     {
-        return {dynamic_cast<const gfx::Object*>(this->object.get())};
+        objects.push_back(dynamic_cast<const gfx::Object*>(this->object.get()));
     }
 } // namespace game::entity
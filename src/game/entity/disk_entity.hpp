@@ -20,8 +20,8 @@ namespace game::entity
         DiskEntity(gfx::Renderer&, const char* filepath);
         ~DiskEntity() override;
 
-        void                                          tick() override;
-        [[nodiscard]] std::vector<const gfx::Object*> draw() const override;
+        void tick() override;
+        void draw(std::vector<const gfx::Object*>&) const override;
 
     public:
         std::unique_ptr<gfx::SimpleTriangulatedObject> object;
@@ -17,8 +17,9 @@ namespace game::entity
         Entity& operator= (const Entity&) = delete;
         Entity& operator= (Entity&&)      = delete;
 
-        virtual void                                          tick()       = 0;
-        [[nodiscard]] virtual std::vector<const gfx::Object*> draw() const = 0;
+        virtual void tick() = 0;
+        /// Appends every object to draw this frame
+        virtual void draw(std::vector<const gfx::Object*>&) const = 0;
 
         virtual explicit operator std::string () const;
 
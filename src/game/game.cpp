@@ -2,15 +2,31 @@
 #include "entity/cube.hpp"
 #include "entity/disk_entity.hpp"
 #include <gfx/renderer.hpp>
+#include <chrono>
+#include <util/allocation.hpp>
 #include <util/log.hpp>
+#include <util/threads.hpp>
+#include <util/trace.hpp>
 
 namespace game
 {
+    namespace
+    {
+        /// Background jobs are held back as the end of this nears, 60fps
+        constexpr std::chrono::microseconds FrameBudget {16667};
+
+        /// Everything a frame needs should have been allocated by the time
+        /// this many have run, every tick after is an AllocationFreeScope
+        constexpr std::size_t WarmupTicks {120};
+    } // namespace
+
     Game::Game(gfx::Renderer& renderer_)
         : renderer {renderer_}
         , player {this->renderer, {-30.0f, 20.0f, -20.0f}}
         , entities {}
         , world {this->renderer}
+        , draw_objects {}
+        , ticks {0}
     {
         this->entities.push_back(std::make_unique<entity::Cube>(
             this->renderer, glm::vec3 {0.0f, 12.5f, 0.0f}));
@@ -27,31 +43,38 @@ namespace game
 
     void Game::tick()
     {
+        util::TraceZone           zone {"Game::tick"};
+        util::AllocationFreeScope allocationFree {
+            "Game::tick", this->ticks++ >= WarmupTicks};
+
+        const std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+
+        util::getThreadPool().beginFrame(start + FrameBudget);
+
         this->player.tick();
 
-        std::vector<const gfx::Object*> objects {};
+        // Keeps its capacity from the last frame
+        this->draw_objects.clear();
 
         for (const std::unique_ptr<entity::Entity>& e : this->entities)
         {
             e->tick();
-
-            for (const gfx::Object* obj : e->draw())
-            {
-                objects.push_back(obj);
-            }
+            e->draw(this->draw_objects);
         }
 
         this->player.tick();
 
-        std::vector<std::shared_ptr<gfx::Object>> worldObjects =
-            this->world.draw();
+        this->world.draw(this->draw_objects);
 
-        for (std::shared_ptr<gfx::Object>& obj : worldObjects)
-        {
-            objects.push_back(obj.get());
-        }
+        this->renderer.getFrameStatistics().record(
+            gfx::FramePhase::GameTick,
+            std::chrono::steady_clock::now() - start);
+
+        this->renderer.drawObjects(
+            this->player.getCamera(), this->draw_objects);
 
-        this->renderer.drawObjects(this->player.getCamera(), objects);
+        util::getThreadPool().endFrame();
     }
 
 } // namespace game
@@ -4,7 +4,9 @@
 #include "game/player.hpp"
 #include "game/world/world.hpp"
 #include "world/voxel_octree.hpp"
+#include <cstddef>
 #include <memory>
+#include <vector>
 
 namespace gfx
 {
@@ -37,6 +39,9 @@ namespace game
         Player                                       player;
         std::vector<std::unique_ptr<entity::Entity>> entities;
         world::World                                 world;
+        /// Reused every tick
+        std::vector<const gfx::Object*>              draw_objects;
+        std::size_t                                  ticks;
     };
 } // namespace game
 
@@ -0,0 +1,559 @@
+#include "generator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <util/log.hpp>
+
+namespace game::world
+{
+    namespace
+    {
+        /// Chunks that can wait in front of each stage, past that the
+        /// worker that finished the previous stage carries on with them
+        constexpr std::size_t StageCapacity {32};
+
+        constexpr std::int32_t VolumeExtent {
+            static_cast<std::int32_t>(VoxelVolume::Extent)};
+
+        constexpr std::int32_t floorToVolume(std::int32_t y)
+        {
+            if (y >= 0)
+            {
+                return (y / VolumeExtent) * VolumeExtent;
+            }
+            else
+            {
+                return ((y - VolumeExtent + 1) / VolumeExtent) * VolumeExtent;
+            }
+        }
+
+        float normalizeColumnCoordinate(std::int32_t coordinate)
+        {
+            return util::map<float>(
+                static_cast<float>(coordinate),
+                static_cast<float>(VoxelOctree::VoxelMinimum),
+                static_cast<float>(VoxelOctree::VoxelMaximum),
+                -1.0f,
+                1.0f);
+        }
+    } // namespace
+
+    Chunk::Chunk(ChunkCoordinate coordinate_)
+        : coordinate {coordinate_}
+        , heightmap {nullptr}
+        , columns {}
+        , volumes {}
+        , volume_base_y {0}
+        , mesh {}
+    {}
+
+    void Chunk::fillColumn(
+        std::int32_t localX,
+        std::int32_t localZ,
+        std::int32_t bottomY,
+        std::int32_t topY,
+        Voxel        voxel)
+    {
+        const std::int32_t firstVolume = floorToVolume(bottomY);
+        const std::int32_t lastVolume  = floorToVolume(topY);
+
+        if (this->volumes.empty())
+        {
+            this->volume_base_y = firstVolume;
+        }
+
+        const auto makeVolume = [&](std::int32_t y)
+        {
+            return std::make_unique<VoxelVolume>(Position {
+                this->coordinate.x * Heightmap::Extent,
+                y,
+                this->coordinate.z * Heightmap::Extent});
+        };
+
+        while (this->volume_base_y > firstVolume)
+        {
+            this->volume_base_y -= VolumeExtent;
+
+            this->volumes.insert(
+                this->volumes.begin(), makeVolume(this->volume_base_y));
+        }
+
+        while (this->volume_base_y
+                   + static_cast<std::int32_t>(this->volumes.size())
+                         * VolumeExtent
+               <= lastVolume)
+        {
+            this->volumes.push_back(makeVolume(
+                this->volume_base_y
+                + static_cast<std::int32_t>(this->volumes.size())
+                      * VolumeExtent));
+        }
+
+        const std::int32_t globalX =
+            this->coordinate.x * Heightmap::Extent + localX;
+        const std::int32_t globalZ =
+            this->coordinate.z * Heightmap::Extent + localZ;
+
+        for (std::int32_t volumeY = firstVolume; volumeY <= lastVolume;
+             volumeY += VolumeExtent)
+        {
+            this->volumes[static_cast<std::size_t>(
+                              (volumeY - this->volume_base_y) / VolumeExtent)]
+                ->fillColumnFromGlobalPosition(
+                    Position {globalX, std::max(bottomY, volumeY), globalZ},
+                    std::min(topY, volumeY + VolumeExtent - 1),
+                    voxel);
+        }
+    }
+
+    DensityStage::DensityStage(HeightmapCache& heightmaps_)
+        : heightmaps {heightmaps_}
+    {}
+
+    std::string_view DensityStage::getName() const
+    {
+        return "Density";
+    }
+
+    void DensityStage::process(Chunk& chunk)
+    {
+        chunk.heightmap = this->heightmaps.get(chunk.coordinate);
+    }
+
+    std::string_view SurfaceStage::getName() const
+    {
+        return "Surface";
+    }
+
+    void SurfaceStage::process(Chunk& chunk)
+    {
+        const Heightmap& heightmap = *chunk.heightmap;
+
+        for (std::int32_t localZ = 0; localZ < Heightmap::Extent; ++localZ)
+        {
+            for (std::int32_t localX = 0; localX < Heightmap::Extent; ++localX)
+            {
+                const std::int32_t height = heightmap.getHeight(localX, localZ);
+
+                // Fill down to the lowest neighbouring surface so that there
+                // are no gaps in the sides of cliffs
+                const std::int32_t bottom = std::min(
+                    {height,
+                     heightmap.getHeight(localX - 1, localZ) + 1,
+                     heightmap.getHeight(localX + 1, localZ) + 1,
+                     heightmap.getHeight(localX, localZ - 1) + 1,
+                     heightmap.getHeight(localX, localZ + 1) + 1});
+
+                chunk.columns[static_cast<std::size_t>(
+                    localZ * Heightmap::Extent + localX)] =
+                    ColumnSpan {.bottom {bottom}, .top {height}};
+            }
+        }
+    }
+
+    std::string_view ColoringStage::getName() const
+    {
+        return "Coloring";
+    }
+
+    void ColoringStage::process(Chunk& chunk)
+    {
+        for (std::int32_t localZ = 0; localZ < Heightmap::Extent; ++localZ)
+        {
+            const float normalizedZ = normalizeColumnCoordinate(
+                chunk.coordinate.z * Heightmap::Extent + localZ);
+
+            for (std::int32_t localX = 0; localX < Heightmap::Extent; ++localX)
+            {
+                const float normalizedX = normalizeColumnCoordinate(
+                    chunk.coordinate.x * Heightmap::Extent + localX);
+
+                const ColumnSpan span = chunk.columns[static_cast<std::size_t>(
+                    localZ * Heightmap::Extent + localX)];
+
+                glm::vec4 color {0.0f, 1.0f, 1.0f, 1.0f};
+
+                color.g = std::fmod(
+                    util::map(normalizedX, -1.0f, 1.0f, 0.0f, 0.5f), 1.0f);
+                color.b = std::fmod(
+                    util::map(normalizedZ, -1.0f, 1.0f, 0.0f, 0.5f), 1.0f);
+
+                if (span.top % 2 == 0)
+                {
+                    color.r = 0.125f;
+                }
+
+                chunk.fillColumn(
+                    localX, localZ, span.bottom, span.top, Voxel {color});
+            }
+        }
+    }
+
+    std::string_view MeshingStage::getName() const
+    {
+        return "Meshing";
+    }
+
+    void MeshingStage::process(Chunk& chunk)
+    {
+        for (const std::unique_ptr<VoxelVolume>& volume : chunk.volumes)
+        {
+            volume->drawToMesh(chunk.mesh);
+        }
+    }
+
+    OctreeInsertionStage::OctreeInsertionStage(
+        util::Mutex<VoxelOctree>& octree_)
+        : octree {octree_}
+    {}
+
+    std::string_view OctreeInsertionStage::getName() const
+    {
+        return "Insertion";
+    }
+
+    void OctreeInsertionStage::process(Chunk& chunk)
+    {
+        this->octree.lock(
+            [&](VoxelOctree& tree)
+            {
+                for (std::unique_ptr<VoxelVolume>& volume : chunk.volumes)
+                {
+                    tree.insertVolume(std::move(volume));
+                }
+            });
+
+        chunk.volumes.clear();
+    }
+
+    std::vector<std::unique_ptr<GenerationStage>>
+    makeDefaultGenerationStages(HeightmapCache& heightmaps)
+    {
+        std::vector<std::unique_ptr<GenerationStage>> output {};
+
+        output.push_back(std::make_unique<DensityStage>(heightmaps));
+        output.push_back(std::make_unique<SurfaceStage>());
+        output.push_back(std::make_unique<ColoringStage>());
+        output.push_back(std::make_unique<MeshingStage>());
+
+        return output;
+    }
+
+    Generator::Generator(
+        std::vector<std::unique_ptr<GenerationStage>> generationStages)
+        : stages {}
+        , chunks_remaining {0}
+        , work_epoch {0}
+        , failed {false}
+        , last_wall_time {0}
+    {
+        util::assertFatal(
+            !generationStages.empty(), "Tried to create an empty Generator");
+
+        for (std::unique_ptr<GenerationStage>& s : generationStages)
+        {
+            auto [sender, receiver] =
+                util::mpmc::create<std::unique_ptr<Chunk>>(StageCapacity);
+
+            this->stages.push_back(Stage {
+                .stage {std::move(s)},
+                .sender {std::move(sender)},
+                .receiver {std::move(receiver)},
+                .queue_depth {std::make_unique<std::atomic<std::size_t>>(0)},
+                .maximum_depth {std::make_unique<std::atomic<std::size_t>>(0)},
+                .processed {std::make_unique<std::atomic<std::size_t>>(0)},
+                .busy_nanoseconds {
+                    std::make_unique<std::atomic<std::int64_t>>(0)},
+            });
+        }
+    }
+
+    void Generator::generate(std::span<const ChunkCoordinate> chunks)
+    {
+        const auto begin = std::chrono::steady_clock::now();
+
+        this->chunks_remaining.store(chunks.size());
+
+        std::size_t            nextChunk {0};
+        std::unique_ptr<Chunk> unsentChunk {};
+
+        // Only the calling thread starts new chunks and only while the first
+        // stage has room for them, so the number of chunks in flight stays
+        // bounded however far behind the later stages are
+        const auto feed = [&]
+        {
+            while (unsentChunk != nullptr || nextChunk < chunks.size())
+            {
+                if (unsentChunk == nullptr)
+                {
+                    unsentChunk = std::make_unique<Chunk>(chunks[nextChunk++]);
+                }
+
+                if (!this->tryEnqueue(0, unsentChunk))
+                {
+                    return;
+                }
+            }
+        };
+
+        std::mutex         exceptionMutex;
+        std::exception_ptr exception {};
+
+        // The first exception stops every thread at its next chunk, the rest
+        // are dropped
+        const auto fail = [&]
+        {
+            {
+                std::unique_lock lock {exceptionMutex};
+
+                if (exception == nullptr)
+                {
+                    exception = std::current_exception();
+                }
+            }
+
+            this->failed.store(true);
+            this->notifyWork();
+        };
+
+        // Helpers give their worker back between chunks while a frame needs
+        // it, the calling thread always keeps going until everything is done.
+        // Anyone without work parks until a chunk is enqueued or finished.
+        const auto work = [&](bool isHelper)
+        {
+            while (this->chunks_remaining.load() != 0 && !this->failed.load())
+            {
+                if (isHelper && util::getThreadPool().isBackgroundPaused())
+                {
+                    return;
+                }
+
+                const std::uint64_t epoch = this->work_epoch.load();
+
+                try
+                {
+                    if (!isHelper)
+                    {
+                        feed();
+                    }
+
+                    if (this->tryProcessOne())
+                    {
+                        continue;
+                    }
+                }
+                catch (...)
+                {
+                    fail();
+
+                    return;
+                }
+
+                this->work_epoch.wait(epoch);
+            }
+        };
+
+        this->failed.store(false);
+
+        std::vector<util::Future<void>> workers {};
+
+        // The calling thread also does work, so one less worker is needed
+        const std::size_t numberOfWorkers =
+            util::getThreadPool().getNumberOfWorkers() - 1;
+
+        for (std::size_t i = 0; i < numberOfWorkers; ++i)
+        {
+            workers.push_back(util::runAsynchronously<void>(
+                [&work]
+                {
+                    work(true);
+                },
+                util::Priority::Background));
+        }
+
+        work(false);
+
+        // Helpers reference this frame, they have to be done before it's
+        // unwound by anything
+        for (util::Future<void>& w : workers)
+        {
+            w.await();
+        }
+
+        if (exception != nullptr)
+        {
+            // Leaves the generator usable for the next call
+            for (Stage& s : this->stages)
+            {
+                while (s.receiver.tryReceive().has_value())
+                {}
+
+                s.queue_depth->store(0);
+            }
+
+            std::rethrow_exception(exception);
+        }
+
+        this->last_wall_time = std::chrono::steady_clock::now() - begin;
+    }
+
+    std::vector<StageStatistics> Generator::getStatistics() const
+    {
+        std::vector<StageStatistics> output {};
+
+        for (const Stage& s : this->stages)
+        {
+            output.push_back(StageStatistics {
+                .name {s.stage->getName()},
+                .chunks_processed {s.processed->load()},
+                .busy_time {std::chrono::nanoseconds {
+                    s.busy_nanoseconds->load()}},
+                .maximum_queue_depth {s.maximum_depth->load()},
+            });
+        }
+
+        return output;
+    }
+
+    std::chrono::nanoseconds Generator::getLastWallTime() const
+    {
+        return this->last_wall_time;
+    }
+
+    void Generator::logStatistics() const
+    {
+        const std::vector<StageStatistics> statistics = this->getStatistics();
+
+        std::chrono::nanoseconds totalBusyTime {0};
+
+        for (const StageStatistics& s : statistics)
+        {
+            totalBusyTime += s.busy_time;
+        }
+
+        util::logLog(
+            "World generation took {}ms",
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                this->last_wall_time)
+                .count());
+
+        for (const StageStatistics& s : statistics)
+        {
+            const double busySeconds =
+                std::chrono::duration<double> {s.busy_time}.count();
+
+            util::logLog(
+                "Stage {:<10} | {:>5} chunks | {:>9.1f} chunks/s | busy "
+                "{:>8.1f}ms ({:>4.1f}%) | max queue {}",
+                s.name,
+                s.chunks_processed,
+                busySeconds > 0.0
+                    ? static_cast<double>(s.chunks_processed) / busySeconds
+                    : 0.0,
+                busySeconds * 1000.0,
+                totalBusyTime.count() > 0
+                    ? 100.0 * static_cast<double>(s.busy_time.count())
+                          / static_cast<double>(totalBusyTime.count())
+                    : 0.0,
+                s.maximum_queue_depth);
+        }
+    }
+
+    bool Generator::tryEnqueue(
+        std::size_t stageIndex, std::unique_ptr<Chunk>& chunk)
+    {
+        Stage& s = this->stages[stageIndex];
+
+        const std::size_t depth = s.queue_depth->fetch_add(1) + 1;
+
+        // Left untouched if the stage is full
+        if (!s.sender.trySend(std::move(chunk)))
+        {
+            s.queue_depth->fetch_sub(1);
+
+            return false;
+        }
+
+        std::size_t maximum = s.maximum_depth->load();
+
+        while (depth > maximum
+               && !s.maximum_depth->compare_exchange_weak(maximum, depth))
+        {}
+
+        this->notifyWork();
+
+        return true;
+    }
+
+    void Generator::notifyWork()
+    {
+        this->work_epoch.fetch_add(1);
+        this->work_epoch.notify_all();
+    }
+
+    void Generator::process(
+        std::size_t stageIndex, std::unique_ptr<Chunk> chunk)
+    {
+        // A chunk that can't be handed to the next stage because it's full is
+        // taken through it here instead, which is what pushes back on the
+        // earlier stages without ever blocking a worker
+        for (std::size_t i = stageIndex; i < this->stages.size(); ++i)
+        {
+            Stage& s = this->stages[i];
+
+            const auto begin = std::chrono::steady_clock::now();
+
+            s.stage->process(*chunk);
+
+            const auto end = std::chrono::steady_clock::now();
+
+            s.busy_nanoseconds->fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    end - begin)
+                    .count());
+            s.processed->fetch_add(1);
+
+            if (i + 1 == this->stages.size())
+            {
+                this->chunks_remaining.fetch_sub(1);
+                this->notifyWork();
+            }
+            else if (this->failed.load())
+            {
+                return;
+            }
+            else if (this->tryEnqueue(i + 1, chunk))
+            {
+                return;
+            }
+        }
+    }
+
+    bool Generator::tryProcessOne()
+    {
+        // Prefer later stages so that chunks in flight get finished before
+        // new ones are started
+        for (std::size_t i = this->stages.size(); i-- > 0;)
+        {
+            Stage& s = this->stages[i];
+
+            std::optional<std::unique_ptr<Chunk>> maybeChunk =
+                s.receiver.tryReceive();
+
+            if (!maybeChunk.has_value())
+            {
+                continue;
+            }
+
+            s.queue_depth->fetch_sub(1);
+
+            this->process(i, std::move(*maybeChunk));
+
+            return true;
+        }
+
+        return false;
+    }
+} // namespace game::world
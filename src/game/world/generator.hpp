@@ -0,0 +1,202 @@
+#ifndef SRC_GAME_WORLD_GENERATOR_HPP
+#define SRC_GAME_WORLD_GENERATOR_HPP
+
+#include "heightmap.hpp"
+#include "voxel_octree.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <util/mesh.hpp>
+#include <util/threads.hpp>
+#include <vector>
+
+namespace game::world
+{
+    /// Vertical span of solid voxels in one column of a chunk, both ends are
+    /// inclusive
+    struct ColumnSpan
+    {
+        std::int32_t bottom;
+        std::int32_t top;
+    };
+
+    /// Everything that has been generated for a single chunk so far, owned by
+    /// whichever stage is currently processing it
+    struct Chunk
+    {
+        explicit Chunk(ChunkCoordinate);
+
+        /// Sets every voxel in the column at the chunk local (localX, localZ)
+        /// from bottomY up to and including topY, creating volumes as needed
+        void fillColumn(
+            std::int32_t localX,
+            std::int32_t localZ,
+            std::int32_t bottomY,
+            std::int32_t topY,
+            Voxel);
+
+        ChunkCoordinate                  coordinate;
+        std::shared_ptr<const Heightmap> heightmap;
+
+        /// Indexed [localZ * Heightmap::Extent + localX]
+        std::array<ColumnSpan, Heightmap::Extent * Heightmap::Extent> columns;
+
+        /// The chunk's VoxelVolumes ordered from bottom to top, starting at
+        /// volume_base_y
+        std::vector<std::unique_ptr<VoxelVolume>> volumes;
+        std::int32_t                              volume_base_y;
+
+        util::Mesh mesh;
+    };
+
+    /// A single step of world generation
+    ///
+    /// process() is called concurrently on different chunks, any state that
+    /// is shared between chunks must be synchronized by the stage itself.
+    class GenerationStage
+    {
+    public:
+        GenerationStage()          = default;
+        virtual ~GenerationStage() = default;
+
+        GenerationStage(const GenerationStage&)             = delete;
+        GenerationStage(GenerationStage&&)                  = delete;
+        GenerationStage& operator= (const GenerationStage&) = delete;
+        GenerationStage& operator= (GenerationStage&&)      = delete;
+
+        [[nodiscard]] virtual std::string_view getName() const = 0;
+
+        virtual void process(Chunk&) = 0;
+    };
+
+    /// Samples the chunk's heightmap
+    class DensityStage final : public GenerationStage
+    {
+    public:
+        explicit DensityStage(HeightmapCache&);
+
+        [[nodiscard]] std::string_view getName() const override;
+        void                           process(Chunk&) override;
+
+    private:
+        HeightmapCache& heightmaps;
+    };
+
+    /// Decides which span of every column is solid
+    class SurfaceStage final : public GenerationStage
+    {
+    public:
+        [[nodiscard]] std::string_view getName() const override;
+        void                           process(Chunk&) override;
+    };
+
+    /// Writes the colored voxels of every span into the chunk's volumes
+    class ColoringStage final : public GenerationStage
+    {
+    public:
+        [[nodiscard]] std::string_view getName() const override;
+        void                           process(Chunk&) override;
+    };
+
+    class MeshingStage final : public GenerationStage
+    {
+    public:
+        [[nodiscard]] std::string_view getName() const override;
+        void                           process(Chunk&) override;
+    };
+
+    /// Moves the chunk's volumes into an octree, the chunk has no volumes
+    /// afterwards so this must come after every stage that reads them
+    class OctreeInsertionStage final : public GenerationStage
+    {
+    public:
+        explicit OctreeInsertionStage(util::Mutex<VoxelOctree>&);
+
+        [[nodiscard]] std::string_view getName() const override;
+        void                           process(Chunk&) override;
+
+    private:
+        util::Mutex<VoxelOctree>& octree;
+    };
+
+    /// Returns density -> surface -> coloring -> meshing, decoration and
+    /// upload stages are appended by the caller as they need more context
+    std::vector<std::unique_ptr<GenerationStage>>
+    makeDefaultGenerationStages(HeightmapCache&);
+
+    struct StageStatistics
+    {
+        std::string_view         name;
+        std::size_t              chunks_processed;
+        std::chrono::nanoseconds busy_time;
+        std::size_t              maximum_queue_depth;
+    };
+
+    /// Runs chunks through a sequence of GenerationStages on the thread pool
+    ///
+    /// Every stage has its own bounded queue and workers always take from the
+    /// latest stage with work available, so chunks finish in roughly the
+    /// order they were started and one chunk can be meshed while the next is
+    /// generated.
+    class Generator
+    {
+    public:
+        explicit Generator(std::vector<std::unique_ptr<GenerationStage>>);
+        ~Generator() = default;
+
+        Generator(const Generator&)             = delete;
+        Generator(Generator&&)                  = delete;
+        Generator& operator= (const Generator&) = delete;
+        Generator& operator= (Generator&&)      = delete;
+
+        /// Blocks until every chunk has gone through every stage, the calling
+        /// thread also does work. If a stage throws the remaining chunks are
+        /// dropped and the first exception is rethrown here.
+        void generate(std::span<const ChunkCoordinate>);
+
+        [[nodiscard]] std::vector<StageStatistics> getStatistics() const;
+        [[nodiscard]] std::chrono::nanoseconds     getLastWallTime() const;
+
+        /// Logs the statistics of every stage along with the wall time of the
+        /// last call to generate()
+        void logStatistics() const;
+
+    private:
+        struct Stage
+        {
+            std::unique_ptr<GenerationStage>             stage;
+            util::mpmc::Sender<std::unique_ptr<Chunk>>   sender;
+            util::mpmc::Receiver<std::unique_ptr<Chunk>> receiver;
+            std::unique_ptr<std::atomic<std::size_t>>    queue_depth;
+            std::unique_ptr<std::atomic<std::size_t>>    maximum_depth;
+            std::unique_ptr<std::atomic<std::size_t>>    processed;
+            std::unique_ptr<std::atomic<std::int64_t>>   busy_nanoseconds;
+        };
+
+        // moves out of chunk unless the stage is full
+        bool tryEnqueue(std::size_t stageIndex, std::unique_ptr<Chunk>& chunk);
+
+        // runs chunk through stageIndex and then any later stages that are
+        // full
+        void process(std::size_t stageIndex, std::unique_ptr<Chunk> chunk);
+
+        // returns false if there was no work available in any stage
+        bool tryProcessOne();
+
+        // wakes every thread parked in generate()
+        void notifyWork();
+
+        std::vector<Stage>       stages;
+        std::atomic<std::size_t>   chunks_remaining;
+        /// Incremented whenever a chunk is enqueued or finished
+        std::atomic<std::uint64_t> work_epoch;
+        std::atomic<bool>          failed;
+        std::chrono::nanoseconds   last_wall_time;
+    };
+} // namespace game::world
+
+#endif // SRC_GAME_WORLD_GENERATOR_HPP
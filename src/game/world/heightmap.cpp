@@ -0,0 +1,260 @@
+#include "heightmap.hpp"
+#include <algorithm>
+#include <limits>
+#include <util/log.hpp>
+#include <util/noise.hpp>
+
+namespace game::world
+{
+    namespace
+    {
+        constexpr std::int32_t
+        floorDivide(std::int32_t number, std::int32_t divisor)
+        {
+            if (number >= 0)
+            {
+                return number / divisor;
+            }
+            else
+            {
+                return (number - divisor + 1) / divisor;
+            }
+        }
+
+        float normalizeColumnCoordinate(std::int32_t coordinate)
+        {
+            return util::map<float>(
+                static_cast<float>(coordinate),
+                static_cast<float>(VoxelOctree::VoxelMinimum),
+                static_cast<float>(VoxelOctree::VoxelMaximum),
+                -1.0f,
+                1.0f);
+        }
+
+        /// Octaves that barely change from one column to the next, these are
+        /// only ever sampled on the coarse grid
+        float sampleLowFrequencyOctaves(
+            float normalizedX, float normalizedZ, std::uint64_t seed)
+        {
+            return util::perlin(
+                       util::Vec2 {normalizedX * 4, normalizedZ * 4}, seed)
+                     * 256
+                 + util::perlin(
+                       util::Vec2 {normalizedX * 2, normalizedZ * 2}, seed)
+                       * 512;
+        }
+
+        float sampleHighFrequencyOctaves(
+            float normalizedX, float normalizedZ, std::uint64_t seed)
+        {
+            return util::perlin(
+                       util::Vec2 {normalizedX * 16, normalizedZ * 16}, seed)
+                     * 64
+                 + util::perlin(
+                       util::Vec2 {normalizedX * 8, normalizedZ * 8}, seed)
+                       * 128;
+        }
+
+        /// Catmull-Rom spline through p1 and p2, weight is in [0.0, 1.0]
+        float cubicInterpolate(std::array<float, 4> p, float weight)
+        {
+            return 0.5f
+                 * (2.0f * p[1] + (p[2] - p[0]) * weight
+                    + (2.0f * p[0] - 5.0f * p[1] + 4.0f * p[2] - p[3]) * weight
+                          * weight
+                    + (3.0f * (p[1] - p[2]) + p[3] - p[0]) * weight * weight
+                          * weight);
+        }
+    } // namespace
+
+    ChunkCoordinate::operator std::string () const
+    {
+        return fmt::format("Chunk X: {} | Z: {}", this->x, this->z);
+    }
+
+    Heightmap::Heightmap(ChunkCoordinate coordinate_, std::uint64_t seed_)
+        : coordinate {coordinate_}
+        , seed {seed_}
+        , minimum_height {std::numeric_limits<std::int32_t>::max()}
+        , maximum_height {std::numeric_limits<std::int32_t>::min()}
+        , heights {}
+    {
+        const std::int32_t originX = this->coordinate.x * Extent;
+        const std::int32_t originZ = this->coordinate.z * Extent;
+
+        // The coarse grid covers every stored column plus one extra sample on
+        // each side for the support of the cubic
+        constexpr std::int32_t CoarseMinimum {
+            floorDivide(-Border, CoarseSpacing) - 1};
+        constexpr std::int32_t CoarseMaximum {
+            floorDivide(Extent + Border - 1, CoarseSpacing) + 2};
+        constexpr std::int32_t CoarseSamples {
+            CoarseMaximum - CoarseMinimum + 1};
+
+        std::array<float, CoarseSamples * CoarseSamples> coarse {};
+
+        for (std::int32_t z = 0; z < CoarseSamples; ++z)
+        {
+            for (std::int32_t x = 0; x < CoarseSamples; ++x)
+            {
+                coarse[static_cast<std::size_t>(z * CoarseSamples + x)] =
+                    sampleLowFrequencyOctaves(
+                        normalizeColumnCoordinate(
+                            originX + (CoarseMinimum + x) * CoarseSpacing),
+                        normalizeColumnCoordinate(
+                            originZ + (CoarseMinimum + z) * CoarseSpacing),
+                        this->seed);
+            }
+        }
+
+        for (std::int32_t localZ = -Border; localZ < Extent + Border; ++localZ)
+        {
+            const std::int32_t cellZ = floorDivide(localZ, CoarseSpacing);
+            const float        weightZ =
+                static_cast<float>(localZ - cellZ * CoarseSpacing)
+                / static_cast<float>(CoarseSpacing);
+
+            for (std::int32_t localX = -Border; localX < Extent + Border;
+                 ++localX)
+            {
+                const std::int32_t cellX = floorDivide(localX, CoarseSpacing);
+                const float        weightX =
+                    static_cast<float>(localX - cellX * CoarseSpacing)
+                    / static_cast<float>(CoarseSpacing);
+
+                std::array<float, 4> rows {};
+
+                for (std::int32_t row = 0; row < 4; ++row)
+                {
+                    const std::size_t rowStart = static_cast<std::size_t>(
+                        (cellZ - CoarseMinimum - 1 + row) * CoarseSamples
+                        + (cellX - CoarseMinimum - 1));
+
+                    rows[static_cast<std::size_t>(row)] = cubicInterpolate(
+                        {coarse[rowStart],
+                         coarse[rowStart + 1],
+                         coarse[rowStart + 2],
+                         coarse[rowStart + 3]},
+                        weightX);
+                }
+
+                const float height =
+                    cubicInterpolate(rows, weightZ)
+                    + sampleHighFrequencyOctaves(
+                        normalizeColumnCoordinate(originX + localX),
+                        normalizeColumnCoordinate(originZ + localZ),
+                        this->seed);
+
+                const std::int32_t finalHeight =
+                    static_cast<std::int32_t>(height) / 4;
+
+                this->heights[static_cast<std::size_t>(
+                    (localZ + Border) * StoredExtent + (localX + Border))] =
+                    finalHeight;
+
+                this->minimum_height =
+                    std::min(this->minimum_height, finalHeight);
+                this->maximum_height =
+                    std::max(this->maximum_height, finalHeight);
+            }
+        }
+    }
+
+    std::int32_t
+    Heightmap::getHeight(std::int32_t localX, std::int32_t localZ) const
+    {
+        util::assertFatal(
+            localX >= -Border && localX < Extent + Border && localZ >= -Border
+                && localZ < Extent + Border,
+            "Column ({}, {}) is outside of the heightmap",
+            localX,
+            localZ);
+
+        return this->heights[static_cast<std::size_t>(
+            (localZ + Border) * StoredExtent + (localX + Border))];
+    }
+
+    ChunkCoordinate Heightmap::getCoordinate() const
+    {
+        return this->coordinate;
+    }
+
+    std::uint64_t Heightmap::getSeed() const
+    {
+        return this->seed;
+    }
+
+    std::int32_t Heightmap::getMinimumHeight() const
+    {
+        return this->minimum_height;
+    }
+
+    std::int32_t Heightmap::getMaximumHeight() const
+    {
+        return this->maximum_height;
+    }
+
+    HeightmapCache::HeightmapCache(std::uint64_t seed_)
+        : seed {seed_}
+        , heightmaps {}
+    {
+        this->heightmaps.setStatistics(
+            util::getLockStatistics("Heightmap cache"));
+    }
+
+    std::shared_ptr<const Heightmap> HeightmapCache::get(ChunkCoordinate chunk)
+    {
+        std::shared_ptr<const Heightmap> output {nullptr};
+
+        this->heightmaps.read(
+            chunk,
+            [&](const std::unordered_map<
+                ChunkCoordinate,
+                std::shared_ptr<const Heightmap>>& map)
+            {
+                if (auto it = map.find(chunk); it != map.end())
+                {
+                    output = it->second;
+                }
+            });
+
+        if (output != nullptr)
+        {
+            return output;
+        }
+
+        // Generate outside of the lock, if another thread raced us here the
+        // first heightmap to be inserted wins
+        std::shared_ptr<const Heightmap> generated =
+            std::make_shared<const Heightmap>(chunk, this->seed);
+
+        this->heightmaps.write(
+            chunk,
+            [&](std::unordered_map<
+                ChunkCoordinate,
+                std::shared_ptr<const Heightmap>>& map)
+            {
+                output = map.try_emplace(chunk, std::move(generated))
+                             .first->second;
+            });
+
+        return output;
+    }
+
+    void HeightmapCache::erase(ChunkCoordinate chunk)
+    {
+        this->heightmaps.write(
+            chunk,
+            [&](std::unordered_map<
+                ChunkCoordinate,
+                std::shared_ptr<const Heightmap>>& map)
+            {
+                map.erase(chunk);
+            });
+    }
+
+    std::uint64_t HeightmapCache::getSeed() const
+    {
+        return this->seed;
+    }
+} // namespace game::world
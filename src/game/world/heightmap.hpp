@@ -0,0 +1,124 @@
+#ifndef SRC_GAME_WORLD_HEIGHTMAP_HPP
+#define SRC_GAME_WORLD_HEIGHTMAP_HPP
+
+#include "voxel_octree.hpp"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <util/threads.hpp>
+
+namespace game::world
+{
+    /// Horizontal position of a chunk, a column of VoxelVolumes that are
+    /// generated together
+    struct ChunkCoordinate
+    {
+        std::int32_t x;
+        std::int32_t z;
+
+        [[nodiscard]] bool operator== (const ChunkCoordinate&) const = default;
+
+        operator std::string () const;
+    };
+
+    /// The terrain's surface height for every column of a chunk
+    ///
+    /// A one column border of the neighbouring chunks is also stored so that
+    /// later stages can look at their neighbours without resampling any noise.
+    class Heightmap
+    {
+    public:
+        /// Columns along each side of a chunk
+        static constexpr std::int32_t Extent {
+            static_cast<std::int32_t>(VoxelVolume::Extent)};
+
+        /// Columns of the neighbouring chunks that are also stored
+        static constexpr std::int32_t Border {1};
+
+        /// Distance in columns between samples of the low frequency octaves,
+        /// everything in between is bicubically interpolated
+        static constexpr std::int32_t CoarseSpacing {8};
+    public:
+        Heightmap(ChunkCoordinate, std::uint64_t seed);
+        ~Heightmap() = default;
+
+        Heightmap(const Heightmap&)             = delete;
+        Heightmap(Heightmap&&)                  = default;
+        Heightmap& operator= (const Heightmap&) = delete;
+        Heightmap& operator= (Heightmap&&)      = default;
+
+        /// Both coordinates are local to the chunk and may be anywhere in
+        /// [-Border, Extent + Border)
+        [[nodiscard]] std::int32_t
+        getHeight(std::int32_t localX, std::int32_t localZ) const;
+
+        [[nodiscard]] ChunkCoordinate getCoordinate() const;
+        [[nodiscard]] std::uint64_t   getSeed() const;
+        [[nodiscard]] std::int32_t    getMinimumHeight() const;
+        [[nodiscard]] std::int32_t    getMaximumHeight() const;
+
+    private:
+        static constexpr std::int32_t StoredExtent {Extent + 2 * Border};
+
+        ChunkCoordinate coordinate;
+        std::uint64_t   seed;
+        std::int32_t    minimum_height;
+        std::int32_t    maximum_height;
+
+        std::array<std::int32_t, StoredExtent * StoredExtent> heights;
+    };
+} // namespace game::world
+
+namespace std
+{
+    template<>
+    struct hash<game::world::ChunkCoordinate>
+    {
+        std::size_t operator() (
+            const game::world::ChunkCoordinate& coordinate) const noexcept
+        {
+            std::size_t             seed {0};
+            std::hash<std::int32_t> hasher;
+
+            util::hashCombine(seed, hasher(coordinate.x));
+            util::hashCombine(seed, hasher(coordinate.z));
+
+            return seed;
+        }
+    };
+} // namespace std
+
+namespace game::world
+{
+    /// Thread safe cache of every Heightmap that has been generated so far,
+    /// sharded so that lookups of different chunks don't contend
+    class HeightmapCache
+    {
+    public:
+        explicit HeightmapCache(std::uint64_t seed);
+        ~HeightmapCache() = default;
+
+        HeightmapCache(const HeightmapCache&)             = delete;
+        HeightmapCache(HeightmapCache&&)                  = delete;
+        HeightmapCache& operator= (const HeightmapCache&) = delete;
+        HeightmapCache& operator= (HeightmapCache&&)      = delete;
+
+        /// Returns the cached heightmap, generating it first if required
+        [[nodiscard]] std::shared_ptr<const Heightmap> get(ChunkCoordinate);
+
+        void erase(ChunkCoordinate);
+
+        [[nodiscard]] std::uint64_t getSeed() const;
+
+    private:
+        std::uint64_t seed;
+        util::Sharded<std::unordered_map<
+            ChunkCoordinate,
+            std::shared_ptr<const Heightmap>>>
+            heightmaps;
+    };
+} // namespace game::world
+
+#endif // SRC_GAME_WORLD_HEIGHTMAP_HPP
@@ -1,10 +1,12 @@
 #include "voxel_octree.hpp"
 #include "game/world/voxel_octree.hpp"
-#include "gfx/vulkan/gpu_data.hpp"
 #include "util/misc.hpp"
+#include <algorithm>
 #include <functional>
 #include <ranges>
+#include <span>
 #include <util/log.hpp>
+#include <util/trace.hpp>
 #include <variant>
 
 namespace game::world
@@ -132,13 +134,50 @@ namespace game::world
         //     "Z: {} is out of bounds!",
         //     localPosition.z);
 
-        return this->storage[localPosition.x][localPosition.y][localPosition.z];
+        return this->storage[localPosition.x][localPosition.z][localPosition.y];
     }
 
-    void VoxelVolume::drawToVectors(
-        std::vector<gfx::vulkan::Vertex>& outputVertices,
-        std::vector<gfx::vulkan::Index>&  outputIndices)
+    void VoxelVolume::fillColumnFromGlobalPosition(
+        Position globalBottom, std::int32_t topY, Voxel voxel)
     {
+        const Position localBottom = globalBottom - this->local_offset;
+        const std::int32_t localTop = topY - this->local_offset.y;
+
+        util::assertFatal(
+            localBottom.y >= 0 && localBottom.y <= localTop
+                && localTop < static_cast<std::int32_t>(Extent),
+            "Column span [{}, {}] is not inside of the volume at {}",
+            globalBottom.y,
+            topY,
+            static_cast<std::string>(this->local_offset));
+
+        std::array<Voxel, Extent>& column =
+            this->storage[localBottom.x][localBottom.z];
+
+        std::fill(
+            column.begin() + localBottom.y,
+            column.begin() + localTop + 1,
+            voxel);
+    }
+
+    Position VoxelVolume::getGlobalOffset() const
+    {
+        return this->local_offset;
+    }
+
+    std::uint64_t VoxelVolume::hash(std::uint64_t previous) const
+    {
+        const std::uint64_t offsetHash = util::crc64(
+            std::as_bytes(std::span {&this->local_offset, 1}), previous);
+
+        return util::crc64(
+            std::as_bytes(std::span {&this->storage, 1}), offsetHash);
+    }
+
+    void VoxelVolume::drawToMesh(util::Mesh& output)
+    {
+        util::TraceZone zone {"VoxelVolume::drawToMesh"};
+
         auto iterator = std::views::iota(0, static_cast<std::int32_t>(Extent));
 
         for (std::int32_t localX : iterator)
@@ -156,50 +195,50 @@ namespace game::world
                     }
 
                     // TODO: replace vertex with a smaller one
-                    const std::array<gfx::vulkan::Vertex, 8> cubeVertices {
-                        gfx::vulkan::Vertex {
+                    const std::array<util::MeshVertex, 8> cubeVertices {
+                        util::MeshVertex {
                             .position {-0.5f, -0.5f, -0.5f},
                             .color {voxel.color},
                             .normal {},
                             .uv {},
                         },
-                        gfx::vulkan::Vertex {
+                        util::MeshVertex {
                             .position {-0.5f, -0.5f, 0.5f},
                             .color {voxel.color},
                             .normal {},
                             .uv {},
                         },
-                        gfx::vulkan::Vertex {
+                        util::MeshVertex {
                             .position {-0.5f, 0.5f, -0.5f},
                             .color {voxel.color},
                             .normal {},
                             .uv {},
                         },
-                        gfx::vulkan::Vertex {
+                        util::MeshVertex {
                             .position {-0.5f, 0.5f, 0.5f},
                             .color {voxel.color},
                             .normal {},
                             .uv {},
                         },
-                        gfx::vulkan::Vertex {
+                        util::MeshVertex {
                             .position {0.5f, -0.5f, -0.5f},
                             .color {voxel.color},
                             .normal {},
                             .uv {},
                         },
-                        gfx::vulkan::Vertex {
+                        util::MeshVertex {
                             .position {0.5f, -0.5f, 0.5f},
                             .color {voxel.color},
                             .normal {},
                             .uv {},
                         },
-                        gfx::vulkan::Vertex {
+                        util::MeshVertex {
                             .position {0.5f, 0.5f, -0.5f},
                             .color {voxel.color},
                             .normal {},
                             .uv {},
                         },
-                        gfx::vulkan::Vertex {
+                        util::MeshVertex {
                             .position {0.5f, 0.5f, 0.5f},
                             .color {voxel.color},
                             .normal {},
@@ -207,15 +246,15 @@ namespace game::world
                         },
                     };
 
-                    constexpr std::array<gfx::vulkan::Index, 36> cubeIndices {
+                    constexpr std::array<util::MeshIndex, 36> cubeIndices {
                         6, 2, 7, 2, 3, 7, 0, 4, 5, 1, 0, 5, 0, 2, 6, 4, 0, 6,
                         3, 1, 7, 1, 5, 7, 2, 0, 3, 0, 1, 3, 4, 6, 7, 5, 4, 7};
 
-                    const std::size_t IndicesOffset = outputVertices.size();
+                    const std::size_t IndicesOffset = output.vertices.size();
 
                     // Update positions to be aligned with the world and insert
                     // into output
-                    for (gfx::vulkan::Vertex v : cubeVertices)
+                    for (util::MeshVertex v : cubeVertices)
                     {
                         v.position +=
                             static_cast<glm::vec3>(this->local_offset);
@@ -223,26 +262,58 @@ namespace game::world
                         v.position += static_cast<glm::vec3>(
                             Position {localX, localY, localZ});
 
-                        outputVertices.push_back(v);
+                        output.vertices.push_back(v);
                     }
 
                     // update indices to actually point to the correct index
-                    for (gfx::vulkan::Index i : cubeIndices)
+                    for (util::MeshIndex i : cubeIndices)
                     {
                         i += static_cast<std::uint32_t>(IndicesOffset);
 
-                        outputIndices.push_back(i);
+                        output.indices.push_back(i);
                     }
                 }
             }
         }
     }
 
-    std::pair<std::vector<gfx::vulkan::Vertex>, std::vector<gfx::vulkan::Index>>
-    VoxelOctree::draw() const
+    util::Mesh VoxelOctree::draw() const
+    {
+        util::TraceZone zone {"VoxelOctree::draw"};
+
+        util::Mesh output {};
+
+        std::function<void(const Node*)> impl;
+
+        impl = [&](const Node* node)
+        {
+            std::visit(
+                util::VariantHelper {
+                    [&](const std::unique_ptr<VoxelVolume>& volume)
+                    {
+                        volume->drawToMesh(output);
+                    },
+                    [&](const std::array<std::unique_ptr<Node>, 8>& nodes)
+                    {
+                        for (const std::unique_ptr<Node>& n : nodes)
+                        {
+                            if (n != nullptr)
+                            {
+                                impl(n.get());
+                            }
+                        }
+                    }},
+                node->data);
+        };
+
+        impl(&this->parent);
+
+        return output;
+    }
+
+    std::uint64_t VoxelOctree::hash() const
     {
-        std::vector<gfx::vulkan::Vertex> outputVertices;
-        std::vector<gfx::vulkan::Index>  outputIndices;
+        std::uint64_t output {0};
 
         std::function<void(const Node*)> impl;
 
@@ -252,7 +323,7 @@ namespace game::world
                 util::VariantHelper {
                     [&](const std::unique_ptr<VoxelVolume>& volume)
                     {
-                        volume->drawToVectors(outputVertices, outputIndices);
+                        output = volume->hash(output);
                     },
                     [&](const std::array<std::unique_ptr<Node>, 8>& nodes)
                     {
@@ -269,7 +340,7 @@ namespace game::world
 
         impl(&this->parent);
 
-        return std::make_pair(outputVertices, outputIndices);
+        return output;
     }
 
     Octant getOctantFromPosition(Position position)
@@ -355,6 +426,125 @@ namespace game::world
     }
 
     Voxel& VoxelOctree::access(Position globalPosition)
+    {
+        return this->accessVolume(globalPosition)
+            .accessFromGlobalPosition(globalPosition);
+    }
+
+    void VoxelOctree::fillColumn(
+        std::int32_t x,
+        std::int32_t z,
+        std::int32_t bottomY,
+        std::int32_t topY,
+        Voxel        voxel)
+    {
+        util::assertFatal(
+            bottomY <= topY,
+            "Column bottom {} is above its top {}",
+            bottomY,
+            topY);
+
+        constexpr std::int32_t VolumeExtent {
+            static_cast<std::int32_t>(VoxelVolume::Extent)};
+
+        std::int32_t spanBottom = bottomY;
+
+        while (spanBottom <= topY)
+        {
+            const Position bottom {x, spanBottom, z};
+
+            VoxelVolume& volume = this->accessVolume(bottom);
+
+            const std::int32_t spanTop = std::min(
+                topY, volume.getGlobalOffset().y + VolumeExtent - 1);
+
+            volume.fillColumnFromGlobalPosition(bottom, spanTop, voxel);
+
+            spanBottom = spanTop + 1;
+        }
+    }
+
+    void VoxelOctree::insertVolume(std::unique_ptr<VoxelVolume> volume)
+    {
+        const Position offset = volume->getGlobalOffset();
+
+        Node& node = this->traverseToVolumeNode(offset);
+
+        std::array<std::unique_ptr<Node>, 8>* children =
+            std::get_if<std::array<std::unique_ptr<Node>, 8>>(&node.data);
+
+        util::assertFatal(
+            children != nullptr,
+            "Tried to insert a volume over an existing volume at {}",
+            static_cast<std::string>(offset));
+
+        node.data = std::move(volume);
+    }
+
+    VoxelVolume& VoxelOctree::accessVolume(Position globalPosition)
+    {
+        // *pain*
+        auto roundDownToNearestMultipleOfN =
+            []<class I>(I multiple, I number) -> I
+        {
+            if (number >= 0)
+            {
+                return (number / multiple) * multiple;
+            }
+            else
+            {
+                return ((number - multiple + 1) / multiple) * multiple;
+            }
+        };
+
+        Node* workingNode = &this->traverseToVolumeNode(globalPosition);
+
+        // We now have the last node. It's either a volume in which case
+        // everything is good. Or its more nodes in which case we need to
+        // replace it with a volume
+        if (std::array<std::unique_ptr<Node>, 8>* ptr =
+                std::get_if<std::array<std::unique_ptr<Node>, 8>>(
+                    &workingNode->data))
+        {
+            // The last node isn't a VoxelVolume, make it one
+            // for (const std::unique_ptr<Node>& n : *ptr)
+            // {
+            //     util::assertFatal(
+            //         n == nullptr, "Node traversal was not nullptr");
+            // }
+
+            Position volumePosition {
+                roundDownToNearestMultipleOfN(
+                    static_cast<std::int32_t>(VoxelVolume::Extent),
+                    globalPosition.x),
+                roundDownToNearestMultipleOfN(
+                    static_cast<std::int32_t>(VoxelVolume::Extent),
+                    globalPosition.y),
+                roundDownToNearestMultipleOfN(
+                    static_cast<std::int32_t>(VoxelVolume::Extent),
+                    globalPosition.z),
+            };
+
+            workingNode->data = std::make_unique<VoxelVolume>(volumePosition);
+
+            // util::logTrace(
+            //     "Instantiated new Volume @ {} | {}",
+            //     (void*)(std::get_if<std::unique_ptr<VoxelVolume>>(
+            //         &workingNode->data)),
+            //     static_cast<std::string>(volumePosition));
+        }
+
+        // util::logTrace(
+        //     "Working volulume Addr: {}",
+        //     (void*)(&std::get<std::unique_ptr<VoxelVolume>>(
+        //         workingNode->data)));
+
+        // We have traversed down the tree, workingNode is now pointing
+        // towards the node that contains the position that we want.
+        return **std::get_if<std::unique_ptr<VoxelVolume>>(&workingNode->data);
+    }
+
+    Node& VoxelOctree::traverseToVolumeNode(Position globalPosition)
     {
         util::assertFatal(
             globalPosition.x >= VoxelMinimum
@@ -381,20 +571,6 @@ namespace game::world
 
         /// Once we reach the node retreve the reference to it
 
-        // *pain*
-        auto roundDownToNearestMultipleOfN =
-            []<class I>(I multiple, I number) -> I
-        {
-            if (number >= 0)
-            {
-                return (number / multiple) * multiple;
-            }
-            else
-            {
-                return ((number - multiple + 1) / multiple) * multiple;
-            }
-        };
-
         // std::ignore = generateIndiciesToGetToVoxelVolume(Position {1602, 1,
         // 0}); util::panic("Earlyterm");
 
@@ -443,50 +619,7 @@ namespace game::world
             // ++iteration;
         }
 
-        // We now have the last node. It's either a volume in which case
-        // everything is good. Or its more nodes in which case we need to
-        // replace it with a volume
-        if (std::array<std::unique_ptr<Node>, 8>* ptr =
-                std::get_if<std::array<std::unique_ptr<Node>, 8>>(
-                    &workingNode->data))
-        {
-            // The last node isn't a VoxelVolume, make it one
-            // for (const std::unique_ptr<Node>& n : *ptr)
-            // {
-            //     util::assertFatal(
-            //         n == nullptr, "Node traversal was not nullptr");
-            // }
-
-            Position volumePosition {
-                roundDownToNearestMultipleOfN(
-                    static_cast<std::int32_t>(VoxelVolume::Extent),
-                    globalPosition.x),
-                roundDownToNearestMultipleOfN(
-                    static_cast<std::int32_t>(VoxelVolume::Extent),
-                    globalPosition.y),
-                roundDownToNearestMultipleOfN(
-                    static_cast<std::int32_t>(VoxelVolume::Extent),
-                    globalPosition.z),
-            };
-
-            workingNode->data = std::make_unique<VoxelVolume>(volumePosition);
-
-            // util::logTrace(
-            //     "Instantiated new Volume @ {} | {}",
-            //     (void*)(std::get_if<std::unique_ptr<VoxelVolume>>(
-            //         &workingNode->data)),
-            //     static_cast<std::string>(volumePosition));
-        }
-
-        // util::logTrace(
-        //     "Working volulume Addr: {}",
-        //     (void*)(&std::get<std::unique_ptr<VoxelVolume>>(
-        //         workingNode->data)));
-
-        // We have traversed down the tree, workingNode is now pointing
-        // towards the node that contains the position that we want.
-        return (*std::get_if<std::unique_ptr<VoxelVolume>>(&workingNode->data))
-            ->accessFromGlobalPosition(globalPosition);
+        return *workingNode;
     }
 
 } // namespace game::world
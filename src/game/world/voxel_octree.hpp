@@ -1,11 +1,15 @@
 #ifndef SRC_GAME_WORLD_VOXEL__OCTREE_HPP
 #define SRC_GAME_WORLD_VOXEL__OCTREE_HPP
 
-#include "gfx/vulkan/gpu_data.hpp"
-#include <gfx/vulkan/includes.hpp>
+#include <array>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <util/glm.hpp>
+#include <util/mesh.hpp>
 #include <util/misc.hpp>
 #include <variant>
+#include <vector>
 
 namespace game::world
 {
@@ -70,14 +74,26 @@ namespace game::world
         // TODO: remove once working
         Voxel& accessFromGlobalPosition(Position globalPosition);
 
-        void drawToVectors(
-            std::vector<gfx::vulkan::Vertex>&,
-            std::vector<gfx::vulkan::Index>&);
+        /// Sets every voxel from globalBottom up to and including topY, the
+        /// whole span must be inside of this volume
+        void fillColumnFromGlobalPosition(
+            Position globalBottom, std::int32_t topY, Voxel);
+
+        /// Appends a cube for every voxel that should be drawn
+        void drawToMesh(util::Mesh&);
+
+        [[nodiscard]] Position getGlobalOffset() const;
+
+        /// crc64 of the volume's position and every voxel in it, continuing
+        /// from previous
+        [[nodiscard]] std::uint64_t hash(std::uint64_t previous = 0) const;
 
     private:
         Voxel& accessFromLocalPosition(Position localPosition);
 
         Position local_offset;
+
+        // Indexed [x][z][y] so that every column is contiguous
         std::array<std::array<std::array<Voxel, Extent>, Extent>, Extent>
             storage;
     };
@@ -107,19 +123,38 @@ namespace game::world
         ~VoxelOctree()         = default;
 
         VoxelOctree(const VoxelOctree&)             = delete;
-        VoxelOctree(VoxelOctree&&)                  = delete;
+        VoxelOctree(VoxelOctree&&)                  = default;
         VoxelOctree& operator= (const VoxelOctree&) = delete;
-        VoxelOctree& operator= (VoxelOctree&&)      = delete;
+        VoxelOctree& operator= (VoxelOctree&&)      = default;
 
-        [[nodiscard]] std::pair<
-            std::vector<gfx::vulkan::Vertex>,
-            std::vector<gfx::vulkan::Index>>
-        draw() const;
+        [[nodiscard]] util::Mesh draw() const;
 
         Voxel& access(Position);
 
+        /// crc64 of every volume in the tree, visited in octant order so that
+        /// the result doesn't depend on the order the volumes were created in
+        [[nodiscard]] std::uint64_t hash() const;
+
+        /// Sets every voxel in the column at (x, z) from bottomY up to and
+        /// including topY
+        ///
+        /// This traverses the tree once per VoxelVolume rather than once per
+        /// voxel, so filling terrain down to its base is affordable.
+        void fillColumn(
+            std::int32_t x,
+            std::int32_t z,
+            std::int32_t bottomY,
+            std::int32_t topY,
+            Voxel);
+
+        /// Takes ownership of a volume that was generated outside of the tree,
+        /// there must not already be a volume at its position
+        void insertVolume(std::unique_ptr<VoxelVolume>);
 
     private:
+        Node&        traverseToVolumeNode(Position);
+        VoxelVolume& accessVolume(Position);
+
         Node parent;
     };
 } // namespace game::world
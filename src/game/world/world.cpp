@@ -1,108 +1,254 @@
 #include "world.hpp"
+#include "generator.hpp"
+#include "heightmap.hpp"
 #include "voxel_octree.hpp"
-#include <chrono>
-#include <functional>
+#include <algorithm>
 #include <gfx/renderer.hpp>
 #include <ranges>
-#include <util/noise.hpp>
+#include <span>
+#include <util/trace.hpp>
 
 namespace game::world
 {
-    World::World(gfx::Renderer& renderer_)
-        : renderer {renderer_}
+    namespace
     {
-        auto begin = std::chrono::high_resolution_clock::now();
+        /// The game always generates the same world, mango_worldgen_bench's
+        /// default --seed is this so its hashes describe the world that's
+        /// actually played
+        constexpr std::uint64_t WorldSeed {0};
+
+        /// Chunks along each side of a region, every region is uploaded as a
+        /// single object so the renderer sees a handful of objects instead
+        /// of one per chunk
+        constexpr std::int32_t RegionExtent {16};
+
+        std::int32_t getRegionCoordinate(std::int32_t chunkCoordinate)
+        {
+            // rounds towards negative infinity
+            return chunkCoordinate >= 0
+                     ? chunkCoordinate / RegionExtent
+                     : (chunkCoordinate - RegionExtent + 1) / RegionExtent;
+        }
 
-        for (std::int32_t ox : std::views::iota(
-                 VoxelOctree::VoxelMinimum, VoxelOctree::VoxelMaximum))
+        /// Appends every chunk's mesh to its region and uploads a region as
+        /// soon as its last chunk arrives
+        class UploadStage final : public GenerationStage
         {
-            for (std::int32_t oy : std::views::iota(
-                     VoxelOctree::VoxelMinimum, VoxelOctree::VoxelMaximum))
+        public:
+            UploadStage(
+                gfx::Renderer&                   renderer_,
+                std::span<const ChunkCoordinate> chunks)
+                : renderer {renderer_}
+                , region_minimum_x {0}
+                , region_minimum_z {0}
+                , regions_along_x {0}
+                , regions {}
+                , objects {std::vector<std::shared_ptr<gfx::Object>> {}}
             {
-                const float normalizedX = util::map<float>(
-                    static_cast<float>(ox),
-                    static_cast<float>(VoxelOctree::VoxelMinimum),
-                    static_cast<float>(VoxelOctree::VoxelMaximum),
-                    -1.0f,
-                    1.0f);
-
-                const float normalizedY = util::map<float>(
-                    static_cast<float>(oy),
-                    static_cast<float>(VoxelOctree::VoxelMinimum),
-                    static_cast<float>(VoxelOctree::VoxelMaximum),
-                    -1.0f,
-                    1.0f);
-
-                std::function<std::int32_t(void)> height;
-
-                height = [=]() -> std::int32_t
+                if (chunks.empty())
                 {
-                    std::int32_t workingHeight = 0;
+                    return;
+                }
+
+                std::int32_t regionMaximumX {
+                    getRegionCoordinate(chunks.front().x)};
+                std::int32_t regionMaximumZ {
+                    getRegionCoordinate(chunks.front().z)};
+
+                this->region_minimum_x = regionMaximumX;
+                this->region_minimum_z = regionMaximumZ;
+
+                for (const ChunkCoordinate& c : chunks)
+                {
+                    const std::int32_t x = getRegionCoordinate(c.x);
+                    const std::int32_t z = getRegionCoordinate(c.z);
+
+                    this->region_minimum_x =
+                        std::min(this->region_minimum_x, x);
+                    this->region_minimum_z =
+                        std::min(this->region_minimum_z, z);
+                    regionMaximumX = std::max(regionMaximumX, x);
+                    regionMaximumZ = std::max(regionMaximumZ, z);
+                }
+
+                this->regions_along_x =
+                    regionMaximumX - this->region_minimum_x + 1;
+
+                const std::int32_t numberOfRegions =
+                    this->regions_along_x
+                    * (regionMaximumZ - this->region_minimum_z + 1);
+
+                this->regions.reserve(
+                    static_cast<std::size_t>(numberOfRegions));
+
+                for (std::int32_t i = 0; i < numberOfRegions; ++i)
+                {
+                    this->regions.push_back(
+                        std::make_unique<util::Mutex<Region>>(Region {}));
+                }
+
+                for (const ChunkCoordinate& c : chunks)
+                {
+                    this->getRegion(c).lock(
+                        [](Region& r)
+                        {
+                            r.chunks_remaining += 1;
+                        });
+                }
+            }
+
+            [[nodiscard]] std::string_view getName() const override
+            {
+                return "Upload";
+            }
+
+            void process(Chunk& chunk) override
+            {
+                util::Mesh completed {};
+
+                this->getRegion(chunk.coordinate)
+                    .lock(
+                        [&](Region& r)
+                        {
+                            appendMesh(r.mesh, chunk.mesh);
+
+                            r.chunks_remaining -= 1;
 
-                    workingHeight += util::perlin(util::Vector<float, 2> {
-                                         normalizedX * 16, normalizedY * 16})
-                                   * 64;
+                            if (r.chunks_remaining == 0)
+                            {
+                                completed = std::move(r.mesh);
+                            }
+                        });
 
-                    workingHeight += util::perlin(util::Vector<float, 2> {
-                                         normalizedX * 8, normalizedY * 8})
-                                   * 128;
+                chunk.mesh = {};
 
-                    workingHeight += util::perlin(util::Vector<float, 2> {
-                                         normalizedX * 4, normalizedY * 4})
-                                   * 256;
+                if (completed.indices.empty())
+                {
+                    return;
+                }
 
-                    workingHeight += util::perlin(util::Vector<float, 2> {
-                                         normalizedX * 2, normalizedY * 2})
-                                   * 512;
+                std::shared_ptr<gfx::Object> object =
+                    std::make_shared<gfx::SimpleTriangulatedObject>(
+                        this->renderer, completed.vertices, completed.indices);
+
+                this->objects.lock(
+                    [&](std::vector<std::shared_ptr<gfx::Object>>& o)
+                    {
+                        o.push_back(std::move(object));
+                    });
+            }
 
-                    // TODO: add seeds
+            [[nodiscard]] std::vector<std::shared_ptr<gfx::Object>>
+            takeObjects()
+            {
+                std::vector<std::shared_ptr<gfx::Object>> output {};
 
-                    return workingHeight / 4;
-                };
+                this->objects.lock(
+                    [&](std::vector<std::shared_ptr<gfx::Object>>& o)
+                    {
+                        output = std::move(o);
+                    });
 
-                world::Position outputPosition {ox, height(), oy};
+                return output;
+            }
 
-                // glm::vec4 color {
-                //     std::abs(
-                //         normalizedX * normalizedY * normalizedX *
-                //         normalizedY),
-                //     util::map(normalizedX, -1.0f, 1.0f, 0.3f, 0.7f),
-                //     util::map(normalizedY, -1.0f, 1.0f, 0.3f, 0.7f),
-                //     1.0f};
+        private:
+            struct Region
+            {
+                util::Mesh  mesh;
+                std::size_t chunks_remaining;
+            };
 
-                glm::vec4 color {0.0f, 1.0f, 1.0f, 1.0f};
+            static void appendMesh(util::Mesh& output, const util::Mesh& mesh)
+            {
+                const util::MeshIndex offset =
+                    static_cast<util::MeshIndex>(output.vertices.size());
 
-                color.g = std::fmod(
-                    util::map(normalizedX, -1.0f, 1.0f, 0.0f, 0.5f), 1.0f);
-                color.b = std::fmod(
-                    util::map(normalizedY, -1.0f, 1.0f, 0.0f, 0.5f), 1.0f);
+                output.vertices.insert(
+                    output.vertices.end(),
+                    mesh.vertices.begin(),
+                    mesh.vertices.end());
 
-                if (outputPosition.y % 2 == 0)
+                output.indices.reserve(
+                    output.indices.size() + mesh.indices.size());
+
+                for (util::MeshIndex i : mesh.indices)
                 {
-                    color.r = 0.125f;
+                    output.indices.push_back(offset + i);
                 }
+            }
+
+            util::Mutex<Region>& getRegion(ChunkCoordinate chunk)
+            {
+                const std::int32_t x =
+                    getRegionCoordinate(chunk.x) - this->region_minimum_x;
+                const std::int32_t z =
+                    getRegionCoordinate(chunk.z) - this->region_minimum_z;
 
-                this->octree.access(outputPosition) = world::Voxel {color};
+                return *this->regions.at(
+                    static_cast<std::size_t>(z * this->regions_along_x + x));
+            }
+
+            gfx::Renderer& renderer;
+            std::int32_t   region_minimum_x;
+            std::int32_t   region_minimum_z;
+            std::int32_t   regions_along_x;
+            std::vector<std::unique_ptr<util::Mutex<Region>>> regions;
+            util::Mutex<std::vector<std::shared_ptr<gfx::Object>>> objects;
+        };
+    } // namespace
+
+    World::World(gfx::Renderer& renderer_)
+        : renderer {renderer_}
+        , heightmaps {WorldSeed}
+        , octree {VoxelOctree {}}
+    {
+        util::TraceZone zone {"World::World"};
+
+        this->octree.setStatistics(util::getLockStatistics("Voxel octree"));
+
+        constexpr std::int32_t ChunkMinimum {
+            VoxelOctree::VoxelMinimum / Heightmap::Extent};
+        constexpr std::int32_t ChunkMaximum {
+            (VoxelOctree::VoxelMaximum + 1) / Heightmap::Extent};
+
+        std::vector<ChunkCoordinate> chunks {};
+
+        for (std::int32_t chunkX : std::views::iota(ChunkMinimum, ChunkMaximum))
+        {
+            for (std::int32_t chunkZ :
+                 std::views::iota(ChunkMinimum, ChunkMaximum))
+            {
+                chunks.push_back(ChunkCoordinate {chunkX, chunkZ});
             }
         }
 
-        auto end = std::chrono::high_resolution_clock::now();
+        std::vector<std::unique_ptr<GenerationStage>> stages =
+            makeDefaultGenerationStages(this->heightmaps);
+
+        stages.push_back(std::make_unique<OctreeInsertionStage>(this->octree));
+
+        std::unique_ptr<UploadStage> upload =
+            std::make_unique<UploadStage>(this->renderer, chunks);
+        UploadStage& uploadStage = *upload;
 
-        util::logTrace(
-            "World generation complete {}ms",
-            std::chrono::duration_cast<std::chrono::milliseconds>(end - begin)
-                .count());
+        stages.push_back(std::move(upload));
 
-        auto [vertices, indices] = this->octree.draw();
+        Generator generator {std::move(stages)};
 
-        this->objects.push_back(std::make_shared<gfx::SimpleTriangulatedObject>(
-            this->renderer, vertices, indices));
+        generator.generate(chunks);
+        generator.logStatistics();
+
+        this->objects = uploadStage.takeObjects();
 
         util::logTrace("World initialization complete");
     }
 
-    std::vector<std::shared_ptr<gfx::Object>> World::draw() const
+    void World::draw(std::vector<const gfx::Object*>& output) const
     {
-        return this->objects;
+        for (const std::shared_ptr<gfx::Object>& o : this->objects)
+        {
+            output.push_back(o.get());
+        }
     }
-} // namespace game::world
\ No newline at end of file
+} // namespace game::world
@@ -1,10 +1,12 @@
 #ifndef SRC_GAME_WORLD_WORLD_HPP
 #define SRC_GAME_WORLD_WORLD_HPP
 
+#include "game/world/heightmap.hpp"
 #include "game/world/voxel_octree.hpp"
 #include "gfx/object.hpp"
 #include "gfx/renderer.hpp"
 #include "voxel_octree.hpp"
+#include <util/threads.hpp>
 
 namespace game::world
 {
@@ -19,15 +21,15 @@ namespace game::world
         World& operator= (const World&) = delete;
         World& operator= (World&&)      = delete;
 
-        // why the shared_ptr?
-        // these can fall off between frames and need to stay alive just long
-        // enough
-        [[nodiscard]] std::vector<std::shared_ptr<gfx::Object>> draw() const;
+        /// Appends every object to draw this frame, they live as long as the
+        /// World does
+        void draw(std::vector<const gfx::Object*>&) const;
 
     private:
         std::vector<std::shared_ptr<gfx::Object>> objects;
         gfx::Renderer&                            renderer;
-        VoxelOctree                               octree;
+        HeightmapCache                            heightmaps;
+        util::Mutex<VoxelOctree>                  octree;
     };
 } // namespace game::world
 
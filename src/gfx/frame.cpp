@@ -1,5 +1,6 @@
 #include "frame.hpp"
 #include "camera.hpp"
+#include "frame_statistics.hpp"
 #include "object.hpp"
 #include "transform.hpp"
 #include "vulkan/buffer.hpp"
@@ -7,6 +8,8 @@
 #include "vulkan/pipelines.hpp"
 #include "vulkan/render_pass.hpp"
 #include "vulkan/swapchain.hpp"
+#include <algorithm>
+#include <util/trace.hpp>
 
 namespace gfx
 {
@@ -22,6 +25,7 @@ namespace gfx
         , image_available {nullptr}
         , render_finished {nullptr}
         , frame_in_flight {nullptr}
+        , sorted_objects {}
     {
         const vk::SemaphoreCreateInfo semaphoreCreateInfo {
             .sType {vk::StructureType::eSemaphoreCreateInfo},
@@ -49,21 +53,28 @@ namespace gfx
         const Camera&                                           camera,
         vk::Extent2D                                            size,
         const std::map<vulkan::PipelineType, vulkan::Pipeline>& pipelineMap,
-        std::span<const Object*>                                unsortedObjects)
+        std::span<const Object*>                                unsortedObjects,
+        FrameStatistics&                                        statistics)
     {
+        util::TraceZone zone {"Frame::render"};
+
         std::optional<bool> returnValue = std::nullopt;
 
-        std::vector<const Object*> sortedObjects;
-        sortedObjects.insert(
-            sortedObjects.cend(),
-            unsortedObjects.begin(),
-            unsortedObjects.end());
-        std::ranges::sort(
-            sortedObjects,
-            [](const Object* l, const Object* r)
-            {
-                return *l < *r;
-            });
+        {
+            FramePhaseTimer timer {statistics, FramePhase::Sort};
+
+            // Keeps its capacity from the last frame. Sorted in place on this
+            // thread as util::parallelSort allocates its shared state and
+            // merge buffers, and a frame only has a few dozen objects
+            this->sorted_objects.assign(
+                unsortedObjects.begin(), unsortedObjects.end());
+            std::ranges::sort(
+                this->sorted_objects,
+                [](const Object* l, const Object* r)
+                {
+                    return *l < *r;
+                });
+        }
 
         this->device->accessGraphicsBuffer(
             [&](vk::Queue queue, vk::CommandBuffer commandBuffer)
@@ -72,6 +83,8 @@ namespace gfx
                     std::numeric_limits<std::uint64_t>::max();
 
                 {
+                    FramePhaseTimer timer {statistics, FramePhase::FenceWait};
+
                     vk::Result result =
                         this->device->asLogicalDevice().waitForFences(
                             *this->frame_in_flight, true, timeout);
@@ -84,6 +97,8 @@ namespace gfx
 
                 std::uint32_t nextImageIndex;
                 {
+                    FramePhaseTimer timer {statistics, FramePhase::Acquire};
+
                     const auto [result, maybeNextFrameBufferIndex] =
                         this->device->asLogicalDevice().acquireNextImageKHR(
                             **this->swapchain, timeout, *this->image_available);
@@ -106,6 +121,9 @@ namespace gfx
                         static_cast<std::uint32_t>(maybeNextFrameBufferIndex);
                 }
 
+                const std::chrono::steady_clock::time_point recordStart =
+                    std::chrono::steady_clock::now();
+
                 this->device->asLogicalDevice().resetFences(
                     *this->frame_in_flight);
 
@@ -163,7 +181,7 @@ namespace gfx
 
                 BindState bindState {};
 
-                for (const Object* o : sortedObjects)
+                for (const Object* o : this->sorted_objects)
                 {
                     o->bind(commandBuffer, bindState);
                     o->setPushConstants(commandBuffer, camera);
@@ -190,6 +208,10 @@ namespace gfx
 
                 queue.submit(submitInfo, *this->frame_in_flight);
 
+                statistics.record(
+                    FramePhase::CommandRecord,
+                    std::chrono::steady_clock::now() - recordStart);
+
                 vk::SwapchainKHR swapchainPtr = **this->swapchain;
 
                 vk::PresentInfoKHR presentInfo {
@@ -204,6 +226,8 @@ namespace gfx
                 };
 
                 {
+                    FramePhaseTimer timer {statistics, FramePhase::Present};
+
                     VkResult result =
                         VULKAN_HPP_DEFAULT_DISPATCHER.vkQueuePresentKHR(
                             static_cast<VkQueue>(queue),
@@ -226,10 +250,17 @@ namespace gfx
                     }
                 }
 
+                const std::chrono::steady_clock::time_point waitStart =
+                    std::chrono::steady_clock::now();
+
                 const vk::Result result =
                     this->device->asLogicalDevice().waitForFences(
                         *this->frame_in_flight, true, timeout);
 
+                statistics.record(
+                    FramePhase::FenceWait,
+                    std::chrono::steady_clock::now() - waitStart);
+
                 util::assertFatal(
                     result == vk::Result::eSuccess,
                     "Failed to wait for frame to complete drawing {}",
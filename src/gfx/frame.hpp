@@ -6,10 +6,12 @@
 #include <map>
 #include <memory>
 #include <span>
+#include <vector>
 
 namespace gfx
 {
     class Camera;
+    class FrameStatistics;
     class Object;
 
     namespace vulkan
@@ -45,7 +47,8 @@ namespace gfx
             const Camera&,
             vk::Extent2D windowSize,
             const std::map<vulkan::PipelineType, vulkan::Pipeline>&,
-            std::span<const Object*>);
+            std::span<const Object*>,
+            FrameStatistics&);
 
     private:
         std::shared_ptr<vulkan::Device>                     device;
@@ -56,6 +59,8 @@ namespace gfx
         vk::UniqueSemaphore image_available;
         vk::UniqueSemaphore render_finished;
         vk::UniqueFence     frame_in_flight;
+
+        std::vector<const Object*> sorted_objects;
     }; // class Frame
 } // namespace gfx
 
@@ -0,0 +1,202 @@
+#include "frame_statistics.hpp"
+#include <util/log.hpp>
+#include <charconv>
+#include <cstdlib>
+#include <iterator>
+#include <optional>
+#include <string_view>
+
+namespace gfx
+{
+    namespace
+    {
+        constexpr std::array<std::string_view, NumberOfFramePhases + 3>
+            RowNames {
+                "Frame",
+                "Input poll",
+                "Game tick",
+                "Sort",
+                "Fence wait",
+                "Acquire",
+                "Command record",
+                "Present",
+                "Allocations",
+                "Bytes"};
+
+        std::chrono::seconds getLogIntervalFromEnvironment()
+        {
+            // NOLINTNEXTLINE: read once at startup
+            const char* value = std::getenv("MANGO_FRAME_STATISTICS");
+
+            if (value == nullptr)
+            {
+                return std::chrono::seconds {0};
+            }
+
+            const std::string_view string {value};
+
+            std::chrono::seconds::rep seconds {0};
+
+            const auto [end, error] = std::from_chars(
+                string.data(), string.data() + string.size(), seconds);
+
+            if (error != std::errc {} || end != string.data() + string.size()
+                || seconds < 0)
+            {
+                util::logWarn(
+                    "Ignoring invalid MANGO_FRAME_STATISTICS={}", string);
+
+                return std::chrono::seconds {0};
+            }
+
+            return std::chrono::seconds {seconds};
+        }
+
+        double toMilliseconds(std::uint64_t nanoseconds)
+        {
+            return static_cast<double>(nanoseconds) / 1e6;
+        }
+    } // namespace
+
+    FrameStatistics::FrameStatistics()
+        : current_frame {}
+        , frame_start {std::nullopt}
+        , allocations {util::getAllocationCounts()}
+        , window {.histograms {}, .slowest_frame {}, .start {}}
+        , run {.histograms {}, .slowest_frame {}, .start {}}
+        , log_interval {getLogIntervalFromEnvironment()}
+    {}
+
+    void FrameStatistics::record(
+        FramePhase phase, std::chrono::steady_clock::duration duration)
+    {
+        this->current_frame[static_cast<std::size_t>(phase) + 1] +=
+            static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+                    .count());
+    }
+
+    void FrameStatistics::endFrame()
+    {
+        const std::chrono::steady_clock::time_point now =
+            std::chrono::steady_clock::now();
+
+        // The first frame would include all of the loading before it
+        if (!this->frame_start.has_value())
+        {
+            this->current_frame = {};
+            this->frame_start   = now;
+            this->allocations   = util::getAllocationCounts();
+            this->window.start  = now;
+            this->run.start     = now;
+
+            return;
+        }
+
+        this->current_frame[0] = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                now - *this->frame_start)
+                .count());
+        this->frame_start = now;
+
+        if constexpr (util::AllocationHooksEnabled)
+        {
+            const util::AllocationCounts counts = util::getAllocationCounts();
+
+            this->current_frame[AllocationsRow] =
+                counts.allocations - this->allocations.allocations;
+            this->current_frame[BytesRow] =
+                counts.bytes - this->allocations.bytes;
+            this->allocations = counts;
+        }
+
+        for (Window* w : {&this->window, &this->run})
+        {
+            for (std::size_t i = 0; i < this->current_frame.size(); ++i)
+            {
+                w->histograms[i].record(this->current_frame[i]);
+            }
+
+            if (this->current_frame[0] > w->slowest_frame[0])
+            {
+                w->slowest_frame = this->current_frame;
+            }
+        }
+
+        this->current_frame = {};
+
+        if (this->log_interval != std::chrono::steady_clock::duration {0}
+            && now - this->window.start >= this->log_interval)
+        {
+            util::logLog(
+                "Frame statistics\n{}", formatWindow(this->window, now));
+
+            this->window = Window {
+                .histograms {}, .slowest_frame {}, .start {now}};
+        }
+    }
+
+    std::string FrameStatistics::formatStatistics() const
+    {
+        return formatWindow(this->run, std::chrono::steady_clock::now());
+    }
+
+    void FrameStatistics::logStatistics() const
+    {
+        util::logLog("Frame statistics\n{}", this->formatStatistics());
+    }
+
+    std::string FrameStatistics::formatWindow(
+        const Window& window, std::chrono::steady_clock::time_point end)
+    {
+        std::string output = fmt::format(
+            "{} frames over {:.1f}s\n{:<14} | {:>9} | {:>9} | {:>9} | {:>9} "
+            "| {:>9}\n",
+            window.histograms[0].getCount(),
+            std::chrono::duration<double> {end - window.start}.count(),
+            "Phase (ms)",
+            "p50",
+            "p95",
+            "p99",
+            "max",
+            "slowest");
+
+        for (std::size_t i = 0; i < AllocationsRow; ++i)
+        {
+            const util::Histogram::Snapshot& h = window.histograms[i];
+
+            fmt::format_to(
+                std::back_inserter(output),
+                "{:<14} | {:9.3f} | {:9.3f} | {:9.3f} | {:9.3f} | {:9.3f}\n",
+                RowNames[i],
+                toMilliseconds(h.getPercentile(50.0)),
+                toMilliseconds(h.getPercentile(95.0)),
+                toMilliseconds(h.getPercentile(99.0)),
+                toMilliseconds(h.getMaximum()),
+                toMilliseconds(window.slowest_frame[i]));
+        }
+
+        if constexpr (util::AllocationHooksEnabled)
+        {
+            for (std::size_t i = AllocationsRow; i < NumberOfRows; ++i)
+            {
+                const util::Histogram::Snapshot& h = window.histograms[i];
+
+                fmt::format_to(
+                    std::back_inserter(output),
+                    "{:<14} | {:>9} | {:>9} | {:>9} | {:>9} | {:>9}\n",
+                    RowNames[i],
+                    h.getPercentile(50.0),
+                    h.getPercentile(95.0),
+                    h.getPercentile(99.0),
+                    h.getMaximum(),
+                    window.slowest_frame[i]);
+            }
+        }
+
+        // No trailing newline
+        output.pop_back();
+
+        return output;
+    }
+} // namespace gfx
@@ -0,0 +1,117 @@
+#ifndef SRC_GFX_FRAME__STATISTICS_HPP
+#define SRC_GFX_FRAME__STATISTICS_HPP
+
+#include <util/allocation.hpp>
+#include <util/statistics.hpp>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace gfx
+{
+    /// Parts of a frame that are timed separately, the rest of the frame is
+    /// only part of its total
+    enum class FramePhase : std::uint8_t
+    {
+        InputPoll,
+        GameTick,
+        Sort,
+        FenceWait,
+        Acquire,
+        CommandRecord,
+        Present,
+    };
+
+    constexpr std::size_t NumberOfFramePhases {7};
+
+    /// Rolling frame time percentiles, overall and per FramePhase
+    ///
+    /// Every window of MANGO_FRAME_STATISTICS seconds is logged as it ends,
+    /// unset or 0 leaves only logStatistics, which covers the whole run. The
+    /// slowest column is the breakdown of the single slowest frame, so that
+    /// a spike can be put down to whatever stalled it. Built with
+    /// MANGO_ALLOCATION_HOOKS the allocations made by every thread during
+    /// each frame are included as well.
+    ///
+    /// Only used from the render thread.
+    class FrameStatistics
+    {
+    public:
+        FrameStatistics();
+        ~FrameStatistics() = default;
+
+        FrameStatistics(const FrameStatistics&)             = delete;
+        FrameStatistics(FrameStatistics&&)                  = delete;
+        FrameStatistics& operator= (const FrameStatistics&) = delete;
+        FrameStatistics& operator= (FrameStatistics&&)      = delete;
+
+        /// Added to the current frame's time in the phase, a phase may be
+        /// hit more than once a frame
+        void record(FramePhase, std::chrono::steady_clock::duration);
+
+        /// The frame's total is the time since the previous call
+        void endFrame();
+
+        [[nodiscard]] std::string formatStatistics() const;
+        void                      logStatistics() const;
+
+    private:
+        /// Frame totals and every FramePhase in nanoseconds, followed by
+        /// the number of allocations and bytes allocated
+        static constexpr std::size_t NumberOfRows {NumberOfFramePhases + 3};
+        static constexpr std::size_t AllocationsRow {NumberOfFramePhases + 1};
+        static constexpr std::size_t BytesRow {NumberOfFramePhases + 2};
+
+        using Histograms = std::array<util::Histogram::Snapshot, NumberOfRows>;
+        using Times = std::array<std::uint64_t, NumberOfRows>;
+
+        struct Window
+        {
+            Histograms                            histograms;
+            Times                                 slowest_frame;
+            std::chrono::steady_clock::time_point start;
+        };
+
+        static std::string formatWindow(
+            const Window&, std::chrono::steady_clock::time_point end);
+
+        Times                                                current_frame;
+        /// Empty until the first endFrame
+        std::optional<std::chrono::steady_clock::time_point> frame_start;
+        util::AllocationCounts                               allocations;
+        Window                                               window;
+        Window                                               run;
+        std::chrono::steady_clock::duration                  log_interval;
+    };
+
+    /// Records the time between its construction and destruction
+    class FramePhaseTimer
+    {
+    public:
+        FramePhaseTimer(FrameStatistics& statistics_, FramePhase phase_)
+            : statistics {statistics_}
+            , phase {phase_}
+            , start {std::chrono::steady_clock::now()}
+        {}
+        ~FramePhaseTimer()
+        {
+            this->statistics.record(
+                this->phase, std::chrono::steady_clock::now() - this->start);
+        }
+
+        FramePhaseTimer(const FramePhaseTimer&)             = delete;
+        FramePhaseTimer(FramePhaseTimer&&)                  = delete;
+        FramePhaseTimer& operator= (const FramePhaseTimer&) = delete;
+        FramePhaseTimer& operator= (FramePhaseTimer&&)      = delete;
+
+    private:
+        FrameStatistics&                      statistics;
+        FramePhase                            phase;
+        std::chrono::steady_clock::time_point start;
+    };
+} // namespace gfx
+
+#endif // SRC_GFX_FRAME__STATISTICS_HPP
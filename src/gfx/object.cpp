@@ -45,7 +45,13 @@ gfx::Object::Object(
           .rotation {1.0f, 0.0f, 0.0f, 0.0f},
           .scale {1.0f, 1.0f, 1.0f}}
 {
-    util::logTrace("Constructed Object | {}", static_cast<std::string>(*this));
+    // The string would be built before logTrace gets to check the level
+    if (util::isLogLevelEnabled(
+            util::Level::Trace, util::SourceLocation::current()))
+    {
+        util::logTrace(
+            "Constructed Object | {}", static_cast<std::string>(*this));
+    }
 }
 
 std::strong_ordering gfx::Object::operator<=> (const Object& other) const
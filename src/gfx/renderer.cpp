@@ -30,6 +30,7 @@ namespace gfx
         , pipeline_map {}
         , render_index {0}
         , frames {nullptr}
+        , frame_statistics {}
     {
         const vk::DynamicLoader         dl;
         const PFN_vkGetInstanceProcAddr dynVkGetInstanceProcAddr =
@@ -130,12 +131,20 @@ namespace gfx
                     camera,
                     this->swapchain->getExtent(),
                     this->pipeline_map,
-                    objects))
+                    objects,
+                    this->frame_statistics))
         {
             this->resize();
         }
 
-        this->window.pollEvents();
+        {
+            FramePhaseTimer timer {
+                this->frame_statistics, FramePhase::InputPoll};
+
+            this->window.pollEvents();
+        }
+
+        this->frame_statistics.endFrame();
     }
 
     void Renderer::resize()
@@ -177,45 +186,30 @@ namespace gfx
         // Pipeline Creation!
         // TODO: replace with magic enum iter?
 
-        std::vector<std::shared_ptr<util::Future<void>>> futures {};
+        using PipelineEntry = std::pair<vulkan::PipelineType, vulkan::Pipeline>;
 
-        auto [sender, receiver] = util::mpmc::create<
-            std::pair<vulkan::PipelineType, vulkan::Pipeline>>();
+        std::vector<util::Future<PipelineEntry>> futures {};
 
-        futures.push_back(util::runAsynchronously<void>(
-            [&]
-            {
-                sender.send(std::make_pair(
-                    vulkan::PipelineType::Flat,
-                    vulkan::createPipeline(
-                        vulkan::PipelineType::Flat,
-                        this->device,
-                        this->render_pass,
-                        this->swapchain)));
-            }));
-
-        futures.push_back(util::runAsynchronously<void>(
-            [&]
-            {
-                sender.send(std::make_pair(
-                    vulkan::PipelineType::Voxel,
-                    vulkan::createPipeline(
-                        vulkan::PipelineType::Voxel,
-                        this->device,
-                        this->render_pass,
-                        this->swapchain)));
-            }));
-
-        for (std::shared_ptr<util::Future<void>>& f : futures)
+        for (vulkan::PipelineType type :
+             {vulkan::PipelineType::Flat, vulkan::PipelineType::Voxel})
         {
-            f->await();
+            futures.push_back(util::runAsynchronously<PipelineEntry>(
+                [this, type]
+                {
+                    return std::make_pair(
+                        type,
+                        vulkan::createPipeline(
+                            type,
+                            this->device,
+                            this->render_pass,
+                            this->swapchain));
+                }));
         }
 
-        while (std::optional<std::pair<vulkan::PipelineType, vulkan::Pipeline>>
-                   receivedPipeline = receiver.receive())
+        // Only wake up once every pipeline has been built
+        for (PipelineEntry& p : util::whenAll(std::move(futures)).await())
         {
-            this->pipeline_map[receivedPipeline->first] =
-                std::move(receivedPipeline->second);
+            this->pipeline_map[p.first] = std::move(p.second);
         }
 
         util::assertFatal(
@@ -265,4 +259,9 @@ namespace gfx
     {
         return this->swapchain->getExtent();
     }
+
+    FrameStatistics& Renderer::getFrameStatistics()
+    {
+        return this->frame_statistics;
+    }
 } // namespace gfx
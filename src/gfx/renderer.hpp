@@ -1,6 +1,7 @@
 #ifndef SRC_GFX_RENDERER_HPP
 #define SRC_GFX_RENDERER_HPP
 
+#include "frame_statistics.hpp"
 #include "object.hpp" // TODO: remove?
 #include "vulkan/pipelines.hpp"
 #include "window.hpp"
@@ -55,6 +56,8 @@ namespace gfx
 
         vk::Extent2D getExtent() const;
 
+        FrameStatistics& getFrameStatistics();
+
     private:
         void resize();
         void initializeRenderer();
@@ -81,6 +84,8 @@ namespace gfx
         static constexpr std::size_t MaxFramesInFlight = 2;
         std::size_t                  render_index;
         std::array<std::unique_ptr<Frame>, MaxFramesInFlight> frames;
+
+        FrameStatistics frame_statistics;
     }; // class Renderer
 } // namespace gfx
 
@@ -272,8 +272,8 @@ namespace gfx::vulkan
     }
 
     void accessFirstAvailableQueue(
-        const std::vector<std::shared_ptr<Queue>>&        queues,
-        std::function<void(vk::Queue, vk::CommandBuffer)> func)
+        const std::vector<std::shared_ptr<Queue>>&            queues,
+        util::FunctionRef<void(vk::Queue, vk::CommandBuffer)> func)
     {
         while (true)
         {
@@ -292,19 +292,19 @@ namespace gfx::vulkan
     }
 
     void Device::accessGraphicsBuffer(
-        std::function<void(vk::Queue, vk::CommandBuffer)> func) const
+        util::FunctionRef<void(vk::Queue, vk::CommandBuffer)> func) const
     {
         accessFirstAvailableQueue(this->graphics_surface_queue, func);
     }
 
     void Device::accessComputeBuffer(
-        std::function<void(vk::Queue, vk::CommandBuffer)> func) const
+        util::FunctionRef<void(vk::Queue, vk::CommandBuffer)> func) const
     {
         accessFirstAvailableQueue(this->compute_queue, func);
     }
 
     void Device::accessTransferBuffer(
-        std::function<void(vk::Queue, vk::CommandBuffer)> func) const
+        util::FunctionRef<void(vk::Queue, vk::CommandBuffer)> func) const
     {
         accessFirstAvailableQueue(this->transfer_queue, func);
     }
@@ -343,10 +343,13 @@ namespace gfx::vulkan
                     device
                         .allocateCommandBuffersUnique(commandBufferAllocateInfo)
                         .at(0)));
+
+        this->queue_buffer_mutex->setStatistics(util::getLockStatistics(
+            fmt::format("Queue family {}", queueFamilyIndex)));
     }
 
     bool Queue::try_access(
-        std::function<void(vk::Queue, vk::CommandBuffer)> func) const
+        util::FunctionRef<void(vk::Queue, vk::CommandBuffer)> func) const
     {
         return this->queue_buffer_mutex->try_lock(
             [&](vk::Queue& queue, vk::UniqueCommandBuffer& commandBuffer)
@@ -4,6 +4,7 @@
 #include "includes.hpp"
 #include <compare>
 #include <memory>
+#include <util/function_ref.hpp>
 #include <util/threads.hpp>
 
 namespace gfx::vulkan
@@ -33,11 +34,11 @@ namespace gfx::vulkan
         [[nodiscard]] vk::PhysicalDevice asPhysicalDevice() const;
 
         void accessGraphicsBuffer(
-            std::function<void(vk::Queue, vk::CommandBuffer)>) const;
+            util::FunctionRef<void(vk::Queue, vk::CommandBuffer)>) const;
         void accessComputeBuffer(
-            std::function<void(vk::Queue, vk::CommandBuffer)>) const;
+            util::FunctionRef<void(vk::Queue, vk::CommandBuffer)>) const;
         void accessTransferBuffer(
-            std::function<void(vk::Queue, vk::CommandBuffer)>) const;
+            util::FunctionRef<void(vk::Queue, vk::CommandBuffer)>) const;
 
     private:
         std::shared_ptr<Instance>           instance;
@@ -70,8 +71,8 @@ namespace gfx::vulkan
 
         /// This function is guaranteed to be finished calling by the time
         /// the access function returns.
-        bool
-            try_access(std::function<void(vk::Queue, vk::CommandBuffer)>) const;
+        bool try_access(
+            util::FunctionRef<void(vk::Queue, vk::CommandBuffer)>) const;
         bool           isInUse() const;
         std::size_t    getNumberOfOperationsSupported() const;
         vk::QueueFlags getFlags() const;
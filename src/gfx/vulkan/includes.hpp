@@ -1,7 +1,9 @@
 #ifndef SRC_RENDER_VULKAN_INCLUDES_HPP
 #define SRC_RENDER_VULKAN_INCLUDES_HPP
 
-// TODO: seperate out into vulkan  / glfw / a and glm includes
+// TODO: seperate out into vulkan  / glfw / a includes
+
+#include <util/glm.hpp>
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Weverything"
@@ -13,21 +15,6 @@
 #include <vulkan/vulkan_beta.h>
 #include <vulkan/vulkan_to_string.hpp>
 
-#define GLM_FORCE_RADIANS
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#include <glm/ext/matrix_clip_space.hpp>
-#include <glm/ext/matrix_transform.hpp>
-#include <glm/ext/scalar_constants.hpp>
-#include <glm/glm.hpp>
-#include <glm/gtc/constants.hpp>
-#include <glm/gtc/quaternion.hpp>
-#include <glm/gtx/quaternion.hpp>
-#include <glm/gtx/string_cast.hpp>
-#include <glm/mat3x3.hpp>
-#include <glm/mat4x4.hpp>
-#include <glm/vec3.hpp>
-#include <glm/vec4.hpp>
-
 #include "GLFW/glfw3.h"
 
 #include <vk_mem_alloc.h>
@@ -5,6 +5,7 @@
 #include "render_pass.hpp"
 #include "swapchain.hpp"
 #include "util/log.hpp"
+#include "util/trace.hpp"
 #include <fstream>
 #include <memory>
 #include <set>
@@ -18,6 +19,8 @@ namespace gfx::vulkan
         std::shared_ptr<RenderPass> renderPass,
         std::shared_ptr<Swapchain>  swapchain)
     {
+        util::TraceZone zone {"vulkan::createPipeline"};
+
         switch (pipeline)
         {
         case PipelineType::None:
@@ -234,11 +237,11 @@ namespace gfx::vulkan
                 .pNext {nullptr},
                 .flags {},
                 .vertexBindingDescriptionCount {1},
-                .pVertexBindingDescriptions {Vertex::getBindingDescription()},
+                .pVertexBindingDescriptions {getVertexBindingDescription()},
                 .vertexAttributeDescriptionCount {static_cast<std::uint32_t>(
-                    Vertex::getAttributeDescriptions()->size())},
+                    getVertexAttributeDescriptions()->size())},
                 .pVertexAttributeDescriptions {
-                    Vertex::getAttributeDescriptions()->data()},
+                    getVertexAttributeDescriptions()->data()},
             };
             break;
         case PipelineVertexType::None:
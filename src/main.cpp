@@ -1,16 +1,33 @@
 #include "game/game.hpp"
 #include "gfx/renderer.hpp"
+#include "util/allocation.hpp"
 #include "util/log.hpp"
 #include "util/matrix.hpp"
 #include "util/threads.hpp"
+#include "util/trace.hpp"
 #include "util/uuid.hpp"
 #include "util/vector.hpp"
+#include <cstdlib>
 #include <stdio.h>
 
 int main()
 {
     util::logLog("mango started");
 
+    // Written out as Chrome trace event JSON on exit
+    if (const char* trace = std::getenv("MANGO_TRACE")) // NOLINT
+    {
+        util::setTraceThreadName("Main");
+        util::startTracing(trace);
+    }
+
+    // Keeps the render thread off of the workers' cores
+    if (!util::getThreadPool().getReservedCpus().empty()
+        && !util::pinCurrentThread(util::getThreadPool().getReservedCpus()))
+    {
+        util::logWarn("Failed to pin the main thread");
+    }
+
     try
     {
         gfx::Renderer renderer {};
@@ -21,11 +38,18 @@ int main()
         {
             game.tick();
         }
+
+        renderer.getFrameStatistics().logStatistics();
+        util::getThreadPool().logStatistics();
+        util::logLockStatistics();
+        util::logAllocationStatistics();
     }
     catch (const std::exception& e)
     {
         util::logFatal("Exception propagated to main {}", e.what());
     }
 
+    util::finishTracing();
+
     util::logLog("mango exited successfully");
 }
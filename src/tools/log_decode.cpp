@@ -0,0 +1,184 @@
+#include "util/log_format.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#include <fmt/core.h>
+#pragma clang diagnostic pop
+
+// Binary log decoder
+//
+// Usage: mango_log_decode <file>
+//
+// Turns a log written with MANGO_BINARY_LOG set back into the same text the
+// logger would have written to stdout. Has to run on a machine with the same
+// byte order as the one that wrote the log.
+
+namespace
+{
+    template<class T>
+    T read(std::span<const std::byte>& bytes)
+    {
+        if (bytes.size() < sizeof(T))
+        {
+            throw std::runtime_error {"Truncated binary log"};
+        }
+
+        T output {};
+
+        std::memcpy(&output, bytes.data(), sizeof(T));
+        bytes = bytes.subspan(sizeof(T));
+
+        return output;
+    }
+
+    std::span<const std::byte>
+    readBytes(std::span<const std::byte>& bytes, std::size_t size)
+    {
+        if (bytes.size() < size)
+        {
+            throw std::runtime_error {"Truncated binary log"};
+        }
+
+        const std::span<const std::byte> output = bytes.first(size);
+        bytes                                   = bytes.subspan(size);
+
+        return output;
+    }
+
+    const std::string& lookup(
+        const std::unordered_map<std::uint32_t, std::string>& strings,
+        std::uint32_t                                         id)
+    {
+        const auto it = strings.find(id);
+
+        if (it == strings.end())
+        {
+            throw std::runtime_error {
+                fmt::format("Undefined string id {}", id)};
+        }
+
+        return it->second;
+    }
+
+    void decode(std::span<const std::byte> bytes)
+    {
+        using util::detail::BinaryLogEntry;
+
+        if (read<std::remove_const_t<
+                decltype(util::detail::BinaryLogMagic)>>(bytes)
+            != util::detail::BinaryLogMagic)
+        {
+            throw std::runtime_error {"Not a binary log"};
+        }
+
+        if (const std::uint32_t version = read<std::uint32_t>(bytes);
+            version != util::detail::BinaryLogVersion)
+        {
+            throw std::runtime_error {
+                fmt::format("Unsupported binary log version {}", version)};
+        }
+
+        std::unordered_map<std::uint32_t, std::string> strings {};
+        util::detail::LineFormatter                    formatter {};
+        std::string                                    output {};
+
+        while (!bytes.empty())
+        {
+            switch (read<BinaryLogEntry>(bytes))
+            {
+            case BinaryLogEntry::StringDefinition: {
+                const std::uint32_t id     = read<std::uint32_t>(bytes);
+                const std::uint32_t length = read<std::uint32_t>(bytes);
+                const std::span<const std::byte> characters =
+                    readBytes(bytes, length);
+
+                strings.insert_or_assign(
+                    id,
+                    std::string {
+                        reinterpret_cast<const char*>( // NOLINT
+                            characters.data()),
+                        characters.size()});
+                break;
+            }
+            case BinaryLogEntry::Record: {
+                const std::int64_t  timestamp = read<std::int64_t>(bytes);
+                const util::Level   level     = read<util::Level>(bytes);
+                const std::uint32_t line      = read<std::uint32_t>(bytes);
+                const std::uint32_t fileId    = read<std::uint32_t>(bytes);
+                const std::uint32_t formatId  = read<std::uint32_t>(bytes);
+                const std::uint8_t  numberOfArguments =
+                    read<std::uint8_t>(bytes);
+                const std::span<const std::byte> arguments =
+                    readBytes(bytes, read<std::uint32_t>(bytes));
+
+                formatter.appendPrefix(
+                    output, timestamp, lookup(strings, fileId), line, level);
+                util::detail::appendArguments(
+                    output,
+                    lookup(strings, formatId),
+                    arguments,
+                    numberOfArguments);
+                output.push_back('\n');
+
+                static_cast<void>(
+                    std::fwrite(output.data(), 1, output.size(), stdout));
+                output.clear();
+                break;
+            }
+            default:
+                throw std::runtime_error {"Invalid binary log entry"};
+            }
+        }
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: mango_log_decode <file>\n";
+
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream file {argv[1], std::ios::binary}; // NOLINT
+
+    if (!file)
+    {
+        std::cerr << "Failed to open " << argv[1] << '\n'; // NOLINT
+
+        return EXIT_FAILURE;
+    }
+
+    const std::vector<char> contents {
+        std::istreambuf_iterator<char> {file},
+        std::istreambuf_iterator<char> {}};
+
+    try
+    {
+        decode(std::as_bytes(std::span {contents}));
+    }
+    catch (const std::exception& e)
+    {
+        // NOLINTNEXTLINE
+        std::cerr << "Failed to decode " << argv[1] << " | " << e.what()
+                  << '\n';
+
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
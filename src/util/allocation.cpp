@@ -0,0 +1,323 @@
+#include "allocation.hpp"
+#include "log.hpp"
+#include "statistics.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <new>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    /// Only written by the thread it belongs to
+    struct ThreadAllocations
+    {
+        std::size_t        index;
+        util::Counter      allocations;
+        util::Counter      bytes;
+        ThreadAllocations* next;
+    };
+
+    /// Newest first, nodes are never removed
+    std::atomic<ThreadAllocations*> allThreadAllocations {nullptr}; // NOLINT
+    std::atomic<std::size_t>        numberOfThreads {0};            // NOLINT
+
+    thread_local ThreadAllocations* currentThreadAllocations {nullptr};
+    thread_local std::uint32_t      allocationFreeDepth {0};
+
+#if MANGO_ALLOCATION_HOOKS
+    enum class CheckMode : std::uint8_t
+    {
+        Warn,
+        Abort,
+    };
+
+    CheckMode getCheckMode()
+    {
+        // Read the first time it's needed, getenv doesn't allocate
+        static const CheckMode mode = []
+        {
+            // NOLINTNEXTLINE: read once at startup
+            const char* value = std::getenv("MANGO_ALLOCATION_CHECK");
+
+            return value != nullptr && std::string_view {value} == "abort"
+                     ? CheckMode::Abort
+                     : CheckMode::Warn;
+        }();
+
+        return mode;
+    }
+
+    /// Called by operator new, so it can't allocate itself. Nodes come from
+    /// malloc and are leaked, threads may be counted up until they exit.
+    ThreadAllocations& getThreadAllocations()
+    {
+        if (currentThreadAllocations == nullptr)
+        {
+            void* memory = std::malloc(sizeof(ThreadAllocations)); // NOLINT
+
+            if (memory == nullptr)
+            {
+                throw std::bad_alloc {};
+            }
+
+            ThreadAllocations* node = ::new (memory) ThreadAllocations {
+                .index {numberOfThreads.fetch_add(1)},
+                .allocations {},
+                .bytes {},
+                .next {allThreadAllocations.load()}};
+
+            while (!allThreadAllocations.compare_exchange_weak(
+                node->next, node))
+            {}
+
+            currentThreadAllocations = node;
+        }
+
+        return *currentThreadAllocations;
+    }
+
+    void* countedAllocate(std::size_t size, std::align_val_t alignment)
+    {
+        ThreadAllocations& counts = getThreadAllocations();
+
+        counts.allocations.add();
+        counts.bytes.add(size);
+
+        if (allocationFreeDepth != 0 && getCheckMode() == CheckMode::Abort)
+        {
+            static_cast<void>(std::fputs(
+                "Allocation inside of a util::AllocationFreeScope\n", stderr));
+
+            std::abort();
+        }
+
+        const std::size_t align = static_cast<std::size_t>(alignment);
+
+        void* output {nullptr};
+
+        if (align <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        {
+            output = std::malloc(std::max<std::size_t>(size, 1)); // NOLINT
+        }
+        else
+        {
+#ifdef _WIN32
+            output = ::_aligned_malloc(std::max<std::size_t>(size, 1), align);
+#else
+            // aligned_alloc requires the size to be a multiple of the
+            // alignment
+            output = std::aligned_alloc(
+                align,
+                (std::max<std::size_t>(size, 1) + align - 1) / align * align);
+#endif // _WIN32
+        }
+
+        if (output == nullptr)
+        {
+            throw std::bad_alloc {};
+        }
+
+        return output;
+    }
+
+    void countedFree(void* pointer, std::align_val_t alignment) noexcept
+    {
+#ifdef _WIN32
+        if (static_cast<std::size_t>(alignment)
+            > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        {
+            ::_aligned_free(pointer);
+
+            return;
+        }
+#else
+        static_cast<void>(alignment);
+#endif // _WIN32
+
+        std::free(pointer); // NOLINT
+    }
+#endif // MANGO_ALLOCATION_HOOKS
+} // namespace
+
+#if MANGO_ALLOCATION_HOOKS
+constexpr std::align_val_t DefaultNewAlignment {
+    __STDCPP_DEFAULT_NEW_ALIGNMENT__};
+
+void* operator new (std::size_t size)
+{
+    return countedAllocate(size, DefaultNewAlignment);
+}
+
+void* operator new[] (std::size_t size)
+{
+    return countedAllocate(size, DefaultNewAlignment);
+}
+
+void* operator new (std::size_t size, std::align_val_t alignment)
+{
+    return countedAllocate(size, alignment);
+}
+
+void* operator new[] (std::size_t size, std::align_val_t alignment)
+{
+    return countedAllocate(size, alignment);
+}
+
+void operator delete (void* pointer) noexcept
+{
+    countedFree(pointer, DefaultNewAlignment);
+}
+
+void operator delete[] (void* pointer) noexcept
+{
+    countedFree(pointer, DefaultNewAlignment);
+}
+
+void operator delete (void* pointer, std::size_t) noexcept
+{
+    countedFree(pointer, DefaultNewAlignment);
+}
+
+void operator delete[] (void* pointer, std::size_t) noexcept
+{
+    countedFree(pointer, DefaultNewAlignment);
+}
+
+void operator delete (void* pointer, std::align_val_t alignment) noexcept
+{
+    countedFree(pointer, alignment);
+}
+
+void operator delete[] (void* pointer, std::align_val_t alignment) noexcept
+{
+    countedFree(pointer, alignment);
+}
+
+void operator delete (
+    void* pointer, std::size_t, std::align_val_t alignment) noexcept
+{
+    countedFree(pointer, alignment);
+}
+
+void operator delete[] (
+    void* pointer, std::size_t, std::align_val_t alignment) noexcept
+{
+    countedFree(pointer, alignment);
+}
+#endif // MANGO_ALLOCATION_HOOKS
+
+util::AllocationCounts util::getThreadAllocationCounts()
+{
+    if (currentThreadAllocations == nullptr)
+    {
+        return AllocationCounts {.allocations {0}, .bytes {0}};
+    }
+
+    return AllocationCounts {
+        .allocations {currentThreadAllocations->allocations.get()},
+        .bytes {currentThreadAllocations->bytes.get()}};
+}
+
+util::AllocationCounts util::getAllocationCounts()
+{
+    AllocationCounts output {.allocations {0}, .bytes {0}};
+
+    for (const ThreadAllocations* t = allThreadAllocations.load();
+         t != nullptr;
+         t = t->next)
+    {
+        output.allocations += t->allocations.get();
+        output.bytes += t->bytes.get();
+    }
+
+    return output;
+}
+
+std::string util::formatAllocationStatistics()
+{
+    if constexpr (!AllocationHooksEnabled)
+    {
+        return "Not counted, built with MANGO_ALLOCATION_HOOKS=0";
+    }
+
+    std::vector<const ThreadAllocations*> threads {};
+
+    for (const ThreadAllocations* t = allThreadAllocations.load();
+         t != nullptr;
+         t = t->next)
+    {
+        threads.push_back(t);
+    }
+
+    std::ranges::sort(
+        threads,
+        [](const ThreadAllocations* l, const ThreadAllocations* r)
+        {
+            return l->index < r->index;
+        });
+
+    std::string output {};
+
+    for (const ThreadAllocations* t : threads)
+    {
+        fmt::format_to(
+            std::back_inserter(output),
+            "Thread {:>3} | Allocations: {:>12} | Bytes: {:>14}\n",
+            t->index,
+            t->allocations.get(),
+            t->bytes.get());
+    }
+
+    const AllocationCounts total = getAllocationCounts();
+
+    fmt::format_to(
+        std::back_inserter(output),
+        "Total      | Allocations: {:>12} | Bytes: {:>14}",
+        total.allocations,
+        total.bytes);
+
+    return output;
+}
+
+void util::logAllocationStatistics()
+{
+    util::logLog("Allocation statistics\n{}", formatAllocationStatistics());
+}
+
+util::AllocationFreeScope::AllocationFreeScope(
+    const char* name_, bool enabled_)
+    : name {name_}
+    , enabled {enabled_ && AllocationHooksEnabled}
+    , start {getThreadAllocationCounts()}
+{
+    if (this->enabled)
+    {
+        ++allocationFreeDepth;
+    }
+}
+
+util::AllocationFreeScope::~AllocationFreeScope()
+{
+    if (!this->enabled)
+    {
+        return;
+    }
+
+    --allocationFreeDepth;
+
+    const AllocationCounts end = getThreadAllocationCounts();
+
+    if (end.allocations != this->start.allocations)
+    {
+        util::logWarn(
+            "{} allocations totalling {} bytes in allocation free scope {}",
+            end.allocations - this->start.allocations,
+            end.bytes - this->start.bytes,
+            this->name);
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef SRC_UTIL_ALLOCATION_HPP
+#define SRC_UTIL_ALLOCATION_HPP
+
+#include <cstdint>
+#include <string>
+
+// Opt in heap allocation counting
+//
+// Built with MANGO_ALLOCATION_HOOKS=1 the global operator new and delete are
+// replaced with ones that count every allocation and its size on the thread
+// that made it. Otherwise nothing is replaced, every count is zero and
+// AllocationFreeScope does nothing.
+
+#ifndef MANGO_ALLOCATION_HOOKS
+#define MANGO_ALLOCATION_HOOKS 0
+#endif // MANGO_ALLOCATION_HOOKS
+
+namespace util
+{
+    constexpr bool AllocationHooksEnabled {MANGO_ALLOCATION_HOOKS != 0};
+
+    struct AllocationCounts
+    {
+        std::uint64_t allocations;
+        std::uint64_t bytes;
+    };
+
+    /// Made by the calling thread since it started
+    [[nodiscard]] AllocationCounts getThreadAllocationCounts();
+
+    /// Made by every thread since the program started
+    [[nodiscard]] AllocationCounts getAllocationCounts();
+
+    /// Totals of every thread that has allocated, one thread per line
+    [[nodiscard]] std::string formatAllocationStatistics();
+    void                      logAllocationStatistics();
+
+    /// Flags every allocation the calling thread makes while this is alive
+    ///
+    /// Warns on destruction with how many there were. With
+    /// MANGO_ALLOCATION_CHECK=abort the first one aborts from inside of
+    /// operator new instead, so that a debugger or core dump shows where it
+    /// came from. Scopes may be nested.
+    class AllocationFreeScope
+    {
+    public:
+        /// Name has to have static storage duration, a disabled scope does
+        /// nothing
+        explicit AllocationFreeScope(const char* name, bool enabled = true);
+        ~AllocationFreeScope();
+
+        AllocationFreeScope(const AllocationFreeScope&)             = delete;
+        AllocationFreeScope(AllocationFreeScope&&)                  = delete;
+        AllocationFreeScope& operator= (const AllocationFreeScope&) = delete;
+        AllocationFreeScope& operator= (AllocationFreeScope&&)      = delete;
+
+    private:
+        const char*      name;
+        bool             enabled;
+        AllocationCounts start;
+    };
+} // namespace util
+
+#endif // SRC_UTIL_ALLOCATION_HPP
@@ -0,0 +1,158 @@
+#ifndef SRC_UTIL_BLOCK__POOL_HPP
+#define SRC_UTIL_BLOCK__POOL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace util
+{
+    /// Recycles blocks of memory of a single size so that objects which are
+    /// created and destroyed constantly (jobs, future states) stop hitting
+    /// the heap once the program reaches a steady state
+    ///
+    /// Every thread keeps a small cache of free blocks and only touches the
+    /// shared list, under a mutex, to move half a cache's worth at a time.
+    /// Blocks are never returned to the system.
+    template<std::size_t Size, std::size_t Alignment>
+    class BlockPool
+    {
+    public:
+        [[nodiscard]] static void* allocate()
+        {
+            ThreadCache& cache = getThreadCache();
+
+            if (cache.head == nullptr)
+            {
+                cache.refill();
+            }
+
+            if (cache.head == nullptr)
+            {
+                return ::operator new (BlockSize, std::align_val_t {Alignment});
+            }
+
+            Node* output = cache.head;
+
+            cache.head = output->next;
+            --cache.count;
+
+            return output;
+        }
+
+        static void deallocate(void* block) noexcept
+        {
+            ThreadCache& cache = getThreadCache();
+
+            Node* node = ::new (block) Node {.next {cache.head}};
+
+            cache.head = node;
+            ++cache.count;
+
+            if (cache.count >= CacheCapacity)
+            {
+                cache.spill(CacheCapacity / 2);
+            }
+        }
+
+    private:
+        struct Node
+        {
+            Node* next;
+        };
+
+        static constexpr std::size_t BlockSize {
+            (std::max(Size, sizeof(Node)) + Alignment - 1) / Alignment
+            * Alignment};
+
+        static constexpr std::size_t CacheCapacity {64};
+
+        struct SharedList
+        {
+            std::mutex  mutex;
+            Node*       head {nullptr};
+            std::size_t count {0};
+        };
+
+        // Intentionally leaked, thread caches are flushed into it while
+        // threads exit, which may be after static destructors have run
+        static SharedList& getSharedList()
+        {
+            static SharedList* list = new SharedList {}; // NOLINT
+
+            return *list;
+        }
+
+        struct ThreadCache
+        {
+            ThreadCache() = default;
+            ~ThreadCache()
+            {
+                this->spill(this->count);
+            }
+
+            ThreadCache(const ThreadCache&)             = delete;
+            ThreadCache(ThreadCache&&)                  = delete;
+            ThreadCache& operator= (const ThreadCache&) = delete;
+            ThreadCache& operator= (ThreadCache&&)      = delete;
+
+            void refill()
+            {
+                SharedList&      shared = getSharedList();
+                std::unique_lock lock {shared.mutex};
+
+                while (shared.head != nullptr
+                       && this->count < CacheCapacity / 2)
+                {
+                    Node* node  = shared.head;
+                    shared.head = node->next;
+                    --shared.count;
+
+                    node->next = this->head;
+                    this->head = node;
+                    ++this->count;
+                }
+            }
+
+            void spill(std::size_t numberOfBlocks)
+            {
+                if (numberOfBlocks == 0)
+                {
+                    return;
+                }
+
+                // Unlink the blocks before taking the lock
+                Node* first = this->head;
+                Node* last  = first;
+
+                for (std::size_t i = 1; i < numberOfBlocks; ++i)
+                {
+                    last = last->next;
+                }
+
+                this->head = last->next;
+                this->count -= numberOfBlocks;
+
+                SharedList&      shared = getSharedList();
+                std::unique_lock lock {shared.mutex};
+
+                last->next  = shared.head;
+                shared.head = first;
+                shared.count += numberOfBlocks;
+            }
+
+            Node*       head {nullptr};
+            std::size_t count {0};
+        };
+
+        static ThreadCache& getThreadCache()
+        {
+            thread_local ThreadCache cache {};
+
+            return cache;
+        }
+    };
+} // namespace util
+
+#endif // SRC_UTIL_BLOCK__POOL_HPP
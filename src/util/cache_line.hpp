@@ -0,0 +1,16 @@
+#ifndef SRC_UTIL_CACHE__LINE_HPP
+#define SRC_UTIL_CACHE__LINE_HPP
+
+#include <cstddef>
+
+namespace util
+{
+    /// Alignment that keeps atomics written by different threads from sharing
+    /// a cache line
+    ///
+    /// std::hardware_destructive_interference_size isn't available everywhere
+    /// yet.
+    constexpr std::size_t CacheLineSize {64};
+} // namespace util
+
+#endif // SRC_UTIL_CACHE__LINE_HPP
@@ -0,0 +1,738 @@
+#ifndef SRC_UTIL_CHANNEL_HPP
+#define SRC_UTIL_CHANNEL_HPP
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#include "concurrentqueue.h"
+#pragma clang diagnostic pop
+
+#include "cache_line.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace util
+{
+    /// Channels hold values that can be default constructed and move
+    /// assigned, as receiving assigns into existing storage
+    template<class T>
+    concept Sendable =
+        std::is_default_constructible_v<T> && std::is_move_assignable_v<T>;
+
+    namespace detail
+    {
+        /// Lets threads sleep until a condition becomes true without costing
+        /// the threads that make it true anything while nobody is asleep
+        ///
+        /// Whatever the predicate reads must be changed before notify is
+        /// called. notify reads waiting with a read modify write, so either
+        /// it comes after a waiter's increment and sees it, or the increment
+        /// reads what notify wrote and the waiter sees the change.
+        class WaitList
+        {
+        public:
+            WaitList()
+                : mutex {}
+                , condition {}
+                , waiting {0}
+            {}
+            ~WaitList() = default;
+
+            WaitList(const WaitList&)             = delete;
+            WaitList(WaitList&&)                  = delete;
+            WaitList& operator= (const WaitList&) = delete;
+            WaitList& operator= (WaitList&&)      = delete;
+
+            template<class P>
+            void wait(P predicate)
+            {
+                if (predicate())
+                {
+                    return;
+                }
+
+                std::unique_lock lock {this->mutex};
+
+                this->waiting.fetch_add(1);
+                this->condition.wait(lock, predicate);
+                this->waiting.fetch_sub(1);
+            }
+
+            /// Returns false if deadline passed with predicate still false
+            template<class P>
+            bool waitUntil(
+                P predicate, std::chrono::steady_clock::time_point deadline)
+            {
+                if (predicate())
+                {
+                    return true;
+                }
+
+                std::unique_lock lock {this->mutex};
+
+                this->waiting.fetch_add(1);
+                const bool output =
+                    this->condition.wait_until(lock, deadline, predicate);
+                this->waiting.fetch_sub(1);
+
+                return output;
+            }
+
+            /// Wakes one waiter if count is 1, otherwise every waiter
+            void notify(std::size_t count)
+            {
+                if (this->waiting.fetch_add(0) == 0)
+                {
+                    return;
+                }
+
+                // Waiters are either before their predicate check, and will
+                // see the change, or inside of wait and will be woken
+                {
+                    std::unique_lock lock {this->mutex};
+                }
+
+                if (count == 1)
+                {
+                    this->condition.notify_one();
+                }
+                else
+                {
+                    this->condition.notify_all();
+                }
+            }
+
+            void notifyAll()
+            {
+                this->notify(std::numeric_limits<std::size_t>::max());
+            }
+
+        private:
+            std::mutex               mutex;
+            std::condition_variable  condition;
+            std::atomic<std::size_t> waiting;
+        };
+
+        /// Bounded or unbounded moodycamel::ConcurrentQueue
+        ///
+        /// Senders reserve capacity before they enqueue and receivers claim
+        /// items from available before they dequeue, so a claimed item is
+        /// always there to be dequeued and a full channel never grows.
+        template<Sendable T>
+        class MpmcChannel
+        {
+        public:
+            using Value = T;
+
+            static constexpr bool MultipleProducers {true};
+            static constexpr std::size_t Unbounded {
+                std::numeric_limits<std::size_t>::max()};
+
+            explicit MpmcChannel(std::size_t capacity_)
+                : senders {}
+                , receivers {}
+                // Preallocates all of a small channel, up to what moodycamel
+                // would by default
+                , queue {std::min<std::size_t>(capacity_, 1024)}
+                , capacity {capacity_}
+                , reserved {0}
+                , available {0}
+                , closed {false}
+            {}
+
+            /// Moves out of as many of items as there is space for, returns
+            /// how many that was
+            std::size_t pushSome(std::span<T> items)
+            {
+                if (items.empty() || this->isClosed())
+                {
+                    return 0;
+                }
+
+                std::size_t count = items.size();
+
+                if (this->capacity != Unbounded)
+                {
+                    std::size_t current = this->reserved.load();
+
+                    do
+                    {
+                        count =
+                            std::min(items.size(), this->capacity - current);
+
+                        if (count == 0)
+                        {
+                            return 0;
+                        }
+                    }
+                    while (!this->reserved.compare_exchange_weak(
+                        current, current + count));
+                }
+
+                const bool enqueued =
+                    count == 1 ? this->queue.enqueue(std::move(items[0]))
+                               : this->queue.enqueue_bulk(
+                                   std::make_move_iterator(items.begin()),
+                                   count);
+
+                if (!enqueued)
+                {
+                    throw std::bad_alloc {};
+                }
+
+                this->available.fetch_add(count);
+                this->receivers.notify(count);
+
+                return count;
+            }
+
+            /// Assigns up to output.size() items to output, returns how many
+            std::size_t popSome(std::span<T> output)
+            {
+                std::size_t current = this->available.load();
+                std::size_t count {0};
+
+                do
+                {
+                    count = std::min(current, output.size());
+
+                    if (count == 0)
+                    {
+                        return 0;
+                    }
+                }
+                while (!this->available.compare_exchange_weak(
+                    current, current - count));
+
+                // Can briefly fail while another thread is partway through
+                // an enqueue, the claimed items are guaranteed to be there
+                for (std::size_t dequeued = 0; dequeued < count;)
+                {
+                    dequeued += this->queue.try_dequeue_bulk(
+                        output.begin() + static_cast<std::ptrdiff_t>(dequeued),
+                        count - dequeued);
+                }
+
+                if (this->capacity != Unbounded)
+                {
+                    this->reserved.fetch_sub(count);
+                    this->senders.notify(count);
+                }
+
+                return count;
+            }
+
+            [[nodiscard]] bool hasSpace() const
+            {
+                return this->capacity == Unbounded
+                    || this->reserved.load() < this->capacity;
+            }
+
+            [[nodiscard]] bool hasItems() const
+            {
+                return this->available.load() != 0;
+            }
+
+            [[nodiscard]] std::size_t getSize() const
+            {
+                return this->available.load();
+            }
+
+            [[nodiscard]] bool isClosed() const
+            {
+                return this->closed.load();
+            }
+
+            void close()
+            {
+                this->closed.store(true);
+
+                this->senders.notifyAll();
+                this->receivers.notifyAll();
+            }
+
+            WaitList senders;
+            WaitList receivers;
+
+        private:
+            moodycamel::ConcurrentQueue<T> queue;
+            std::size_t                    capacity;
+            std::atomic<std::size_t>       reserved;
+            std::atomic<std::size_t>       available;
+            std::atomic<bool>              closed;
+        };
+
+        /// Fixed size ring buffer with one sender and one receiver
+        ///
+        /// Each side keeps a cached copy of the other side's index and only
+        /// reloads it once the cached copy says the ring is full or empty.
+        template<Sendable T>
+        class SpscChannel
+        {
+        public:
+            using Value = T;
+
+            static constexpr bool MultipleProducers {false};
+
+            explicit SpscChannel(std::size_t capacity)
+                : senders {}
+                , receivers {}
+                , buffer {std::make_unique<T[]>(std::bit_ceil(capacity))}
+                , mask {std::bit_ceil(capacity) - 1}
+                , closed {false}
+                , head {0}
+                , cached_tail {0}
+                , tail {0}
+                , cached_head {0}
+            {}
+
+            /// Sender only
+            std::size_t pushSome(std::span<T> items)
+            {
+                if (this->isClosed())
+                {
+                    return 0;
+                }
+
+                const std::size_t current =
+                    this->tail.load(std::memory_order_relaxed);
+
+                if (this->getFree(current) < items.size())
+                {
+                    this->cached_head =
+                        this->head.load(std::memory_order_acquire);
+                }
+
+                const std::size_t count =
+                    std::min(items.size(), this->getFree(current));
+
+                if (count == 0)
+                {
+                    return 0;
+                }
+
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    this->buffer[(current + i) & this->mask] =
+                        std::move(items[i]);
+                }
+
+                this->tail.store(current + count, std::memory_order_release);
+                this->receivers.notify(count);
+
+                return count;
+            }
+
+            /// Receiver only
+            std::size_t popSome(std::span<T> output)
+            {
+                const std::size_t current =
+                    this->head.load(std::memory_order_relaxed);
+
+                if (this->cached_tail - current < output.size())
+                {
+                    this->cached_tail =
+                        this->tail.load(std::memory_order_acquire);
+                }
+
+                const std::size_t count =
+                    std::min(output.size(), this->cached_tail - current);
+
+                if (count == 0)
+                {
+                    return 0;
+                }
+
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    output[i] =
+                        std::move(this->buffer[(current + i) & this->mask]);
+                }
+
+                this->head.store(current + count, std::memory_order_release);
+                this->senders.notify(count);
+
+                return count;
+            }
+
+            [[nodiscard]] bool hasSpace() const
+            {
+                return this->tail.load() - this->head.load() <= this->mask;
+            }
+
+            [[nodiscard]] bool hasItems() const
+            {
+                return this->tail.load() != this->head.load();
+            }
+
+            [[nodiscard]] std::size_t getSize() const
+            {
+                return this->tail.load() - this->head.load();
+            }
+
+            [[nodiscard]] bool isClosed() const
+            {
+                return this->closed.load();
+            }
+
+            void close()
+            {
+                this->closed.store(true);
+
+                this->senders.notifyAll();
+                this->receivers.notifyAll();
+            }
+
+            WaitList senders;
+            WaitList receivers;
+
+        private:
+            [[nodiscard]] std::size_t getFree(std::size_t currentTail) const
+            {
+                return this->mask + 1 - (currentTail - this->cached_head);
+            }
+
+            std::unique_ptr<T[]> buffer;
+            std::size_t          mask;
+            std::atomic<bool>    closed;
+
+            // Written by the receiver
+            alignas(CacheLineSize) std::atomic<std::size_t> head;
+            std::size_t                                     cached_tail;
+
+            // Written by the sender
+            alignas(CacheLineSize) std::atomic<std::size_t> tail;
+            std::size_t                                     cached_head;
+        };
+
+        /// Sends items, waiting for space until deadline, returns how many
+        /// were sent
+        template<class C>
+        std::size_t sendUntil(
+            C&                                                   channel,
+            std::span<typename C::Value>                         items,
+            std::optional<std::chrono::steady_clock::time_point> deadline)
+        {
+            std::size_t sent {0};
+
+            while (true)
+            {
+                sent += channel.pushSome(items.subspan(sent));
+
+                if (sent == items.size() || channel.isClosed())
+                {
+                    return sent;
+                }
+
+                const auto ready = [&]
+                {
+                    return channel.isClosed() || channel.hasSpace();
+                };
+
+                if (!deadline.has_value())
+                {
+                    channel.senders.wait(ready);
+                }
+                else if (!channel.senders.waitUntil(ready, *deadline))
+                {
+                    return sent;
+                }
+            }
+        }
+
+        /// Waits until deadline for at least one item, returns how many were
+        /// received. Only returns 0 once deadline has passed or the channel
+        /// is closed and empty.
+        template<class C>
+        std::size_t receiveUntil(
+            C&                                                   channel,
+            std::span<typename C::Value>                         output,
+            std::optional<std::chrono::steady_clock::time_point> deadline)
+        {
+            while (true)
+            {
+                if (const std::size_t count = channel.popSome(output);
+                    count != 0)
+                {
+                    return count;
+                }
+
+                // Closing doesn't drop anything that was sent before it
+                if (channel.isClosed())
+                {
+                    return channel.popSome(output);
+                }
+
+                const auto ready = [&]
+                {
+                    return channel.isClosed() || channel.hasItems();
+                };
+
+                if (!deadline.has_value())
+                {
+                    channel.receivers.wait(ready);
+                }
+                else if (!channel.receivers.waitUntil(ready, *deadline))
+                {
+                    return 0;
+                }
+            }
+        }
+
+        template<class Rep, class Period>
+        std::chrono::steady_clock::time_point
+        getDeadline(std::chrono::duration<Rep, Period> timeout)
+        {
+            return std::chrono::steady_clock::now()
+                 + std::chrono::duration_cast<
+                       std::chrono::steady_clock::duration>(timeout);
+        }
+
+        /// Sending half of a channel
+        ///
+        /// Copyable if the channel allows multiple producers, otherwise
+        /// move only so that there can only ever be one
+        template<class C>
+        class ChannelSender
+        {
+        public:
+            using T = typename C::Value;
+        public:
+            explicit ChannelSender(std::shared_ptr<C> channel_)
+                : channel {std::move(channel_)}
+            {}
+            ~ChannelSender() = default;
+
+            ChannelSender(const ChannelSender&)
+                requires C::MultipleProducers
+            = default;
+            ChannelSender(ChannelSender&&) = default;
+            ChannelSender& operator= (const ChannelSender&)
+                requires C::MultipleProducers
+            = default;
+            ChannelSender& operator= (ChannelSender&&) = default;
+
+            /// Blocks while the channel is full, returns false without
+            /// touching t if the channel has been closed
+            [[nodiscard]] bool send(T&& t) const
+            {
+                return detail::sendUntil(
+                           *this->channel, std::span<T> {&t, 1}, std::nullopt)
+                    == 1;
+            }
+
+            /// Returns false without touching t if the channel is full or
+            /// has been closed
+            [[nodiscard]] bool trySend(T&& t) const
+            {
+                return this->channel->pushSome(std::span<T> {&t, 1}) == 1;
+            }
+
+            template<class Rep, class Period>
+            [[nodiscard]] bool
+            sendFor(T&& t, std::chrono::duration<Rep, Period> timeout) const
+            {
+                return detail::sendUntil(
+                           *this->channel,
+                           std::span<T> {&t, 1},
+                           detail::getDeadline(timeout))
+                    == 1;
+            }
+
+            /// Moves out of every item, blocking whenever the channel is
+            /// full. Returns how many were sent, which is only less than
+            /// items.size() if the channel was closed.
+            std::size_t sendBulk(std::span<T> items) const
+            {
+                return detail::sendUntil(*this->channel, items, std::nullopt);
+            }
+
+            /// Moves out of as many items as there is space for
+            std::size_t trySendBulk(std::span<T> items) const
+            {
+                return this->channel->pushSome(items);
+            }
+
+            /// Fails every send from now on, receivers still get everything
+            /// that was sent before
+            void close() const
+            {
+                this->channel->close();
+            }
+
+            [[nodiscard]] bool isClosed() const
+            {
+                return this->channel->isClosed();
+            }
+
+        private:
+            std::shared_ptr<C> channel;
+        };
+
+        /// Receiving half of a channel, see ChannelSender
+        template<class C>
+        class ChannelReceiver
+        {
+        public:
+            using T = typename C::Value;
+        public:
+            explicit ChannelReceiver(std::shared_ptr<C> channel_)
+                : channel {std::move(channel_)}
+            {}
+            ~ChannelReceiver() = default;
+
+            ChannelReceiver(const ChannelReceiver&)
+                requires C::MultipleProducers
+            = default;
+            ChannelReceiver(ChannelReceiver&&) = default;
+            ChannelReceiver& operator= (const ChannelReceiver&)
+                requires C::MultipleProducers
+            = default;
+            ChannelReceiver& operator= (ChannelReceiver&&) = default;
+
+            /// Blocks until there's an item, returns std::nullopt once the
+            /// channel is closed and empty
+            [[nodiscard]] std::optional<T> receive() const
+            {
+                return this->receiveOne(std::nullopt);
+            }
+
+            [[nodiscard]] std::optional<T> tryReceive() const
+            {
+                T output {};
+
+                if (this->channel->popSome(std::span<T> {&output, 1}) == 0)
+                {
+                    return std::nullopt;
+                }
+
+                return output;
+            }
+
+            template<class Rep, class Period>
+            [[nodiscard]] std::optional<T>
+            receiveFor(std::chrono::duration<Rep, Period> timeout) const
+            {
+                return this->receiveOne(detail::getDeadline(timeout));
+            }
+
+            /// Blocks until there's at least one item, fills as much of
+            /// output as it can and returns how many items that was. Returns
+            /// 0 once the channel is closed and empty.
+            std::size_t receiveBulk(std::span<T> output) const
+            {
+                return detail::receiveUntil(
+                    *this->channel, output, std::nullopt);
+            }
+
+            std::size_t tryReceiveBulk(std::span<T> output) const
+            {
+                return this->channel->popSome(output);
+            }
+
+            template<class Rep, class Period>
+            std::size_t receiveBulkFor(
+                std::span<T>                       output,
+                std::chrono::duration<Rep, Period> timeout) const
+            {
+                return detail::receiveUntil(
+                    *this->channel, output, detail::getDeadline(timeout));
+            }
+
+            /// Approximate number of items waiting to be received
+            [[nodiscard]] std::size_t getSize() const
+            {
+                return this->channel->getSize();
+            }
+
+            void close() const
+            {
+                this->channel->close();
+            }
+
+            [[nodiscard]] bool isClosed() const
+            {
+                return this->channel->isClosed();
+            }
+
+        private:
+            std::optional<T> receiveOne(
+                std::optional<std::chrono::steady_clock::time_point> deadline)
+                const
+            {
+                T output {};
+
+                if (detail::receiveUntil(
+                        *this->channel, std::span<T> {&output, 1}, deadline)
+                    == 0)
+                {
+                    return std::nullopt;
+                }
+
+                return output;
+            }
+
+            std::shared_ptr<C> channel;
+        };
+    } // namespace detail
+
+    namespace mpmc
+    {
+        template<class T>
+        using Sender = detail::ChannelSender<detail::MpmcChannel<T>>;
+
+        template<class T>
+        using Receiver = detail::ChannelReceiver<detail::MpmcChannel<T>>;
+
+        constexpr std::size_t Unbounded {
+            detail::MpmcChannel<int>::Unbounded};
+
+        /// Channel with any number of senders and receivers
+        ///
+        /// Once capacity items are waiting to be received, send blocks and
+        /// trySend fails until some of them are, which is what keeps a fast
+        /// producer from using up all of memory.
+        template<Sendable T>
+        std::pair<Sender<T>, Receiver<T>> create(std::size_t capacity)
+        {
+            auto channel = std::make_shared<detail::MpmcChannel<T>>(capacity);
+
+            return {Sender<T> {channel}, Receiver<T> {std::move(channel)}};
+        }
+    } // namespace mpmc
+
+    namespace spsc
+    {
+        template<class T>
+        using Sender = detail::ChannelSender<detail::SpscChannel<T>>;
+
+        template<class T>
+        using Receiver = detail::ChannelReceiver<detail::SpscChannel<T>>;
+
+        /// Channel with exactly one sender and one receiver, both of which
+        /// are move only. Cheaper than mpmc as neither side ever needs a
+        /// compare exchange. capacity is rounded up to a power of two.
+        template<Sendable T>
+        std::pair<Sender<T>, Receiver<T>> create(std::size_t capacity)
+        {
+            auto channel = std::make_shared<detail::SpscChannel<T>>(
+                std::max<std::size_t>(capacity, 1));
+
+            return {Sender<T> {channel}, Receiver<T> {std::move(channel)}};
+        }
+    } // namespace spsc
+} // namespace util
+
+#endif // SRC_UTIL_CHANNEL_HPP
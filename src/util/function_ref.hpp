@@ -0,0 +1,55 @@
+#ifndef SRC_UTIL_FUNCTION__REF_HPP
+#define SRC_UTIL_FUNCTION__REF_HPP
+
+#include <concepts>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace util
+{
+    template<class Signature>
+    class FunctionRef;
+
+    /// Non owning reference to a callable, for parameters that are only
+    /// called before the function they're passed to returns
+    ///
+    /// Unlike std::function it never allocates, no matter how much a lambda
+    /// captures. The callable it's made from has to outlive it.
+    template<class R, class... Args>
+    class FunctionRef<R(Args...)>
+    {
+    public:
+        template<class F>
+            requires (!std::same_as<std::remove_cvref_t<F>, FunctionRef>)
+                  && std::is_invocable_r_v<R, F&, Args...>
+        FunctionRef(F&& func) // NOLINT: implicit conversions are wanted
+            : callable {const_cast<void*>( // NOLINT: only cast back to F
+                static_cast<const void*>(std::addressof(func)))}
+            , invoke {[](void* c, Args... args) -> R
+                      {
+                          return std::invoke(
+                              *static_cast<std::remove_reference_t<F>*>(c),
+                              std::forward<Args>(args)...);
+                      }}
+        {}
+        ~FunctionRef() = default;
+
+        FunctionRef(const FunctionRef&)             = default;
+        FunctionRef(FunctionRef&&)                  = default;
+        FunctionRef& operator= (const FunctionRef&) = default;
+        FunctionRef& operator= (FunctionRef&&)      = default;
+
+        R operator() (Args... args) const
+        {
+            return this->invoke(this->callable, std::forward<Args>(args)...);
+        }
+
+    private:
+        void* callable;
+        R (*invoke)(void*, Args...);
+    };
+} // namespace util
+
+#endif // SRC_UTIL_FUNCTION__REF_HPP
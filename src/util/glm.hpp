@@ -0,0 +1,29 @@
+#ifndef SRC_UTIL_GLM_HPP
+#define SRC_UTIL_GLM_HPP
+
+// glm with the configuration every target is built with, the defines have to
+// match in every translation unit
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+// clang-format off
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/scalar_constants.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtx/string_cast.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+// clang-format on
+#pragma clang diagnostic pop
+
+#endif // SRC_UTIL_GLM_HPP
@@ -0,0 +1,173 @@
+#ifndef SRC_UTIL_JOB_HPP
+#define SRC_UTIL_JOB_HPP
+
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace util
+{
+    /// Move only, type erased void() callable
+    ///
+    /// Unlike std::function callables up to InlineSize bytes are stored
+    /// inside of the Job itself, which covers almost every lambda that gets
+    /// sent to the thread pool. Larger ones are moved onto the heap.
+    class Job
+    {
+    public:
+        /// Chosen so that a whole Job is a single cache line
+        static constexpr std::size_t InlineSize {
+            64 - sizeof(void*)}; // NOLINT
+
+        template<class F>
+        static constexpr bool IsStoredInline =
+            sizeof(F) <= InlineSize
+            && alignof(F) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible_v<F>;
+    public:
+        Job()
+            : storage {}
+            , vtable {nullptr}
+        {}
+
+        template<class F>
+            requires (!std::same_as<std::remove_cvref_t<F>, Job>)
+                  && std::invocable<std::remove_cvref_t<F>&>
+        Job(F&& func) // NOLINT: implicit conversions from lambdas are wanted
+            : storage {}
+            , vtable {&VTableFor<std::remove_cvref_t<F>>}
+        {
+            using Stored = std::remove_cvref_t<F>;
+
+            if constexpr (IsStoredInline<Stored>)
+            {
+                ::new (static_cast<void*>(this->storage))
+                    Stored(std::forward<F>(func));
+            }
+            else
+            {
+                ::new (static_cast<void*>(this->storage))
+                    Stored*(new Stored(std::forward<F>(func)));
+            }
+        }
+
+        ~Job()
+        {
+            this->reset();
+        }
+
+        Job(const Job&) = delete;
+        Job(Job&& other) noexcept
+            : storage {}
+            , vtable {std::exchange(other.vtable, nullptr)}
+        {
+            if (this->vtable != nullptr)
+            {
+                this->vtable->move(this->storage, other.storage);
+            }
+        }
+        Job& operator= (const Job&) = delete;
+        Job& operator= (Job&& other) noexcept
+        {
+            if (this != &other)
+            {
+                this->reset();
+
+                this->vtable = std::exchange(other.vtable, nullptr);
+
+                if (this->vtable != nullptr)
+                {
+                    this->vtable->move(this->storage, other.storage);
+                }
+            }
+
+            return *this;
+        }
+
+        void operator() ()
+        {
+            this->vtable->invoke(this->storage);
+        }
+
+        explicit operator bool () const
+        {
+            return this->vtable != nullptr;
+        }
+
+    private:
+        struct VTable
+        {
+            void (*invoke)(std::byte*);
+            // Move constructs into dst and destroys src
+            void (*move)(std::byte* dst, std::byte* src) noexcept;
+            void (*destroy)(std::byte*) noexcept;
+        };
+
+        template<class F>
+        static F& access(std::byte* storage)
+        {
+            if constexpr (IsStoredInline<F>)
+            {
+                return *std::launder(reinterpret_cast<F*>(storage));
+            }
+            else
+            {
+                return **std::launder(reinterpret_cast<F**>(storage));
+            }
+        }
+
+        template<class F>
+        static constexpr VTable VTableFor {
+            .invoke {[](std::byte* storage)
+                     {
+                         std::invoke(access<F>(storage));
+                     }},
+            .move {[](std::byte* dst, std::byte* src) noexcept
+                   {
+                       if constexpr (IsStoredInline<F>)
+                       {
+                           F& source = access<F>(src);
+
+                           ::new (static_cast<void*>(dst)) F(std::move(source));
+                           source.~F();
+                       }
+                       else
+                       {
+                           ::new (static_cast<void*>(dst))
+                               F*(*std::launder(reinterpret_cast<F**>(src)));
+                       }
+                   }},
+            .destroy {[](std::byte* storage) noexcept
+                      {
+                          if constexpr (IsStoredInline<F>)
+                          {
+                              access<F>(storage).~F();
+                          }
+                          else
+                          {
+                              delete &access<F>(storage);
+                          }
+                      }},
+        };
+
+        void reset()
+        {
+            if (this->vtable != nullptr)
+            {
+                this->vtable->destroy(this->storage);
+                this->vtable = nullptr;
+            }
+        }
+
+        alignas(std::max_align_t) std::byte storage[InlineSize];
+        const VTable* vtable;
+    };
+
+    static_assert(sizeof(Job) == 64);
+} // namespace util
+
+#endif // SRC_UTIL_JOB_HPP
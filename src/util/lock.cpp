@@ -0,0 +1,102 @@
+#include "lock.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <memory>
+
+namespace
+{
+    struct Registry
+    {
+        std::mutex mutex;
+        std::map<
+            std::string,
+            std::unique_ptr<util::LockStatistics>,
+            std::less<>>
+            statistics;
+    };
+
+    /// Leaked, locks may be used during static destruction
+    Registry& getRegistry()
+    {
+        static Registry* registry = new Registry {}; // NOLINT
+
+        return *registry;
+    }
+
+    bool areLockStatisticsEnabled()
+    {
+        // NOLINTNEXTLINE: read once at startup
+        static const bool enabled = std::getenv("MANGO_LOCK_STATISTICS")
+                                 != nullptr;
+
+        return enabled;
+    }
+} // namespace
+
+util::LockStatistics* util::getLockStatistics(std::string_view name)
+{
+    if (!areLockStatisticsEnabled())
+    {
+        return nullptr;
+    }
+
+    Registry&        registry = getRegistry();
+    std::unique_lock lock {registry.mutex};
+
+    auto it = registry.statistics.find(name);
+
+    if (it == registry.statistics.end())
+    {
+        it = registry.statistics
+                 .emplace(
+                     std::string {name},
+                     std::make_unique<LockStatistics>(std::string {name}))
+                 .first;
+    }
+
+    return it->second.get();
+}
+
+std::vector<util::LockStatistics::Snapshot> util::getAllLockStatistics()
+{
+    std::vector<LockStatistics::Snapshot> output {};
+
+    {
+        Registry&        registry = getRegistry();
+        std::unique_lock lock {registry.mutex};
+
+        for (const auto& [name, statistics] : registry.statistics)
+        {
+            output.push_back(statistics->snapshot());
+        }
+    }
+
+    std::ranges::sort(
+        output,
+        [](const LockStatistics::Snapshot& l, const LockStatistics::Snapshot& r)
+        {
+            return l.total_wait > r.total_wait;
+        });
+
+    return output;
+}
+
+void util::logLockStatistics()
+{
+    for (const LockStatistics::Snapshot& s : getAllLockStatistics())
+    {
+        util::logLog(
+            "Lock {:<24} | {:>10} acquisitions | {:>8} contended ({:5.2f}%) | "
+            "wait {:>10.3f}ms total {:>8.3f}ms max",
+            s.name,
+            s.acquisitions,
+            s.contentions,
+            s.acquisitions == 0 ? 0.0
+                                : 100.0 * static_cast<double>(s.contentions)
+                                      / static_cast<double>(s.acquisitions),
+            static_cast<double>(s.total_wait.count()) / 1e6,
+            static_cast<double>(s.maximum_wait.count()) / 1e6);
+    }
+}
@@ -0,0 +1,430 @@
+#ifndef SRC_UTIL_LOCK_HPP
+#define SRC_UTIL_LOCK_HPP
+
+#include "cache_line.hpp"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace util
+{
+    /// Acquisition counts and wait times shared by every lock with the same
+    /// name, see getLockStatistics
+    class LockStatistics
+    {
+    public:
+        struct Snapshot
+        {
+            std::string_view         name;
+            std::uint64_t            acquisitions;
+            /// Acquisitions that had to wait and failed try_locks
+            std::uint64_t            contentions;
+            std::chrono::nanoseconds total_wait;
+            std::chrono::nanoseconds maximum_wait;
+        };
+    public:
+        explicit LockStatistics(std::string name_)
+            : name {std::move(name_)}
+            , acquisitions {0}
+            , contentions {0}
+            , total_wait_nanoseconds {0}
+            , maximum_wait_nanoseconds {0}
+        {}
+        ~LockStatistics() = default;
+
+        LockStatistics(const LockStatistics&)             = delete;
+        LockStatistics(LockStatistics&&)                  = delete;
+        LockStatistics& operator= (const LockStatistics&) = delete;
+        LockStatistics& operator= (LockStatistics&&)      = delete;
+
+        void recordAcquisition() noexcept
+        {
+            this->acquisitions.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void recordContention(std::chrono::nanoseconds wait) noexcept
+        {
+            const std::uint64_t nanoseconds =
+                static_cast<std::uint64_t>(wait.count());
+
+            this->contentions.fetch_add(1, std::memory_order_relaxed);
+            this->total_wait_nanoseconds.fetch_add(
+                nanoseconds, std::memory_order_relaxed);
+
+            std::uint64_t maximum =
+                this->maximum_wait_nanoseconds.load(std::memory_order_relaxed);
+
+            while (nanoseconds > maximum
+                   && !this->maximum_wait_nanoseconds.compare_exchange_weak(
+                       maximum, nanoseconds, std::memory_order_relaxed))
+            {}
+        }
+
+        [[nodiscard]] Snapshot snapshot() const
+        {
+            return Snapshot {
+                .name {this->name},
+                .acquisitions {this->acquisitions.load()},
+                .contentions {this->contentions.load()},
+                .total_wait {std::chrono::nanoseconds {
+                    static_cast<std::int64_t>(
+                        this->total_wait_nanoseconds.load())}},
+                .maximum_wait {std::chrono::nanoseconds {
+                    static_cast<std::int64_t>(
+                        this->maximum_wait_nanoseconds.load())}},
+            };
+        }
+
+    private:
+        std::string                name;
+        std::atomic<std::uint64_t> acquisitions;
+        std::atomic<std::uint64_t> contentions;
+        std::atomic<std::uint64_t> total_wait_nanoseconds;
+        std::atomic<std::uint64_t> maximum_wait_nanoseconds;
+    };
+
+    /// Returns the statistics shared by every lock called name, or nullptr
+    /// unless MANGO_LOCK_STATISTICS is set, in which case locks don't pay
+    /// anything for them
+    [[nodiscard]] LockStatistics* getLockStatistics(std::string_view name);
+
+    /// Sorted by total wait, most contended first
+    [[nodiscard]] std::vector<LockStatistics::Snapshot> getAllLockStatistics();
+    void                                                logLockStatistics();
+
+    namespace detail
+    {
+        template<class TryLock, class Lock>
+        void acquire(LockStatistics* statistics, TryLock tryLock, Lock lock)
+        {
+            if (statistics == nullptr)
+            {
+                lock();
+
+                return;
+            }
+
+            statistics->recordAcquisition();
+
+            if (tryLock())
+            {
+                return;
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+
+            lock();
+
+            statistics->recordContention(
+                std::chrono::steady_clock::now() - start);
+        }
+
+        inline bool recordTry(LockStatistics* statistics, bool locked)
+        {
+            if (statistics != nullptr)
+            {
+                if (locked)
+                {
+                    statistics->recordAcquisition();
+                }
+                else
+                {
+                    statistics->recordContention(std::chrono::nanoseconds {0});
+                }
+            }
+
+            return locked;
+        }
+    } // namespace detail
+
+    template<class... T>
+    class Mutex
+    {
+    public:
+
+        Mutex(T... t)
+            : tuple {std::forward<T>(t)...}
+            , statistics {nullptr}
+        {}
+        ~Mutex() = default;
+
+        Mutex(const Mutex&)             = delete;
+        Mutex(Mutex&&)                  = default;
+        Mutex& operator= (const Mutex&) = delete;
+        Mutex& operator= (Mutex&&)      = default;
+
+        void lock(std::invocable<T&...> auto func) noexcept(noexcept(func))
+        {
+            std::unique_lock lock {this->acquire()};
+
+            std::apply(func, this->tuple);
+        }
+
+        void lock(std::invocable<const T&...> auto func) const
+            noexcept(noexcept(func))
+        {
+            std::unique_lock lock {this->acquire()};
+
+            std::apply(func, this->tuple);
+        }
+
+        bool try_lock(std::invocable<T&...> auto func) noexcept(noexcept(func))
+        {
+            std::unique_lock<std::mutex> lock {this->mutex, std::defer_lock};
+
+            if (detail::recordTry(this->statistics, lock.try_lock()))
+            {
+                std::apply(func, this->tuple);
+                return true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        bool try_lock(std::invocable<const T&...> auto func) const
+            noexcept(noexcept(func))
+        {
+            std::unique_lock<std::mutex> lock {this->mutex, std::defer_lock};
+
+            if (detail::recordTry(this->statistics, lock.try_lock()))
+            {
+                std::apply(func, this->tuple);
+                return true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        /// See getLockStatistics, nullptr stops recording
+        void setStatistics(LockStatistics* statistics_)
+        {
+            this->statistics = statistics_;
+        }
+
+    private:
+        std::unique_lock<std::mutex> acquire() const
+        {
+            detail::acquire(
+                this->statistics,
+                [this]
+                {
+                    return this->mutex.try_lock();
+                },
+                [this]
+                {
+                    this->mutex.lock();
+                });
+
+            return std::unique_lock {this->mutex, std::adopt_lock};
+        }
+
+        mutable std::mutex mutex;
+        std::tuple<T...>   tuple;
+        LockStatistics*    statistics;
+    }; // class Mutex
+
+    /// Mutex that lets any number of readers in at once
+    ///
+    /// Readers only get const access, anything that's modified from read has
+    /// to synchronize itself.
+    template<class... T>
+    class RwLock
+    {
+    public:
+
+        RwLock(T... t)
+            : tuple {std::forward<T>(t)...}
+            , statistics {nullptr}
+        {}
+        ~RwLock() = default;
+
+        RwLock(const RwLock&)             = delete;
+        RwLock(RwLock&&)                  = default;
+        RwLock& operator= (const RwLock&) = delete;
+        RwLock& operator= (RwLock&&)      = default;
+
+        void read(std::invocable<const T&...> auto func) const
+        {
+            detail::acquire(
+                this->statistics,
+                [this]
+                {
+                    return this->mutex.try_lock_shared();
+                },
+                [this]
+                {
+                    this->mutex.lock_shared();
+                });
+
+            std::shared_lock lock {this->mutex, std::adopt_lock};
+
+            std::apply(func, this->tuple);
+        }
+
+        void write(std::invocable<T&...> auto func)
+        {
+            detail::acquire(
+                this->statistics,
+                [this]
+                {
+                    return this->mutex.try_lock();
+                },
+                [this]
+                {
+                    this->mutex.lock();
+                });
+
+            std::unique_lock lock {this->mutex, std::adopt_lock};
+
+            std::apply(func, this->tuple);
+        }
+
+        bool try_read(std::invocable<const T&...> auto func) const
+        {
+            std::shared_lock lock {this->mutex, std::defer_lock};
+
+            if (detail::recordTry(this->statistics, lock.try_lock()))
+            {
+                std::apply(func, this->tuple);
+                return true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        bool try_write(std::invocable<T&...> auto func)
+        {
+            std::unique_lock lock {this->mutex, std::defer_lock};
+
+            if (detail::recordTry(this->statistics, lock.try_lock()))
+            {
+                std::apply(func, this->tuple);
+                return true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        /// See getLockStatistics, nullptr stops recording
+        void setStatistics(LockStatistics* statistics_)
+        {
+            this->statistics = statistics_;
+        }
+
+    private:
+        mutable std::shared_mutex mutex;
+        std::tuple<T...>          tuple;
+        LockStatistics*           statistics;
+    }; // class RwLock
+
+    /// Shards independently locked copies of T, such as the buckets of a
+    /// map, where a key always maps onto the same shard by its hash
+    ///
+    /// Threads working on different keys rarely wait on each other, unlike
+    /// with one lock around the whole of T.
+    template<class T, std::size_t Shards = 16>
+        requires (std::has_single_bit(Shards))
+    class Sharded
+    {
+    public:
+        Sharded()
+            : shards {}
+        {}
+        ~Sharded() = default;
+
+        Sharded(const Sharded&)             = delete;
+        Sharded(Sharded&&)                  = delete;
+        Sharded& operator= (const Sharded&) = delete;
+        Sharded& operator= (Sharded&&)      = delete;
+
+        template<class Key, class Hash = std::hash<Key>>
+        void read(const Key& key, std::invocable<const T&> auto func) const
+        {
+            this->getShard<Key, Hash>(key).lock.read(func);
+        }
+
+        template<class Key, class Hash = std::hash<Key>>
+        void write(const Key& key, std::invocable<T&> auto func)
+        {
+            this->getShard<Key, Hash>(key).lock.write(func);
+        }
+
+        /// Write locks one shard at a time, never all of them at once
+        void writeEach(std::invocable<T&> auto func)
+        {
+            for (Shard& s : this->shards)
+            {
+                s.lock.write(func);
+            }
+        }
+
+        /// Every shard records into the same statistics
+        void setStatistics(LockStatistics* statistics)
+        {
+            for (Shard& s : this->shards)
+            {
+                s.lock.setStatistics(statistics);
+            }
+        }
+
+    private:
+        struct alignas(CacheLineSize) Shard
+        {
+            RwLock<T> lock {T {}};
+        };
+
+        template<class Key, class Hash>
+        const Shard& getShard(const Key& key) const
+        {
+            if constexpr (Shards == 1)
+            {
+                return this->shards[0];
+            }
+            else
+            {
+                // Fibonacci hashing, the top bits of the product depend on
+                // every bit of the hash so a weak Hash still spreads over
+                // every shard
+                constexpr int ShardBits {std::countr_zero(Shards)};
+
+                const std::uint64_t mixed =
+                    static_cast<std::uint64_t>(Hash {}(key))
+                    * 0x9E3779B97F4A7C15;
+
+                return this->shards[static_cast<std::size_t>(
+                    mixed >> (64 - ShardBits))];
+            }
+        }
+
+        template<class Key, class Hash>
+        Shard& getShard(const Key& key)
+        {
+            return const_cast<Shard&>(
+                std::as_const(*this).template getShard<Key, Hash>(key));
+        }
+
+        std::array<Shard, Shards> shards;
+    };
+} // namespace util
+
+#endif // SRC_UTIL_LOCK_HPP
@@ -1,119 +1,954 @@
 #include "log.hpp"
-#include <ctime>
+#include "cache_line.hpp"
+#include "channel.hpp"
+#include "log_file.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <concepts>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
 #include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Weverything"
-#include <concurrentqueue.h>
-#include <fmt/chrono.h>
 #include <fmt/core.h>
 #pragma clang diagnostic pop
 
-const char* levelAsString(util::Level l)
+namespace
 {
-    using enum util::Level;
+    /// Retries partial writes
+    void writeToStdout(std::string_view output)
+    {
+#ifdef _WIN32
+        static_cast<void>(
+            std::fwrite(output.data(), 1, output.size(), stdout));
+        static_cast<void>(std::fflush(stdout));
+#else
+        while (!output.empty())
+        {
+            const ssize_t written =
+                ::write(STDOUT_FILENO, output.data(), output.size());
+
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                return;
+            }
+
+            output.remove_prefix(static_cast<std::size_t>(written));
+        }
+#endif // _WIN32
+    }
+
+    /// Single producer single consumer ring of deferred records, owned by
+    /// one thread and drained by the logger thread
+    ///
+    /// Records are aligned to 8 bytes and never wrap around the end of the
+    /// ring. When one doesn't fit before the end a size of 0 is written in
+    /// its place, marking the rest of the ring as unused.
+    class ThreadBuffer
+    {
+    public:
+        static constexpr std::size_t Capacity {64 * 1024};
+
+        ThreadBuffer()
+            : data {std::make_unique<std::uint64_t[]>(
+                Capacity / sizeof(std::uint64_t))}
+            , head {0}
+            , tail {0}
+            , cached_head {0}
+            , reserved {0}
+            , retired {false}
+        {}
+        ~ThreadBuffer() = default;
+
+        ThreadBuffer(const ThreadBuffer&)             = delete;
+        ThreadBuffer(ThreadBuffer&&)                  = delete;
+        ThreadBuffer& operator= (const ThreadBuffer&) = delete;
+        ThreadBuffer& operator= (ThreadBuffer&&)      = delete;
+
+        /// Owning thread only, returns nullptr if the logger thread hasn't
+        /// freed enough space yet
+        std::byte* tryBegin(std::size_t size)
+        {
+            const std::size_t aligned = getAlignedSize(size);
+            std::size_t position = this->tail.load(std::memory_order_relaxed);
+            const std::size_t offset = position % Capacity;
+            const std::size_t skipped =
+                Capacity - offset < aligned ? Capacity - offset : 0;
+
+            if (Capacity - (position - this->cached_head) < skipped + aligned)
+            {
+                this->cached_head = this->head.load(std::memory_order_acquire);
+
+                if (Capacity - (position - this->cached_head)
+                    < skipped + aligned)
+                {
+                    return nullptr;
+                }
+            }
+
+            if (skipped != 0)
+            {
+                const std::uint32_t unused {0};
+
+                std::memcpy(this->getBytes() + offset, &unused, sizeof(unused));
+                position += skipped;
+            }
+
+            this->reserved = position + aligned;
+
+            return this->getBytes() + (position % Capacity);
+        }
+
+        /// Owning thread only, publishes the record from the last tryBegin
+        ///
+        /// Sequentially consistent, see AsyncLogger::notify.
+        void commit()
+        {
+            this->tail.store(this->reserved);
+        }
+
+        /// Owning thread only
+        [[nodiscard]] bool isHalfFull()
+        {
+            if (this->reserved - this->cached_head <= Capacity / 2)
+            {
+                return false;
+            }
+
+            this->cached_head = this->head.load(std::memory_order_acquire);
+
+            return this->reserved - this->cached_head > Capacity / 2;
+        }
+
+        /// Logger thread only, calls func with every committed record
+        void drain(std::invocable<std::span<const std::byte>> auto func)
+        {
+            const std::size_t end = this->tail.load(std::memory_order_acquire);
+            std::size_t position  = this->head.load(std::memory_order_relaxed);
+
+            while (position != end)
+            {
+                const std::byte* record =
+                    this->getBytes() + (position % Capacity);
+                std::uint32_t size {0};
 
-    switch (l)
+                std::memcpy(&size, record, sizeof(size));
+
+                if (size == 0)
+                {
+                    position += Capacity - (position % Capacity);
+
+                    continue;
+                }
+
+                func(std::span<const std::byte> {record, size});
+
+                position += getAlignedSize(size);
+            }
+
+            this->head.store(position, std::memory_order_release);
+        }
+
+        [[nodiscard]] bool hasRecords() const
+        {
+            return this->head.load(std::memory_order_relaxed)
+                != this->tail.load();
+        }
+
+        /// The owning thread has exited, nothing else will be written
+        void retire()
+        {
+            this->retired.store(true, std::memory_order_release);
+        }
+
+        [[nodiscard]] bool isRetired() const
+        {
+            return this->retired.load(std::memory_order_acquire);
+        }
+
+    private:
+        static constexpr std::size_t getAlignedSize(std::size_t size)
+        {
+            constexpr std::size_t Alignment {alignof(std::uint64_t)};
+
+            return (size + Alignment - 1) & ~(Alignment - 1);
+        }
+
+        std::byte* getBytes() const
+        {
+            return reinterpret_cast<std::byte*>(this->data.get()); // NOLINT
+        }
+
+        std::unique_ptr<std::uint64_t[]> data; // NOLINT: aligned storage
+
+        alignas(util::CacheLineSize) std::atomic<std::size_t> head;
+        alignas(util::CacheLineSize) std::atomic<std::size_t> tail;
+        /// Owning thread only
+        std::size_t cached_head;
+        std::size_t reserved;
+
+        std::atomic<bool> retired;
+    };
+
+    /// A record copied out of a ThreadBuffer or one sent by logFormatted,
+    /// which are formatted ahead of time as "{}" with a single argument
+    struct Entry
+    {
+        std::int64_t     timestamp {0};
+        util::Level      level {util::Level::Trace};
+        std::uint32_t    line {0};
+        const char*      file {""};
+        std::string_view format;
+        std::uint8_t     number_of_arguments {0};
+        /// Encoded by util::detail::encodeArgument
+        std::string      arguments;
+
+        [[nodiscard]] std::span<const std::byte> getArguments() const
+        {
+            return std::as_bytes(std::span {this->arguments});
+        }
+    };
+
+    Entry readEntry(std::span<const std::byte> record)
     {
-    case Trace:
-        return "Trace";
-    case Debug:
-        return "Debug";
-    case Log:
-        return "Log";
-    case Warn:
-        return "Warn";
-    case Fatal:
-        return "Fatal";
+        util::detail::RecordHeader header {};
+
+        std::memcpy(&header, record.data(), sizeof(header));
+        record = record.subspan(sizeof(header));
+
+        return Entry {
+            .timestamp {header.timestamp},
+            .level {header.level},
+            .line {header.line},
+            .file {header.file},
+            .format {header.format, header.format_size},
+            .number_of_arguments {header.number_of_arguments},
+            .arguments {
+                reinterpret_cast<const char*>(record.data()), record.size()},
+        };
     }
 
-    throw std::runtime_error {"unreachable!"};
-}
+    /// See the format described in log_format.hpp, strings are identified by
+    /// their address as every one of them has static storage duration
+    class BinaryLogWriter
+    {
+    public:
+        explicit BinaryLogWriter(std::FILE* file_)
+            : file {file_}
+            , string_ids {}
+            , buffer {}
+        {
+            this->append(util::detail::BinaryLogMagic);
+            this->append(util::detail::BinaryLogVersion);
+        }
+        ~BinaryLogWriter()
+        {
+            this->flush();
+
+            static_cast<void>(std::fclose(this->file));
+        }
+
+        BinaryLogWriter(const BinaryLogWriter&)             = delete;
+        BinaryLogWriter(BinaryLogWriter&&)                  = delete;
+        BinaryLogWriter& operator= (const BinaryLogWriter&) = delete;
+        BinaryLogWriter& operator= (BinaryLogWriter&&)      = delete;
+
+        void write(const Entry& entry)
+        {
+            const std::uint32_t fileId   = this->getStringId(entry.file);
+            const std::uint32_t formatId = this->getStringId(entry.format);
+
+            this->append(util::detail::BinaryLogEntry::Record);
+            this->append(entry.timestamp);
+            this->append(entry.level);
+            this->append(entry.line);
+            this->append(fileId);
+            this->append(formatId);
+            this->append(entry.number_of_arguments);
+            this->append(static_cast<std::uint32_t>(entry.arguments.size()));
+            this->buffer.append(entry.arguments);
+        }
+
+        void flush()
+        {
+            static_cast<void>(std::fwrite(
+                this->buffer.data(), 1, this->buffer.size(), this->file));
+            static_cast<void>(std::fflush(this->file));
+
+            this->buffer.clear();
+        }
+
+    private:
+        template<class T>
+        void append(const T& t)
+        {
+            this->buffer.append(
+                reinterpret_cast<const char*>(&t), sizeof(T)); // NOLINT
+        }
+
+        std::uint32_t getStringId(std::string_view string)
+        {
+            const auto [it, inserted] = this->string_ids.try_emplace(
+                string.data(),
+                static_cast<std::uint32_t>(this->string_ids.size()));
+
+            if (inserted)
+            {
+                this->append(util::detail::BinaryLogEntry::StringDefinition);
+                this->append(it->second);
+                this->append(static_cast<std::uint32_t>(string.size()));
+                this->buffer.append(string);
+            }
+
+            return it->second;
+        }
+
+        std::FILE*                                     file;
+        std::unordered_map<const char*, std::uint32_t> string_ids;
+        std::string                                    buffer;
+    };
+
+    /// Set MANGO_BINARY_LOG to a path to write every message there in the
+    /// binary format instead, which mango_log_decode turns back into text.
+    /// Warnings and worse are still written to stdout as well.
+    std::optional<BinaryLogWriter> openBinaryLog()
+    {
+        // NOLINTNEXTLINE: read once at startup
+        const char* path = std::getenv("MANGO_BINARY_LOG");
+
+        if (path == nullptr)
+        {
+            return std::nullopt;
+        }
+
+        std::FILE* file = std::fopen(path, "wb"); // NOLINT
+
+        if (file == nullptr)
+        {
+            std::cerr << "Failed to open binary log " << path << '\n';
+
+            return std::nullopt;
+        }
+
+        return std::optional<BinaryLogWriter> {std::in_place, file};
+    }
+    struct LogLevels
+    {
+        std::mutex                                       mutex;
+        util::Level                                      global;
+        std::vector<std::pair<std::string, util::Level>> modules;
+        /// Incremented on every change, invalidates the per thread caches
+        /// of util::detail::isModuleLogLevelEnabled
+        std::atomic<std::uint64_t>                       generation;
+    };
+
+    /// Leaked, threads may log during static destruction
+    LogLevels& getLogLevels()
+    {
+        static LogLevels* levels = new LogLevels { // NOLINT
+            .mutex {},
+            .global {util::Level::Trace},
+            .modules {},
+            .generation {0}};
+
+        return *levels;
+    }
+
+    /// Must be called with levels.mutex held
+    void publishLogLevels(LogLevels& levels)
+    {
+        util::Level minimum = levels.global;
+
+        for (const auto& [module, level] : levels.modules)
+        {
+            minimum = std::min(minimum, level);
+        }
+
+        util::detail::minimumRuntimeLogLevel.store(minimum);
+        util::detail::hasModuleLogLevels.store(!levels.modules.empty());
+        levels.generation.fetch_add(1);
+    }
 
-class AsyncStdoutLogger
+    /// Relative to src, the same as the modules passed to util::setLogLevel
+    ///
+    /// Files have already been trimmed by SourceLocation::current, so they
+    /// start with the folder.
+    std::string_view getModulePath(std::string_view file)
+    {
+        for (std::string_view folder : util::FOLDER_IDENTIFIERS)
+        {
+            if (file.starts_with(folder.substr(1)))
+            {
+                return file.substr(folder.size() - 1);
+            }
+        }
+
+        return file;
+    }
+
+    std::optional<util::Level> parseLevel(std::string_view name)
+    {
+        using enum util::Level;
+
+        for (util::Level l : {Trace, Debug, Log, Warn, Fatal})
+        {
+            if (name == util::detail::getLevelName(l))
+            {
+                return l;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    /// See util::setLogLevel
+    void setLogLevelsFromEnvironment()
+    {
+        // NOLINTNEXTLINE: read once at startup
+        const char* environment = std::getenv("MANGO_LOG_LEVEL");
+
+        if (environment == nullptr)
+        {
+            return;
+        }
+
+        std::string_view remaining {environment};
+
+        while (!remaining.empty())
+        {
+            const std::size_t end =
+                std::min(remaining.find(','), remaining.size());
+            const std::string_view item = remaining.substr(0, end);
+
+            remaining = remaining.substr(std::min(end + 1, remaining.size()));
+
+            const std::size_t                equals = item.find('=');
+            const std::optional<util::Level> level  = parseLevel(
+                equals == std::string_view::npos ? item
+                                                  : item.substr(equals + 1));
+
+            if (!level.has_value())
+            {
+                std::cerr << "Invalid MANGO_LOG_LEVEL entry " << item << '\n';
+            }
+            else if (equals == std::string_view::npos)
+            {
+                util::setLogLevel(*level);
+            }
+            else
+            {
+                util::setLogLevel(item.substr(0, equals), *level);
+            }
+        }
+    }
+} // namespace
+
+class AsyncLogger
 {
 public:
-    AsyncStdoutLogger()
-        : should_thread_close {std::make_shared<std::atomic_bool>(false)}
+    AsyncLogger()
+        : AsyncLogger {util::mpmc::create<Entry>(util::mpmc::Unbounded)}
+    {}
+
+    ~AsyncLogger()
+    {
+        this->sender.close();
+        this->closing.store(true);
+        this->wake_up.notifyAll();
+
+        this->worker_thread.join();
+    }
+
+    AsyncLogger(const AsyncLogger&)             = delete;
+    AsyncLogger(AsyncLogger&&)                  = delete;
+    AsyncLogger& operator= (const AsyncLogger&) = delete;
+    AsyncLogger& operator= (AsyncLogger&&)      = delete;
+
+    void sendEntry(Entry&& entry)
     {
+        const bool urgent = entry.level >= util::Level::Warn;
+
+        if (!this->sender.send(std::move(entry)))
+        {
+            std::cerr << "Failed to send message | logger has shut down\n";
+        }
+
+        this->notify(urgent);
+    }
+
+    std::shared_ptr<ThreadBuffer> addThreadBuffer()
+    {
+        std::shared_ptr<ThreadBuffer> buffer =
+            std::make_shared<ThreadBuffer>();
+
+        std::unique_lock lock {this->buffers_mutex};
+
+        this->buffers.push_back(buffer);
+
+        return buffer;
+    }
+
+    /// Wakes the logger thread if it's idle, otherwise it picks up new
+    /// messages within FlushInterval anyway. Urgent always wakes it, for
+    /// warnings and buffers that are filling up.
+    ///
+    /// A thread that doesn't see idle set has published its message before
+    /// the logger thread set idle and then looked for messages, as all of
+    /// these accesses are sequentially consistent.
+    void notify(bool urgent)
+    {
+        if (urgent)
+        {
+            this->is_urgent.store(true);
+            this->wake_up.notify(1);
+        }
+        else if (this->is_idle.load())
+        {
+            this->wake_up.notify(1);
+        }
+    }
+
+private:
+    static constexpr std::chrono::milliseconds FlushInterval {1};
+
+    using Sender   = util::mpmc::Sender<Entry>;
+    using Receiver = util::mpmc::Receiver<Entry>;
+
+    explicit AsyncLogger(std::pair<Sender, Receiver> channel)
+        : sender {std::move(channel.first)}
+        , receiver {std::move(channel.second)}
+        , buffers_mutex {}
+        , buffers {}
+        , wake_up {}
+        , closing {false}
+        , is_idle {false}
+        , is_urgent {false}
+        , binary_log {openBinaryLog()}
+        , log_file {}
+        , worker_thread {}
+    {
+        setLogLevelsFromEnvironment();
+
+        using util::detail::MappedLogFile;
+
+        if (std::optional<MappedLogFile::Configuration> configuration =
+                MappedLogFile::Configuration::fromEnvironment())
+        {
+            this->log_file.emplace(std::move(*configuration));
+        }
+
         this->worker_thread = std::thread {
             [this]
             {
-                std::string temporary_string {"INVALID MESSAGE"};
+                this->run();
+            }};
+    }
+
+    bool hasWork()
+    {
+        if (this->closing.load() || this->receiver.getSize() > 0)
+        {
+            return true;
+        }
+
+        std::unique_lock lock {this->buffers_mutex};
+
+        return std::ranges::any_of(
+            this->buffers,
+            [](const std::shared_ptr<ThreadBuffer>& b)
+            {
+                return b->hasRecords();
+            });
+    }
+
+    void run()
+    {
+        std::vector<Entry>          entries {};
+        std::array<Entry, 64>       batch {};
+        util::detail::LineFormatter formatter {};
+        std::string                 output {};
+        std::string                 stdoutOutput {};
+
+        while (true)
+        {
+            // Read before draining so that nothing logged before the
+            // destructor ran is missed
+            const bool finished = this->closing.load();
+
+            this->is_urgent.store(false);
+
+            {
+                std::unique_lock lock {this->buffers_mutex};
 
-                // Main loop
-                while (!this->should_thread_close->load())
+                for (const std::shared_ptr<ThreadBuffer>& b : this->buffers)
                 {
-                    if (this->message_queue.try_dequeue(temporary_string))
-                    {
-                        std::cout << temporary_string;
-                    }
+                    b->drain(
+                        [&](std::span<const std::byte> record)
+                        {
+                            entries.push_back(readEntry(record));
+                        });
                 }
-                // util::logTrace("Logger's destructor called");
 
-                // Cleanup loop
-                while (this->message_queue.try_dequeue(temporary_string))
+                std::erase_if(
+                    this->buffers,
+                    [](const std::shared_ptr<ThreadBuffer>& b)
+                    {
+                        return b->isRetired() && !b->hasRecords();
+                    });
+            }
+
+            while (const std::size_t count =
+                       this->receiver.tryReceiveBulk(batch))
+            {
+                std::move(
+                    batch.begin(),
+                    batch.begin() + static_cast<std::ptrdiff_t>(count),
+                    std::back_inserter(entries));
+            }
+
+            if (entries.empty())
+            {
+                if (finished)
                 {
-                    std::cout << temporary_string;
+                    return;
                 }
-            }};
+
+                // Nothing was logged since the last write, sleeps until
+                // something is
+                this->is_idle.store(true);
+                this->wake_up.wait(
+                    [this]
+                    {
+                        return this->hasWork();
+                    });
+                this->is_idle.store(false);
+
+                continue;
+            }
+
+            // Every thread has its own buffer
+            std::ranges::stable_sort(entries, {}, &Entry::timestamp);
+
+            this->write(entries, formatter, output, stdoutOutput);
+
+            entries.clear();
+            output.clear();
+            stdoutOutput.clear();
+
+            // Lets more messages pile up before the next write, a steady
+            // stream of them costs one wakeup and syscall per FlushInterval
+            // rather than one per message
+            this->wake_up.waitUntil(
+                [this]
+                {
+                    return this->closing.load() || this->is_urgent.load();
+                },
+                std::chrono::steady_clock::now() + FlushInterval);
+        }
     }
 
-    ~AsyncStdoutLogger()
+    /// Every line is formatted into output, which keeps its capacity between
+    /// batches, and written with one syscall
+    ///
+    /// With a binary log stdout only gets warnings and above, those are
+    /// copied into stdoutOutput when the log file still needs every line.
+    void write(
+        std::span<const Entry>       entries,
+        util::detail::LineFormatter& formatter,
+        std::string&                 output,
+        std::string&                 stdoutOutput)
     {
-        this->should_thread_close->store(true);
+        const bool filterStdout = this->binary_log.has_value();
+        const bool copyStdout   = filterStdout && this->log_file.has_value();
 
-        this->worker_thread.join();
-    }
+        for (const Entry& e : entries)
+        {
+            if (this->binary_log.has_value())
+            {
+                this->binary_log->write(e);
+            }
 
-    AsyncStdoutLogger(const AsyncStdoutLogger&)             = delete;
-    AsyncStdoutLogger(AsyncStdoutLogger&&)                  = delete;
-    AsyncStdoutLogger& operator= (const AsyncStdoutLogger&) = delete;
-    AsyncStdoutLogger& operator= (AsyncStdoutLogger&&)      = delete;
+            const bool toStdout =
+                !filterStdout || e.level >= util::Level::Warn;
 
-    void sendMessage(std::string&& string)
-    {
-        if (!this->message_queue.enqueue(std::move(string)))
+            // Nothing would be done with the formatted line
+            if (!toStdout && !this->log_file.has_value())
+            {
+                continue;
+            }
+
+            const std::size_t lineStart = output.size();
+
+            formatter.appendPrefix(
+                output, e.timestamp, e.file, e.line, e.level);
+
+            const std::size_t messageStart = output.size();
+
+            try
+            {
+                util::detail::appendArguments(
+                    output, e.format, e.getArguments(), e.number_of_arguments);
+            }
+            catch (const std::exception& exception)
+            {
+                output.resize(messageStart);
+                output += fmt::format(
+                    "Failed to format \"{}\" | {}", e.format, exception.what());
+            }
+
+            output.push_back('\n');
+
+            if (toStdout && copyStdout)
+            {
+                stdoutOutput.append(output, lineStart);
+            }
+        }
+
+        writeToStdout(copyStdout ? stdoutOutput : output);
+
+        if (this->log_file.has_value())
+        {
+            this->log_file->write(output, entries.back().timestamp);
+        }
+
+        if (this->binary_log.has_value())
         {
-            std::cerr << "Failed to send message | memory allocation failed"
-                      << string;
+            this->binary_log->flush();
         }
     }
 
-private:
-    std::thread                              worker_thread;
-    std::shared_ptr<std::atomic<bool>>       should_thread_close;
-    moodycamel::ConcurrentQueue<std::string> message_queue;
+    Sender   sender;
+    Receiver receiver;
+
+    std::mutex                                 buffers_mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    util::detail::WaitList                     wake_up;
+    std::atomic<bool>                          closing;
+    std::atomic<bool>                          is_idle;
+    std::atomic<bool>                          is_urgent;
+
+    std::optional<BinaryLogWriter>              binary_log;
+    std::optional<util::detail::MappedLogFile> log_file;
+    std::thread                                 worker_thread;
 };
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Weverything"
-static AsyncStdoutLogger logger {};
+static AsyncLogger logger {};
 #pragma clang diagnostic pop
 
-void util::logFormatted(Level l, const SourceLocation& loc, std::string msg)
+namespace
 {
-    logger.sendMessage(fmt::format(
-        "[{0}] [{1}] [{2}] {3}\n",
-        [&]
+    /// Registers the calling thread's buffer on first use and retires it
+    /// when the thread exits, the logger frees it once it's been drained
+    class ThreadBufferHandle
+    {
+    public:
+        ThreadBufferHandle()
+            : buffer {logger.addThreadBuffer()}
+        {}
+        ~ThreadBufferHandle()
         {
-            std::string workingString {31, ' '};
+            this->buffer->retire();
+
+            logger.notify(false);
+        }
+
+        ThreadBufferHandle(const ThreadBufferHandle&)             = delete;
+        ThreadBufferHandle(ThreadBufferHandle&&)                  = delete;
+        ThreadBufferHandle& operator= (const ThreadBufferHandle&) = delete;
+        ThreadBufferHandle& operator= (ThreadBufferHandle&&)      = delete;
+
+        std::shared_ptr<ThreadBuffer> buffer;
+    };
+
+    ThreadBuffer& getThreadBuffer()
+    {
+        thread_local ThreadBufferHandle handle {};
 
-            workingString = fmt::format(
-                "{:0%b %m/%d/%Y %I:%M}:{:%S}",
-                fmt::localtime(std::time(nullptr)),
-                std::chrono::system_clock::now());
+        return *handle.buffer;
+    }
+} // namespace
+
+std::byte* util::detail::beginRecord(std::size_t size)
+{
+    ThreadBuffer& buffer = getThreadBuffer();
+
+    while (true)
+    {
+        if (std::byte* output = buffer.tryBegin(size))
+        {
+            return output;
+        }
+
+        // Full, the logger thread hasn't caught up with this thread yet
+        logger.notify(true);
+        std::this_thread::yield();
+    }
+}
+
+void util::detail::commitRecord()
+{
+    ThreadBuffer& buffer = getThreadBuffer();
+
+    buffer.commit();
+
+    logger.notify(buffer.isHalfFull());
+}
+
+void util::logFormatted(Level l, const SourceLocation& loc, std::string msg)
+{
+    Entry entry {
+        .timestamp {detail::getTimestamp()},
+        .level {l},
+        .line {static_cast<std::uint32_t>(loc.line())},
+        .file {loc.file()},
+        .format {"{}"},
+        .number_of_arguments {1},
+        .arguments {},
+    };
+
+    entry.arguments.resize(detail::getEncodedSize(msg));
+    detail::encodeArgument(
+        reinterpret_cast<std::byte*>(entry.arguments.data()), msg); // NOLINT
+
+    logger.sendEntry(std::move(entry));
+}
+
+void util::setLogLevel(Level level)
+{
+    LogLevels&       levels = getLogLevels();
+    std::unique_lock lock {levels.mutex};
+
+    levels.global = level;
+
+    publishLogLevels(levels);
+}
+
+void util::setLogLevel(std::string_view module, Level level)
+{
+    while (module.ends_with('/'))
+    {
+        module.remove_suffix(1);
+    }
 
-            workingString.erase(30, std::string::npos);
+    LogLevels&       levels = getLogLevels();
+    std::unique_lock lock {levels.mutex};
 
-            workingString.at(workingString.size() - 7) = ':';
-            workingString.insert(workingString.size() - 3, ":");
+    const auto it = std::ranges::find(
+        levels.modules, module, &std::pair<std::string, Level>::first);
+
+    if (it == levels.modules.end())
+    {
+        levels.modules.emplace_back(std::string {module}, level);
+    }
+    else
+    {
+        it->second = level;
+    }
+
+    publishLogLevels(levels);
+}
+
+util::Level util::getLogLevel()
+{
+    LogLevels&       levels = getLogLevels();
+    std::unique_lock lock {levels.mutex};
+
+    return levels.global;
+}
+
+util::LogLevelSnapshot util::saveLogLevels()
+{
+    LogLevels&       levels = getLogLevels();
+    std::unique_lock lock {levels.mutex};
+
+    return LogLevelSnapshot {
+        .global {levels.global}, .modules {levels.modules}};
+}
+
+void util::restoreLogLevels(LogLevelSnapshot snapshot)
+{
+    LogLevels&       levels = getLogLevels();
+    std::unique_lock lock {levels.mutex};
+
+    levels.global  = snapshot.global;
+    levels.modules = std::move(snapshot.modules);
+
+    publishLogLevels(levels);
+}
+
+bool util::detail::isModuleLogLevelEnabled(Level level, const char* file)
+{
+    struct Cache
+    {
+        std::uint64_t                           generation {~std::uint64_t {0}};
+        std::unordered_map<const char*, Level> levels;
+    };
+
+    // Files are identified by address, every SourceLocation's file is a
+    // string literal
+    thread_local Cache cache {};
+
+    LogLevels&          levels     = getLogLevels();
+    const std::uint64_t generation = levels.generation.load();
+
+    if (cache.generation != generation)
+    {
+        cache.levels.clear();
+        cache.generation = generation;
+    }
+
+    auto it = cache.levels.find(file);
+
+    if (it == cache.levels.end())
+    {
+        const std::string_view path = getModulePath(file);
+
+        std::unique_lock lock {levels.mutex};
+
+        Level       fileLevel = levels.global;
+        std::size_t longest {0};
+
+        for (const auto& [module, moduleLevel] : levels.modules)
+        {
+            const bool matches =
+                path.starts_with(module)
+                && (path.size() == module.size() || path[module.size()] == '/');
+
+            if (matches && module.size() >= longest)
+            {
+                fileLevel = moduleLevel;
+                longest   = module.size();
+            }
+        }
+
+        it = cache.levels.emplace(file, fileLevel).first;
+    }
 
-            return workingString;
-        }(),                           // 0
-        static_cast<std::string>(loc), // 1
-        levelAsString(l),              // 2
-        msg                            // 3
-        ));
+    return level >= it->second;
 }
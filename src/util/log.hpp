@@ -11,15 +11,19 @@
 
 #pragma clang diagnostic pop
 
+#include "log_format.hpp"
 #include "misc.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <string>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 namespace util
 {
-    static constexpr std::array<std::string_view, 2> FOLDER_IDENTIFIERS {
-        "/src/", "/inc/"};
-
     class SourceLocation
     {
     public:
@@ -29,7 +33,8 @@ namespace util
         {
             SourceLocation result {};
             result.lineNumber = line;
-            result.fileName   = file;
+            // Trimmed here so that nothing has to at runtime
+            result.fileName = detail::trimSourcePath(file).data();
             return result;
         }
     public:
@@ -54,22 +59,7 @@ namespace util
 
         constexpr explicit operator std::string () const noexcept
         {
-            std::string raw_file_name {this->fileName};
-
-            std::size_t index = std::string::npos;
-
-            for (std::string_view str : FOLDER_IDENTIFIERS)
-            {
-                if (index != std::string::npos)
-                {
-                    break;
-                }
-
-                index = raw_file_name.find(str);
-            }
-
-            return fmt::format(
-                "{}:{}", raw_file_name.substr(index + 1), this->lineNumber);
+            return fmt::format("{}:{}", this->fileName, this->lineNumber);
         }
 
     private:
@@ -77,7 +67,7 @@ namespace util
         const char* fileName;
     };
 
-    enum class Level
+    enum class Level : std::uint8_t
     {
         Trace,
         Debug,
@@ -86,8 +76,143 @@ namespace util
         Fatal
     };
 
+#ifndef MANGO_MINIMUM_LOG_LEVEL
+#ifdef NDEBUG
+#define MANGO_MINIMUM_LOG_LEVEL Debug
+#else
+#define MANGO_MINIMUM_LOG_LEVEL Trace
+#endif // NDEBUG
+#endif // MANGO_MINIMUM_LOG_LEVEL
+
+    /// Loggers and asserts below this level compile to nothing, set it with
+    /// -DMANGO_MINIMUM_LOG_LEVEL=<Level>
+    constexpr Level MinimumLogLevel {Level::MANGO_MINIMUM_LOG_LEVEL};
+
+    /// Messages below the level are dropped before they're formatted
+    ///
+    /// A module is a path relative to src, such as "gfx" or
+    /// "game/world/generator.cpp", and overrides the level of every file
+    /// under it. The longest matching module wins. Both can also be set at
+    /// startup with MANGO_LOG_LEVEL, e.g. MANGO_LOG_LEVEL=Log,gfx/vulkan=Trace
+    void setLogLevel(Level);
+    void setLogLevel(std::string_view module, Level);
+
+    /// The level of every file that isn't under a module
+    [[nodiscard]] Level getLogLevel();
+
+    /// Every runtime log level, for putting them back after changing them
+    struct LogLevelSnapshot
+    {
+        Level                                      global;
+        std::vector<std::pair<std::string, Level>> modules;
+    };
+
+    [[nodiscard]] LogLevelSnapshot saveLogLevels();
+    /// Replaces every level, including removing any module that isn't in
+    /// the snapshot
+    void restoreLogLevels(LogLevelSnapshot);
+
+    namespace detail
+    {
+        /// The lowest level of any module, anything below is never printed
+        inline std::atomic<Level> minimumRuntimeLogLevel {Level::Trace};
+        inline std::atomic<bool>  hasModuleLogLevels {false};
+
+        bool isModuleLogLevelEnabled(Level, const char* file);
+    } // namespace detail
+
+    [[nodiscard]] inline bool
+    isLogLevelEnabled(Level level, const SourceLocation& location)
+    {
+        if (level < MinimumLogLevel
+            || level < detail::minimumRuntimeLogLevel.load(
+                   std::memory_order_relaxed))
+        {
+            return false;
+        }
+
+        if (!detail::hasModuleLogLevels.load(std::memory_order_relaxed))
+        {
+            return true;
+        }
+
+        return detail::isModuleLogLevelEnabled(level, location.file());
+    }
+
     void logFormatted(Level, const util::SourceLocation&, std::string);
 
+    namespace detail
+    {
+        /// Anything larger is formatted on the calling thread instead
+        constexpr std::size_t MaximumRecordSize {4096};
+
+        /// Nanoseconds since the system_clock epoch
+        inline std::int64_t getTimestamp()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                .count();
+        }
+
+        /// Reserves size bytes in the calling thread's log buffer, waiting
+        /// for the logger thread if it's full. Must be followed by
+        /// commitRecord once the record has been written.
+        std::byte* beginRecord(std::size_t size);
+        void       commitRecord();
+    } // namespace detail
+
+    /// Copies the format string's address, location and arguments into the
+    /// calling thread's log buffer and leaves the formatting to the logger
+    /// thread. Falls back to logFormatted if any argument's type isn't a
+    /// detail::DeferrableArgument or the record is too large.
+    template<class... T>
+    void logDeferred(
+        Level                    level,
+        const SourceLocation&    location,
+        fmt::format_string<T...> format,
+        T&... args)
+    {
+        if constexpr ((detail::DeferrableArgument<T> && ...))
+        {
+            const std::size_t size =
+                sizeof(detail::RecordHeader)
+                + (std::size_t {0} + ... + detail::getEncodedSize(args));
+
+            if (size <= detail::MaximumRecordSize)
+            {
+                const fmt::string_view formatView {format};
+
+                const detail::RecordHeader header {
+                    .size {static_cast<std::uint32_t>(size)},
+                    .line {static_cast<std::uint32_t>(location.line())},
+                    .level {level},
+                    .number_of_arguments {sizeof...(T)},
+                    .format_size {
+                        static_cast<std::uint32_t>(formatView.size())},
+                    .timestamp {detail::getTimestamp()},
+                    .format {formatView.data()},
+                    .file {location.file()},
+                };
+
+                std::byte* output = detail::beginRecord(size);
+
+                std::memcpy(output, &header, sizeof(header));
+                output += sizeof(header);
+
+                ((output = detail::encodeArgument(output, args)), ...);
+
+                detail::commitRecord();
+
+                return;
+            }
+        }
+
+        logFormatted(
+            level,
+            location,
+            fmt::vformat(format, fmt::make_format_args(args...)));
+    }
+
 /// Because C++ doesn't have partial template specification, this is the best we
 /// can do
 #define MAKE_LOGGER(LEVEL)                                                     \
@@ -100,11 +225,13 @@ namespace util
             const util::SourceLocation& location =                             \
                 util::SourceLocation::current()) noexcept                      \
         {                                                                      \
-            using enum Level;                                                  \
-            logFormatted(                                                      \
-                LEVEL,                                                         \
-                location,                                                      \
-                fmt::vformat(fmt, fmt::make_format_args(args...)));            \
+            if constexpr (Level::LEVEL >= MinimumLogLevel)                     \
+            {                                                                  \
+                if (isLogLevelEnabled(Level::LEVEL, location))                 \
+                {                                                              \
+                    logDeferred<T...>(Level::LEVEL, location, fmt, args...);   \
+                }                                                              \
+            }                                                                  \
         }                                                                      \
     };                                                                         \
     template<class... J>                                                       \
@@ -127,17 +254,22 @@ namespace util
             const util::SourceLocation& location =                             \
                 util::SourceLocation::current())                               \
         {                                                                      \
-            if (!condition)                                                    \
+            if constexpr (THROW_ON_FAIL || Level::LEVEL >= MinimumLogLevel)    \
             {                                                                  \
-                using enum Level;                                              \
-                logFormatted(                                                  \
-                    LEVEL,                                                     \
-                    location,                                                  \
-                    fmt::vformat(fmt, fmt::make_format_args(args...)));        \
-                if constexpr (THROW_ON_FAIL)                                   \
+                if (!condition)                                                \
                 {                                                              \
-                    throw std::runtime_error {                                 \
-                        fmt::vformat(fmt, fmt::make_format_args(args...))};    \
+                    if (isLogLevelEnabled(Level::LEVEL, location))             \
+                    {                                                          \
+                        logFormatted(                                          \
+                            Level::LEVEL,                                      \
+                            location,                                          \
+                            fmt::vformat(fmt, fmt::make_format_args(args...)));\
+                    }                                                          \
+                    if constexpr (THROW_ON_FAIL)                               \
+                    {                                                          \
+                        throw std::runtime_error {fmt::vformat(                \
+                            fmt, fmt::make_format_args(args...))};             \
+                    }                                                          \
                 }                                                              \
             }                                                                  \
         }                                                                      \
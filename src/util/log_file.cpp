@@ -0,0 +1,256 @@
+#include "log_file.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <iterator>
+#include <system_error>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif // _WIN32
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#include <fmt/chrono.h>
+#include <fmt/core.h>
+#pragma clang diagnostic pop
+
+// Runs on the logger thread, so problems are written to stderr rather than
+// logged
+
+namespace
+{
+    std::optional<std::size_t> getEnvironmentInteger(const char* name)
+    {
+        const char* value = std::getenv(name); // NOLINT: read once at startup
+
+        if (value == nullptr)
+        {
+            return std::nullopt;
+        }
+
+        const std::string_view string {value};
+
+        std::size_t output {0};
+
+        const auto [end, error] = std::from_chars(
+            string.data(), string.data() + string.size(), output);
+
+        if (error != std::errc {} || end != string.data() + string.size())
+        {
+            std::cerr << "Ignoring invalid " << name << '=' << string << '\n';
+
+            return std::nullopt;
+        }
+
+        return output;
+    }
+
+    void reportError(std::string_view action, std::string_view fileName)
+    {
+        std::cerr << "Failed to " << action << ' ' << fileName << " | "
+                  << std::system_category().message(errno) << '\n';
+    }
+} // namespace
+
+auto util::detail::MappedLogFile::Configuration::fromEnvironment()
+    -> std::optional<Configuration>
+{
+    const char* path = std::getenv("MANGO_LOG_FILE"); // NOLINT
+
+    if (path == nullptr)
+    {
+        return std::nullopt;
+    }
+
+    constexpr std::size_t Mebibyte {1024 * 1024};
+
+    return Configuration {
+        .path {path},
+        .file_size {std::max<std::size_t>(
+            getEnvironmentInteger("MANGO_LOG_FILE_SIZE").value_or(64), 1)
+                    * Mebibyte},
+        .rotation_interval {std::chrono::seconds {
+            static_cast<std::chrono::seconds::rep>(
+                getEnvironmentInteger("MANGO_LOG_FILE_ROTATION").value_or(0))}},
+        .maximum_files {
+            getEnvironmentInteger("MANGO_LOG_FILE_COUNT").value_or(8)},
+    };
+}
+
+util::detail::MappedLogFile::MappedLogFile(Configuration configuration_)
+    : configuration {std::move(configuration_)}
+    , run_name {}
+    , file_name {}
+    , file_descriptor {-1}
+    , mapping {nullptr}
+    , used {0}
+    , index {0}
+    , opened_at {0}
+    , failed {false}
+{
+    this->run_name = fmt::format(
+        "{}.{:%Y%m%d-%H%M%S}",
+        this->configuration.path,
+        fmt::localtime(std::time(nullptr)));
+
+    // Long enough that naming later files doesn't allocate
+    this->file_name.reserve(this->run_name.size() + 32);
+}
+
+util::detail::MappedLogFile::~MappedLogFile()
+{
+    this->close();
+}
+
+void util::detail::MappedLogFile::write(
+    std::string_view output, std::int64_t timestamp)
+{
+    const std::int64_t rotationInterval =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            this->configuration.rotation_interval)
+            .count();
+
+    if (this->mapping != nullptr && rotationInterval != 0
+        && timestamp - this->opened_at >= rotationInterval)
+    {
+        this->close();
+        ++this->index;
+    }
+
+    while (!output.empty() && !this->failed)
+    {
+        if (this->mapping == nullptr && !this->open(timestamp))
+        {
+            this->failed = true;
+
+            return;
+        }
+
+        const std::size_t count = std::min(
+            output.size(), this->configuration.file_size - this->used);
+
+        std::memcpy(this->mapping + this->used, output.data(), count);
+
+        this->used += count;
+        output.remove_prefix(count);
+
+        if (this->used == this->configuration.file_size)
+        {
+            this->close();
+            ++this->index;
+        }
+    }
+}
+
+bool util::detail::MappedLogFile::open(std::int64_t timestamp)
+{
+#ifdef _WIN32
+    static_cast<void>(timestamp);
+
+    std::cerr << "MANGO_LOG_FILE isn't supported on Windows\n";
+
+    return false;
+#else
+    const auto formatFileName = [this](std::size_t fileIndex)
+    {
+        this->file_name.clear();
+        fmt::format_to(
+            std::back_inserter(this->file_name),
+            "{}.{}",
+            this->run_name,
+            fileIndex);
+    };
+
+    if (this->configuration.maximum_files != 0
+        && this->index >= this->configuration.maximum_files)
+    {
+        formatFileName(this->index - this->configuration.maximum_files);
+
+        static_cast<void>(::unlink(this->file_name.c_str()));
+    }
+
+    formatFileName(this->index);
+
+    // NOLINTNEXTLINE: vararg
+    const int descriptor = ::open(
+        this->file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (descriptor < 0)
+    {
+        reportError("open", this->file_name);
+
+        return false;
+    }
+
+    if (::ftruncate(
+            descriptor, static_cast<off_t>(this->configuration.file_size))
+        != 0)
+    {
+        reportError("size", this->file_name);
+        static_cast<void>(::close(descriptor));
+
+        return false;
+    }
+
+    void* mapped = ::mmap(
+        nullptr,
+        this->configuration.file_size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        descriptor,
+        0);
+
+    if (mapped == MAP_FAILED) // NOLINT: cast in the macro
+    {
+        reportError("map", this->file_name);
+        static_cast<void>(::close(descriptor));
+
+        return false;
+    }
+
+    // Written front to back and never read
+    static_cast<void>(::madvise(
+        mapped, this->configuration.file_size, MADV_SEQUENTIAL));
+
+    this->file_descriptor = descriptor;
+    this->mapping         = static_cast<char*>(mapped);
+    this->used            = 0;
+    this->opened_at       = timestamp;
+
+    return true;
+#endif // _WIN32
+}
+
+void util::detail::MappedLogFile::close()
+{
+#ifndef _WIN32
+    if (this->mapping == nullptr)
+    {
+        return;
+    }
+
+    static_cast<void>(::munmap(this->mapping, this->configuration.file_size));
+
+    // Drops the zeroes past what was written
+    if (::ftruncate(this->file_descriptor, static_cast<off_t>(this->used))
+        != 0)
+    {
+        reportError("truncate", this->file_name);
+    }
+
+    static_cast<void>(::close(this->file_descriptor));
+
+    this->file_descriptor = -1;
+    this->mapping         = nullptr;
+    this->used            = 0;
+#endif // _WIN32
+}
@@ -0,0 +1,71 @@
+#ifndef SRC_UTIL_LOG__FILE_HPP
+#define SRC_UTIL_LOG__FILE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace util::detail
+{
+    /// Text log written through a pre-sized shared memory mapping, so that
+    /// writing to it is a memcpy rather than a syscall
+    ///
+    /// Each run writes to <path>.<start time>.<index>, moving on to the next
+    /// index once a file is full or older than the rotation interval. Files
+    /// are truncated to what was written when they're closed. After a crash
+    /// the tail of the last one is zeroes, but everything before it is
+    /// already in the page cache.
+    ///
+    /// Only used from the logger thread.
+    class MappedLogFile
+    {
+    public:
+        struct Configuration
+        {
+            std::string          path;
+            std::size_t          file_size;
+            /// Zero never rotates by time
+            std::chrono::seconds rotation_interval;
+            /// The oldest files of this run are deleted past this, zero
+            /// keeps every one of them
+            std::size_t          maximum_files;
+
+            /// Enabled by MANGO_LOG_FILE=<path>, with MANGO_LOG_FILE_SIZE in
+            /// MiB (64), MANGO_LOG_FILE_ROTATION in seconds (0) and
+            /// MANGO_LOG_FILE_COUNT (8)
+            static std::optional<Configuration> fromEnvironment();
+        };
+    public:
+        explicit MappedLogFile(Configuration);
+        ~MappedLogFile();
+
+        MappedLogFile(const MappedLogFile&)             = delete;
+        MappedLogFile(MappedLogFile&&)                  = delete;
+        MappedLogFile& operator= (const MappedLogFile&) = delete;
+        MappedLogFile& operator= (MappedLogFile&&)      = delete;
+
+        /// Timestamp is of the newest line in nanoseconds since the
+        /// system_clock epoch and decides when to rotate by time
+        void write(std::string_view, std::int64_t timestamp);
+
+    private:
+        bool open(std::int64_t timestamp);
+        void close();
+
+        Configuration configuration;
+        std::string   run_name;
+        std::string   file_name;
+        int           file_descriptor;
+        char*         mapping;
+        std::size_t   used;
+        std::size_t   index;
+        std::int64_t  opened_at;
+        /// Set once a file couldn't be opened, nothing is written after
+        bool          failed;
+    };
+} // namespace util::detail
+
+#endif // SRC_UTIL_LOG__FILE_HPP
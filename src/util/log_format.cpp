@@ -0,0 +1,181 @@
+#include "log_format.hpp"
+#include "log.hpp"
+#include <array>
+#include <charconv>
+#include <ctime>
+#include <iterator>
+#include <stdexcept>
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#include <fmt/args.h>
+#include <fmt/chrono.h>
+#pragma clang diagnostic pop
+
+// Doesn't log anything itself, this runs on the logger thread and in
+// mango_log_decode
+
+namespace
+{
+    template<class T>
+    T read(std::span<const std::byte>& bytes)
+    {
+        if (bytes.size() < sizeof(T))
+        {
+            throw std::runtime_error {"Truncated log record arguments"};
+        }
+
+        T output {};
+
+        std::memcpy(&output, bytes.data(), sizeof(T));
+        bytes = bytes.subspan(sizeof(T));
+
+        return output;
+    }
+
+    /// Zero padded to the size of output
+    template<std::size_t N>
+    void writeDigits(std::span<char, N> output, std::uint64_t value)
+    {
+        for (auto it = output.rbegin(); it != output.rend(); ++it)
+        {
+            *it = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+    }
+} // namespace
+
+void util::detail::appendArguments(
+    std::string&               output,
+    std::string_view           format,
+    std::span<const std::byte> arguments,
+    std::size_t                numberOfArguments)
+{
+    // Reused so that it doesn't allocate once it's grown
+    thread_local fmt::dynamic_format_arg_store<fmt::format_context> store {};
+    store.clear();
+
+    for (std::size_t i = 0; i < numberOfArguments; ++i)
+    {
+        switch (read<ArgumentType>(arguments))
+        {
+        case ArgumentType::Bool:
+            store.push_back(read<std::uint64_t>(arguments) != 0);
+            break;
+        case ArgumentType::Char:
+            store.push_back(static_cast<char>(read<std::uint64_t>(arguments)));
+            break;
+        case ArgumentType::Signed:
+            store.push_back(read<std::int64_t>(arguments));
+            break;
+        case ArgumentType::Unsigned:
+            store.push_back(read<std::uint64_t>(arguments));
+            break;
+        case ArgumentType::Float:
+            store.push_back(static_cast<float>(read<double>(arguments)));
+            break;
+        case ArgumentType::Double:
+            store.push_back(read<double>(arguments));
+            break;
+        case ArgumentType::Pointer:
+            store.push_back(reinterpret_cast<const void*>( // NOLINT
+                static_cast<std::uintptr_t>(read<std::uint64_t>(arguments))));
+            break;
+        case ArgumentType::String: {
+            const std::uint32_t length = read<std::uint32_t>(arguments);
+
+            if (arguments.size() < length)
+            {
+                throw std::runtime_error {"Truncated log record string"};
+            }
+
+            // Referenced rather than copied by the store, arguments outlives
+            // it being used
+            store.push_back(fmt::string_view {
+                reinterpret_cast<const char*>(arguments.data()), // NOLINT
+                length});
+            arguments = arguments.subspan(length);
+            break;
+        }
+        default:
+            throw std::runtime_error {"Invalid log argument type"};
+        }
+    }
+
+    fmt::vformat_to(std::back_inserter(output), format, store);
+}
+
+util::detail::LineFormatter::LineFormatter()
+    : cached_second {-1}
+    , cached_time {}
+{}
+
+void util::detail::LineFormatter::appendPrefix(
+    std::string&     output,
+    std::int64_t     timestamp,
+    std::string_view file,
+    std::size_t      line,
+    Level            level)
+{
+    constexpr std::int64_t NanosecondsPerSecond {1'000'000'000};
+
+    const std::int64_t second   = timestamp / NanosecondsPerSecond;
+    const std::int64_t fraction = timestamp % NanosecondsPerSecond;
+
+    if (second != this->cached_second)
+    {
+        this->cached_second = second;
+        this->cached_time   = fmt::format(
+            "[{:%b %m/%d/%Y %I:%M:%S}:",
+            fmt::localtime(static_cast<std::time_t>(second)));
+    }
+
+    // Appended piece by piece, this is most of the work of formatting a
+    // line and fmt::format_to would parse the format string every time
+    std::array<char, 8> subsecond {};
+    writeDigits(
+        std::span {subsecond}.first<3>(),
+        static_cast<std::uint64_t>(fraction / 1'000'000));
+    subsecond[3] = ':';
+    writeDigits(
+        std::span {subsecond}.subspan<4, 3>(),
+        static_cast<std::uint64_t>(fraction / 1'000 % 1'000));
+    subsecond[7] = ']';
+
+    std::array<char, 20> lineNumber {};
+    char* lineNumberEnd =
+        std::to_chars(
+            lineNumber.data(), lineNumber.data() + lineNumber.size(), line)
+            .ptr;
+
+    output += this->cached_time;
+    output.append(subsecond.data(), subsecond.size());
+    output += " [";
+    output += file;
+    output += ':';
+    output.append(lineNumber.data(), lineNumberEnd);
+    output += "] [";
+    output += getLevelName(level);
+    output += "] ";
+}
+
+std::string_view util::detail::getLevelName(Level l)
+{
+    using enum util::Level;
+
+    switch (l)
+    {
+    case Trace:
+        return "Trace";
+    case Debug:
+        return "Debug";
+    case Log:
+        return "Log";
+    case Warn:
+        return "Warn";
+    case Fatal:
+        return "Fatal";
+    }
+
+    return "Unknown";
+}
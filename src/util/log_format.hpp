@@ -0,0 +1,261 @@
+#ifndef SRC_UTIL_LOG__FORMAT_HPP
+#define SRC_UTIL_LOG__FORMAT_HPP
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Encoding shared by the logger, which defers formatting to its own thread,
+// and by mango_log_decode, which formats binary logs after the fact
+//
+// A deferred record is a RecordHeader followed by every argument as a one
+// byte ArgumentType and then either 8 bytes of value or, for strings, a 4
+// byte length and the characters. Only types whose formatted output doesn't
+// depend on anything but those bytes are deferred, everything else is
+// formatted on the calling thread as before.
+
+namespace util
+{
+    enum class Level : std::uint8_t;
+
+    static constexpr std::array<std::string_view, 2> FOLDER_IDENTIFIERS {
+        "/src/", "/inc/"};
+
+    namespace detail
+    {
+        /// Strips everything up to and including the first folder in
+        /// FOLDER_IDENTIFIERS, SourceLocation::current does this at compile
+        /// time
+        constexpr std::string_view trimSourcePath(std::string_view path)
+        {
+            for (std::string_view folder : FOLDER_IDENTIFIERS)
+            {
+                if (std::size_t index = path.find(folder);
+                    index != std::string_view::npos)
+                {
+                    return path.substr(index + 1);
+                }
+            }
+
+            return path;
+        }
+
+        enum class ArgumentType : std::uint8_t
+        {
+            Bool,
+            Char,
+            Signed,
+            Unsigned,
+            Float,
+            Double,
+            Pointer,
+            String,
+        };
+
+        template<class T>
+        concept StringArgument =
+            std::same_as<std::decay_t<T>, std::string>
+            || std::same_as<std::decay_t<T>, std::string_view>
+            || std::same_as<std::decay_t<T>, const char*>
+            || std::same_as<std::decay_t<T>, char*>;
+
+        template<class T>
+        concept DeferrableArgument =
+            StringArgument<T> || std::same_as<std::decay_t<T>, bool>
+            || std::same_as<std::decay_t<T>, char>
+            || std::same_as<std::decay_t<T>, float>
+            || std::same_as<std::decay_t<T>, double>
+            || std::same_as<std::decay_t<T>, const void*>
+            || std::same_as<std::decay_t<T>, void*>
+            || std::same_as<std::decay_t<T>, std::nullptr_t>
+            || (std::integral<std::decay_t<T>>
+                && !std::same_as<std::decay_t<T>, wchar_t>
+                && !std::same_as<std::decay_t<T>, char8_t>
+                && !std::same_as<std::decay_t<T>, char16_t>
+                && !std::same_as<std::decay_t<T>, char32_t>);
+
+        /// Immediately followed by number_of_arguments encoded arguments
+        struct RecordHeader
+        {
+            /// Of the whole record, 0 marks the rest of a ring buffer as
+            /// unused so this has to be first
+            std::uint32_t size;
+            std::uint32_t line;
+            Level         level;
+            std::uint8_t  number_of_arguments;
+            std::uint32_t format_size;
+            /// Nanoseconds since the system_clock epoch
+            std::int64_t  timestamp;
+            /// Both of these have static storage duration
+            const char*   format;
+            const char*   file;
+        };
+
+        template<StringArgument T>
+        std::string_view toStringView(const T& t)
+        {
+            if constexpr (std::is_array_v<T>)
+            {
+                return std::string_view {t};
+            }
+            else if constexpr (std::is_pointer_v<T>)
+            {
+                return t == nullptr ? std::string_view {"(null)"}
+                                    : std::string_view {t};
+            }
+            else
+            {
+                return std::string_view {t};
+            }
+        }
+
+        template<DeferrableArgument T>
+        constexpr std::size_t getEncodedSize(const T& t)
+        {
+            if constexpr (StringArgument<T>)
+            {
+                return 1 + sizeof(std::uint32_t) + toStringView(t).size();
+            }
+            else
+            {
+                return 1 + sizeof(std::uint64_t);
+            }
+        }
+
+        /// Returns one past the end of what was written
+        template<DeferrableArgument T>
+        std::byte* encodeArgument(std::byte* output, const T& t)
+        {
+            using D = std::decay_t<T>;
+
+            const auto write = [&](ArgumentType type, const auto& value)
+            {
+                std::memcpy(output, &type, 1);
+                std::memcpy(output + 1, &value, sizeof(value));
+
+                return output + 1 + sizeof(value);
+            };
+
+            if constexpr (StringArgument<T>)
+            {
+                const std::string_view string = toStringView(t);
+
+                std::byte* end = write(
+                    ArgumentType::String,
+                    static_cast<std::uint32_t>(string.size()));
+
+                std::memcpy(end, string.data(), string.size());
+
+                return end + string.size();
+            }
+            else if constexpr (std::same_as<D, bool>)
+            {
+                return write(
+                    ArgumentType::Bool, static_cast<std::uint64_t>(t));
+            }
+            else if constexpr (std::same_as<D, char>)
+            {
+                return write(
+                    ArgumentType::Char, static_cast<std::uint64_t>(t));
+            }
+            else if constexpr (std::same_as<D, float>)
+            {
+                // Widened, the Float type tag keeps it being formatted as a
+                // float
+                return write(ArgumentType::Float, static_cast<double>(t));
+            }
+            else if constexpr (std::same_as<D, double>)
+            {
+                return write(ArgumentType::Double, t);
+            }
+            else if constexpr (
+                std::is_pointer_v<D> || std::same_as<D, std::nullptr_t>)
+            {
+                return write(
+                    ArgumentType::Pointer,
+                    static_cast<std::uint64_t>(
+                        reinterpret_cast<std::uintptr_t>(
+                            static_cast<const void*>(t))));
+            }
+            else if constexpr (std::is_signed_v<D>)
+            {
+                return write(
+                    ArgumentType::Signed, static_cast<std::int64_t>(t));
+            }
+            else
+            {
+                return write(
+                    ArgumentType::Unsigned, static_cast<std::uint64_t>(t));
+            }
+        }
+
+        /// Appends format formatted with the arguments encoded by
+        /// encodeArgument to output
+        void appendArguments(
+            std::string&               output,
+            std::string_view           format,
+            std::span<const std::byte> arguments,
+            std::size_t                numberOfArguments);
+
+        /// Formats the start of each line of output, up to the message
+        ///
+        /// The date and time down to the second are only formatted when the
+        /// second changes, every other line only formats the fraction.
+        class LineFormatter
+        {
+        public:
+            LineFormatter();
+            ~LineFormatter() = default;
+
+            LineFormatter(const LineFormatter&)             = delete;
+            LineFormatter(LineFormatter&&)                  = default;
+            LineFormatter& operator= (const LineFormatter&) = delete;
+            LineFormatter& operator= (LineFormatter&&)      = default;
+
+            /// Timestamp is in nanoseconds since the system_clock epoch and
+            /// file is expected to already be trimmed
+            void appendPrefix(
+                std::string&     output,
+                std::int64_t     timestamp,
+                std::string_view file,
+                std::size_t      line,
+                Level            level);
+
+        private:
+            std::int64_t cached_second;
+            std::string  cached_time;
+        };
+
+        std::string_view getLevelName(Level);
+
+        // Binary log files start with BinaryLogMagic and BinaryLogVersion,
+        // followed by any number of entries that each start with a one byte
+        // BinaryLogEntry
+        //
+        // StringDefinition: 4 byte id, 4 byte length and the characters
+        // Record:           8 byte timestamp, 1 byte Level, 4 byte line,
+        //                   4 byte file id, 4 byte format id, 1 byte number
+        //                   of arguments, 4 byte size of the arguments and
+        //                   then the encoded arguments
+        //
+        // Every string is defined once before the first record that uses it.
+        // Everything is in the byte order of the machine that wrote it.
+        constexpr std::array<char, 8> BinaryLogMagic {
+            'M', 'A', 'N', 'G', 'O', 'L', 'O', 'G'};
+        constexpr std::uint32_t BinaryLogVersion {1};
+
+        enum class BinaryLogEntry : std::uint8_t
+        {
+            StringDefinition,
+            Record,
+        };
+    } // namespace detail
+} // namespace util
+
+#endif // SRC_UTIL_LOG__FORMAT_HPP
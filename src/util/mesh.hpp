@@ -0,0 +1,106 @@
+#ifndef SRC_UTIL_MESH_HPP
+#define SRC_UTIL_MESH_HPP
+
+#include "util/glm.hpp"
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace util
+{
+    using MeshIndex = std::uint32_t;
+
+    /// Doesn't depend on any graphics api, gfx::vulkan::Vertex is this same
+    /// type so meshes are uploaded without being converted
+    ///
+    /// NOTE:
+    /// If you change any of these, dont forget to update their
+    /// corresponding structs in the shaders and the attribute descriptions
+    /// in gfx/vulkan/gpu_data.hpp!
+    struct MeshVertex
+    {
+        glm::vec3 position;
+        glm::vec4 color;
+        glm::vec3 normal;
+        glm::vec2 uv;
+
+        [[nodiscard]] bool operator== (const MeshVertex&) const = default;
+        [[nodiscard]] std::partial_ordering
+        operator<=> (const MeshVertex& other) const
+        {
+#define EMIT_ORDERING(field)                                                   \
+    if (this->field <=> other.field != std::partial_ordering::equivalent)      \
+    {                                                                          \
+        return this->field <=> other.field;                                    \
+    }
+            EMIT_ORDERING(position.x)
+            EMIT_ORDERING(position.y)
+            EMIT_ORDERING(position.z)
+
+            EMIT_ORDERING(color.r)
+            EMIT_ORDERING(color.g)
+            EMIT_ORDERING(color.b)
+
+            EMIT_ORDERING(normal.x)
+            EMIT_ORDERING(normal.y)
+            EMIT_ORDERING(normal.z)
+
+            EMIT_ORDERING(uv.x)
+            EMIT_ORDERING(uv.y)
+
+#undef EMIT_ORDERING
+
+            return std::partial_ordering::equivalent;
+        }
+    };
+
+    /// Indexed triangle list
+    struct Mesh
+    {
+        std::vector<MeshVertex> vertices;
+        std::vector<MeshIndex>  indices;
+    };
+} // namespace util
+
+// MeshVertex hash implementation
+namespace std
+{
+    template<>
+    struct hash<util::MeshVertex>
+    {
+        [[nodiscard]] auto
+        operator() (const util::MeshVertex& vertex) const noexcept -> size_t
+        {
+            std::size_t      seed {0};
+            std::hash<float> hasher;
+
+            auto hashCombine = [](std::size_t& seed_, std::size_t hash_)
+            {
+                hash_ += 0x9e3779b9 + (seed_ << 6) + (seed_ >> 2);
+                seed_ ^= hash_;
+            };
+
+            hashCombine(seed, hasher(vertex.position.x));
+            hashCombine(seed, hasher(vertex.position.y));
+            hashCombine(seed, hasher(vertex.position.z));
+
+            hashCombine(seed, hasher(vertex.color.x));
+            hashCombine(seed, hasher(vertex.color.y));
+            hashCombine(seed, hasher(vertex.color.z));
+
+            hashCombine(seed, hasher(vertex.normal.x));
+            hashCombine(seed, hasher(vertex.normal.y));
+            hashCombine(seed, hasher(vertex.normal.z));
+
+            hashCombine(seed, hasher(vertex.uv.x));
+            hashCombine(seed, hasher(vertex.uv.y));
+
+            return seed;
+        }
+    };
+
+} // namespace std
+
+#endif // SRC_UTIL_MESH_HPP
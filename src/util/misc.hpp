@@ -3,10 +3,12 @@
 
 #include <array>
 #include <concepts>
+#include <cstddef>
 #include <cstdint>
 #include <exception>
 #include <fmt/format.h>
 #include <numeric>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
@@ -118,6 +120,22 @@ namespace util
         return ~out;
     }
 
+    /// Pass the output of a previous call as previous to continue hashing a
+    /// stream of data that is split over several calls
+    [[nodiscard]] constexpr inline std::uint64_t
+    crc64(std::span<const std::byte> input, std::uint64_t previous = 0) noexcept
+    {
+        std::uint64_t out = ~previous;
+
+        for (std::byte b : input)
+        {
+            out = (out >> 8)
+                ^ CRCConstants[(out ^ static_cast<std::uint8_t>(b)) & 0xFF];
+        }
+
+        return ~out;
+    }
+
     template<class T>
     constexpr inline T
     map(T x, T in_min, T in_max, T out_min, T out_max) noexcept
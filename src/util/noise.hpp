@@ -9,19 +9,23 @@
 #include <cstdint>
 #include <numbers>
 #include <random>
+#include <span>
 #include <tuple>
+#include <util/log.hpp>
 #include <util/misc.hpp>
+#include <utility>
 
 ///
 /// This entire implementation is unceremoniously sz`tolen from the wikipedia
 /// page on perlin noise
 /// https://en.wikipedia.org/w/index.php?title=Perlin_noise&oldid=1148235423
 ///
+/// The simplex noise follows Stefan Gustavson's "Simplex noise demystified"
+/// generalized to N dimensions
+///
 
 namespace util
 {
-    // TODO: N dimensional noise
-
     class FastMCG
     {
     public:
@@ -91,40 +95,65 @@ namespace util
              + leftBound;
     }
 
+    /// Branchless floor that is usable in constant expressions
+    template<Integer I, std::floating_point T>
+    constexpr inline I fastFloor(T value)
+    {
+        const I truncated = static_cast<I>(value);
+
+        return truncated - static_cast<I>(value < static_cast<T>(truncated));
+    }
+
     template<std::size_t N> // TODO: replace with some AbsolutePosition
-    constexpr inline Vec2 randomGradient(Vector<std::int64_t, N> vector)
+    constexpr inline Vector<float, N>
+    randomGradient(Vector<std::int64_t, N> vector, std::uint64_t seed = 0)
     {
         std::uint64_t workingSeed {
-            std::bit_cast<std::uint64_t>(78234748926789234)};
+            std::bit_cast<std::uint64_t>(78234748926789234) ^ seed};
 
         for (std::int64_t i : vector.data)
         {
-            util::hashCombine(workingSeed, i);
+            util::hashCombine(workingSeed, static_cast<std::size_t>(i));
         }
 
         FastMCG engine {workingSeed};
 
-        float random =
-            engine.nextInRange<float>(0.0f, std::numbers::pi_v<float> * 2);
-
-        // gcem is ~3-5x slower than std, try and avoid it
-        if consteval
+        if constexpr (N == 2)
         {
-            return Vec2 {gcem::cos(random), gcem::sin(random)};
+            float random =
+                engine.nextInRange<float>(0.0f, std::numbers::pi_v<float> * 2);
+
+            // gcem is ~3-5x slower than std, try and avoid it
+            if consteval
+            {
+                return Vec2 {gcem::cos(random), gcem::sin(random)};
+            }
+            else
+            {
+                return Vec2 {std::cos(random), std::sin(random)};
+            }
         }
         else
         {
-            return Vec2 {std::cos(random), std::sin(random)};
+            Vector<float, N> gradient {};
+
+            for (float& f : gradient.data)
+            {
+                f = engine.nextInRange<float>(-1.0f, 1.0f);
+            }
+
+            return gradient.normalize();
         }
     }
 
     template<std::size_t N>
     constexpr inline float dotGridGradient(
         Vector<std::int64_t, N> position,
-        Vector<float, N>        perlinGridGranularity)
+        Vector<float, N>        perlinGridGranularity,
+        std::uint64_t           seed)
     {
         // Get gradient from integer coordinates
-        const Vec2 gradient = randomGradient(position);
+        const Vector<float, N> gradient = randomGradient(position, seed);
 
         // Compute the distance vector
         const Vector<float, N> offset {
@@ -133,40 +162,372 @@ namespace util
         return offset.dot(gradient);
     }
 
-    // Compute Perlin noise at coordinates x, y
+    /// Computes N dimensional Perlin noise at the given coordinates
+    ///
+    /// Every one of the 2^N surrounding lattice points derives its gradient
+    /// from an MCG seeded by its position, so this is the slow, reference
+    /// quality path. Prefer `simplex` for anything evaluated per voxel.
     // TODO: replace with some AbsolutePosition with an int64 + a float
-    // TODO: add seeds
-    constexpr inline float perlin(Vec2 vector) // TODO: make generic
+    template<std::size_t N>
+    constexpr inline float
+    perlin(Vector<float, N> vector, std::uint64_t seed = 0)
+        requires (N > 0)
+    {
+        const Vector<std::int64_t, N> BaseGrid = [&]<std::size_t... I>(
+                                                     std::index_sequence<I...>)
+        {
+            return Vector<std::int64_t, N> {
+                fastFloor<std::int64_t>(vector[I])...};
+        }(std::make_index_sequence<N> {});
+
+        const Vector<float, N> OffsetIntoGrid {
+            vector - static_cast<Vector<float, N>>(BaseGrid)};
+
+        // Bit i of the corner's index selects the upper side of axis i
+        constexpr std::size_t NumberOfCorners {std::size_t {1} << N};
+
+        std::array<float, NumberOfCorners> gradients {};
+
+        for (std::size_t corner = 0; corner < NumberOfCorners; ++corner)
+        {
+            Vector<std::int64_t, N> cornerPosition {BaseGrid};
+
+            for (std::size_t axis = 0; axis < N; ++axis)
+            {
+                cornerPosition[axis] +=
+                    static_cast<std::int64_t>((corner >> axis) & 1);
+            }
+
+            gradients[corner] = dotGridGradient(cornerPosition, vector, seed);
+        }
+
+        // Collapse one axis at a time, halving the working set each step
+        std::size_t remaining = NumberOfCorners;
+
+        for (std::size_t axis = 0; axis < N; ++axis)
+        {
+            remaining /= 2;
+
+            for (std::size_t i = 0; i < remaining; ++i)
+            {
+                gradients[i] = quarticInterpolate(
+                    gradients[2 * i],
+                    gradients[2 * i + 1],
+                    OffsetIntoGrid[axis]);
+            }
+        }
+
+        return gradients[0];
+    }
+
+    /// Invokes `func` with std::integral_constant<std::size_t, I> for every I
+    /// in [0, N), unrolled at compile time
+    ///
+    /// The noise kernels rely on this rather than the optimizer's unrolling
+    /// heuristics, their outer loops only vectorize once the inner ones are
+    /// gone.
+    template<std::size_t N, class F>
+    [[gnu::always_inline]] constexpr inline void unrolledFor(F&& func)
+    {
+        [&]<std::size_t... I>(std::index_sequence<I...>)
+        {
+            (func(std::integral_constant<std::size_t, I> {}), ...);
+        }(std::make_index_sequence<N> {});
+    }
+
+    /// Primes used to decorrelate the axes of a lattice point before hashing
+    constexpr std::array<std::uint32_t, 4> LatticeHashPrimes {
+        501'125'321U, 1'136'930'381U, 1'720'413'743U, 1'066'037'191U};
+
+    template<std::size_t N>
+    [[gnu::always_inline]] constexpr inline std::uint32_t
+    hashLatticePoint(
+        const std::array<std::int32_t, N>& point, std::uint32_t seed)
+        requires (N <= LatticeHashPrimes.size())
     {
-        const Vector<std::int64_t, 2> BottomLeftGrid {
-            static_cast<std::int64_t>(std::floor(vector.x())),
-            static_cast<std::int64_t>(std::floor(vector.y())),
-        };
+        std::uint32_t hash = seed;
 
-        const Vector<std::int64_t, 2> TopRightGrid {BottomLeftGrid + 1};
+        unrolledFor<N>(
+            [&](std::size_t i)
+            {
+                hash ^= static_cast<std::uint32_t>(point[i])
+                      * LatticeHashPrimes[i];
+            });
 
-        const Vector<std::int64_t, 2> BottomRightGrid {
-            BottomLeftGrid.x(), TopRightGrid.y()};
+        hash *= 0x27D4'EB2DU;
+        hash ^= hash >> 15;
 
-        const Vector<std::int64_t, 2> TopLeftGrid {
-            TopRightGrid.x(), BottomLeftGrid.y()};
+        return hash;
+    }
+
+    /// Dot product of `offset` with the gradient selected by `hash`
+    ///
+    /// The gradients are the midpoints of the edges of the N-cube (every
+    /// component is +-1 except for one zero), in 2D the diagonals are also
+    /// included. Everything is selects and integer math so that batches of
+    /// these vectorize.
+    template<std::size_t N>
+    [[gnu::always_inline]] constexpr inline float
+    hashedGradientDot(std::uint32_t hash, const std::array<float, N>& offset)
+    {
+        constexpr std::uint32_t ZeroAxisChoices {N == 2 ? 3 : N};
+        const std::uint32_t     zeroAxis {(hash >> N) % ZeroAxisChoices};
+
+        float output {0.0f};
 
-        const Vec2 OffsetIntoGrid {vector - static_cast<Vec2>(BottomLeftGrid)};
+        unrolledFor<N>(
+            [&](std::size_t i)
+            {
+                const float component =
+                    ((hash >> i) & 1U) ? -offset[i] : offset[i];
 
-        const float LeftGradient = quarticInterpolate(
-            dotGridGradient(BottomLeftGrid, vector),
-            dotGridGradient(TopLeftGrid, vector),
-            OffsetIntoGrid.x());
+                output += (zeroAxis == i) ? 0.0f : component;
+            });
 
-        const float RightGradient = quarticInterpolate(
-            dotGridGradient(BottomRightGrid, vector),
-            dotGridGradient(TopRightGrid, vector),
-            OffsetIntoGrid.x());
+        return output;
+    }
 
-        return quarticInterpolate(
-            LeftGradient, RightGradient, OffsetIntoGrid.y());
+    /// Simplex noise at `point`, returned in roughly [-1, 1]
+    ///
+    /// This is the kernel behind `simplex`, `simplexBatch` and `simplexRow`.
+    /// It only touches N + 1 lattice points (rather than Perlin's 2^N) and is
+    /// written without data dependent branches so that the batch variants
+    /// auto vectorize under -march=native.
+    template<std::size_t N>
+    [[gnu::always_inline]] constexpr inline float
+    simplexKernel(const std::array<float, N>& point, std::uint32_t seed)
+        requires (N >= 2 && N <= 4)
+    {
+        constexpr float Dimension {static_cast<float>(N)};
+        constexpr float Skew {
+            (gcem::sqrt(Dimension + 1.0f) - 1.0f) / Dimension};
+        constexpr float Unskew {
+            (1.0f - 1.0f / gcem::sqrt(Dimension + 1.0f)) / Dimension};
+
+        // Radius^2 of each vertex's contribution, 0.5 keeps every dimension
+        // continuous across simplex boundaries
+        constexpr float Falloff {0.5f};
+
+        // Normalizes the output to roughly [-1, 1], found empirically
+        constexpr std::array<float, 5> Scales {
+            0.0f, 0.0f, 70.1f, 76.8f, 62.8f};
+
+        float skewedSum {0.0f};
+        unrolledFor<N>(
+            [&](std::size_t i)
+            {
+                skewedSum += point[i];
+            });
+        skewedSum *= Skew;
+
+        std::array<std::int32_t, N> cell {};
+        std::int32_t                cellSum {0};
+
+        unrolledFor<N>(
+            [&](std::size_t i)
+            {
+                cell[i] = fastFloor<std::int32_t>(point[i] + skewedSum);
+                cellSum += cell[i];
+            });
+
+        const float unskewedSum {static_cast<float>(cellSum) * Unskew};
+
+        std::array<float, N> originOffset {};
+
+        unrolledFor<N>(
+            [&](std::size_t i)
+            {
+                originOffset[i] =
+                    point[i] - (static_cast<float>(cell[i]) - unskewedSum);
+            });
+
+        // The rank of each axis determines the order in which the simplex's
+        // vertices step along it
+        std::array<std::int32_t, N> rank {};
+
+        unrolledFor<N>(
+            [&](auto i)
+            {
+                unrolledFor<N - i - 1>(
+                    [&](std::size_t offset)
+                    {
+                        const std::size_t  j = i + offset + 1;
+                        const std::int32_t greater =
+                            originOffset[i] > originOffset[j] ? 1 : 0;
+
+                        rank[i] += greater;
+                        rank[j] += 1 - greater;
+                    });
+            });
+
+        float output {0.0f};
+
+        // GCC refuses to inline this lambda at -O2 on its own, which costs an
+        // order of magnitude
+        unrolledFor<N + 1>(
+            [&](std::size_t vertex) __attribute__((always_inline))
+            {
+                std::array<std::int32_t, N> vertexCell {};
+                std::array<float, N>        vertexOffset {};
+                float                       contribution {Falloff};
+
+                unrolledFor<N>(
+                    [&](std::size_t i)
+                    {
+                        const std::int32_t step =
+                            rank[i] >= static_cast<std::int32_t>(N - vertex)
+                                ? 1
+                                : 0;
+
+                        vertexCell[i] = cell[i] + step;
+                        vertexOffset[i] =
+                            originOffset[i] - static_cast<float>(step)
+                            + static_cast<float>(vertex) * Unskew;
+
+                        contribution -= vertexOffset[i] * vertexOffset[i];
+                    });
+
+                contribution = contribution > 0.0f ? contribution : 0.0f;
+                contribution *= contribution;
+                contribution *= contribution;
+
+                output += contribution
+                        * hashedGradientDot<N>(
+                              hashLatticePoint<N>(vertexCell, seed),
+                              vertexOffset);
+            });
+
+        return output * Scales[N];
+    }
+
+    constexpr inline std::uint32_t foldSeed(std::uint64_t seed)
+    {
+        return static_cast<std::uint32_t>(seed ^ (seed >> 32));
+    }
+
+    template<std::size_t N>
+    constexpr inline float
+    simplex(Vector<float, N> vector, std::uint64_t seed = 0)
+        requires (N >= 2 && N <= 4)
+    {
+        return simplexKernel<N>(vector.data, foldSeed(seed));
+    }
+
+    /// Evaluates simplex noise for a structure of arrays batch of points
+    ///
+    /// `output[i]` receives the noise at {coordinates[0][i], ...,
+    /// coordinates[N - 1][i]}
+    template<std::size_t N>
+    inline void simplexBatch(
+        std::array<std::span<const float>, N> coordinates,
+        std::span<float>                      output,
+        std::uint64_t                         seed = 0)
+        requires (N >= 2 && N <= 4)
+    {
+        for (std::span<const float> c : coordinates)
+        {
+            util::assertFatal(
+                c.size() == output.size(),
+                "Mismatched noise batch sizes | Coordinates: {} | Output: {}",
+                c.size(),
+                output.size());
+        }
+
+        const std::uint32_t foldedSeed = foldSeed(seed);
+
+        for (std::size_t i = 0; i < output.size(); ++i)
+        {
+            std::array<float, N> point {};
+
+            unrolledFor<N>(
+                [&](std::size_t axis)
+                {
+                    point[axis] = coordinates[axis][i];
+                });
+
+            output[i] = simplexKernel<N>(point, foldedSeed);
+        }
+    }
+
+    /// Evaluates simplex noise at `output.size()` points, starting at `start`
+    /// and stepping by `step` along the first axis
+    ///
+    /// This is the shape of a row of voxels, which is how densities are
+    /// sampled, so no coordinate arrays need to be materialized for it.
+    template<std::size_t N>
+    inline void simplexRow(
+        Vector<float, N> start,
+        float            step,
+        std::span<float> output,
+        std::uint64_t    seed = 0)
+        requires (N >= 2 && N <= 4)
+    {
+        const std::uint32_t foldedSeed = foldSeed(seed);
+
+        for (std::size_t i = 0; i < output.size(); ++i)
+        {
+            std::array<float, N> point {start.data};
+
+            point[0] += static_cast<float>(i) * step;
+
+            output[i] = simplexKernel<N>(point, foldedSeed);
+        }
     }
 
 } // namespace util
 
+namespace
+{
+    consteval bool testNoise()
+    {
+        // perlin noise is zero on the lattice
+        {
+            static_assert(util::perlin(util::Vec2 {3.0f, -2.0f}) == 0.0f);
+
+            static_assert(
+                util::perlin(util::Vec3 {1.0f, 0.0f, -4.0f}, 7) == 0.0f);
+        }
+
+        // seeds
+        {
+            constexpr util::Vec3 Position {0.3f, 1.7f, -2.2f};
+
+            static_assert(
+                util::simplex(Position, 1) == util::simplex(Position, 1));
+
+            static_assert(
+                util::simplex(Position, 1) != util::simplex(Position, 2));
+
+            static_assert(
+                util::perlin(util::Vec2 {0.5f, 0.5f}, 0)
+                != util::perlin(util::Vec2 {0.5f, 0.5f}, 1));
+        }
+
+        // range
+        {
+            for (std::size_t i = 0; i < 64; ++i)
+            {
+                const float f = static_cast<float>(i) * 0.37f;
+
+                const float noise2 = util::simplex(util::Vec2 {f, -f});
+                const float noise3 = util::simplex(util::Vec3 {f, -f, 0.5f});
+                const float noise4 =
+                    util::simplex(util::Vec4 {-f, f, 0.5f, f * 2.0f});
+
+                for (float noise : {noise2, noise3, noise4})
+                {
+                    if (noise < -1.0f || noise > 1.0f)
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    static_assert(testNoise());
+} // namespace
+
 #endif // SRC_UTIL_NOISE_HPP
\ No newline at end of file
@@ -0,0 +1,351 @@
+#ifndef SRC_UTIL_PARALLEL_HPP
+#define SRC_UTIL_PARALLEL_HPP
+
+#include "util/threads.hpp"
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <vector>
+
+namespace util
+{
+    namespace detail
+    {
+        /// Chunks per worker when the grain size is chosen automatically,
+        /// more than one so that uneven chunks still balance out
+        constexpr std::size_t ChunksPerWorker {4};
+
+        /// Ranges smaller than this with an automatic grain size are
+        /// processed on the calling thread in one go
+        constexpr std::size_t MinimumParallelSize {2048};
+
+        inline std::size_t
+        chooseGrainSize(std::size_t numberOfElements, std::size_t grainSize)
+        {
+            if (grainSize != 0)
+            {
+                return grainSize;
+            }
+
+            if (numberOfElements < MinimumParallelSize)
+            {
+                return std::max<std::size_t>(1, numberOfElements);
+            }
+
+            const std::size_t target =
+                getThreadPool().getNumberOfWorkers() * ChunksPerWorker;
+
+            return std::max<std::size_t>(
+                1, (numberOfElements + target - 1) / target);
+        }
+
+        /// Calls func(chunkBegin, chunkEnd) over [0, numberOfElements) split
+        /// into chunks of grainSize, blocks until every chunk is done
+        ///
+        /// Chunks are claimed from a shared counter, the calling thread claims
+        /// them too so that this can't deadlock when called from inside a
+        /// pool worker. The first exception thrown by any chunk is rethrown
+        /// here once every claimed chunk has finished.
+        template<class F>
+            requires std::invocable<F&, std::size_t, std::size_t>
+        void forEachChunk(
+            std::size_t numberOfElements, std::size_t grainSize, F& func)
+        {
+            if (numberOfElements == 0)
+            {
+                return;
+            }
+
+            const std::size_t grain =
+                chooseGrainSize(numberOfElements, grainSize);
+            const std::size_t numberOfChunks =
+                (numberOfElements + grain - 1) / grain;
+
+            if (numberOfChunks == 1)
+            {
+                func(std::size_t {0}, numberOfElements);
+
+                return;
+            }
+
+            // Helpers may only be started after the caller has returned, so
+            // everything they touch has to be kept alive by them
+            struct State
+            {
+                std::atomic<std::size_t> next_chunk {0};
+                std::atomic<std::size_t> finished_chunks {0};
+                std::atomic<bool>        failed {false};
+                std::mutex               exception_mutex;
+                std::exception_ptr       exception;
+            };
+
+            std::shared_ptr<State> state = std::make_shared<State>();
+
+            // func is only touched after claiming a chunk and the caller can't
+            // return until every claimed chunk has finished, so it's fine to
+            // capture it by reference even though helpers may outlive it
+            auto runChunks = [=, &func]
+            {
+                while (true)
+                {
+                    const std::size_t chunk = state->next_chunk.fetch_add(1);
+
+                    if (chunk >= numberOfChunks)
+                    {
+                        return;
+                    }
+
+                    if (!state->failed.load(std::memory_order_relaxed))
+                    {
+                        try
+                        {
+                            func(
+                                chunk * grain,
+                                std::min(
+                                    (chunk + 1) * grain, numberOfElements));
+                        }
+                        catch (...)
+                        {
+                            std::unique_lock lock {state->exception_mutex};
+
+                            if (!state->failed.exchange(true))
+                            {
+                                state->exception = std::current_exception();
+                            }
+                        }
+                    }
+
+                    if (state->finished_chunks.fetch_add(1) + 1
+                        == numberOfChunks)
+                    {
+                        state->finished_chunks.notify_all();
+                    }
+                }
+            };
+
+            const std::size_t numberOfHelpers = std::min(
+                numberOfChunks - 1, getThreadPool().getNumberOfWorkers());
+
+            for (std::size_t i = 0; i < numberOfHelpers; ++i)
+            {
+                getThreadPool().addJob(runChunks);
+            }
+
+            runChunks();
+
+            std::size_t finished = state->finished_chunks.load();
+
+            while (finished != numberOfChunks)
+            {
+                state->finished_chunks.wait(finished);
+
+                finished = state->finished_chunks.load();
+            }
+
+            if (state->exception != nullptr)
+            {
+                std::rethrow_exception(state->exception);
+            }
+        }
+    } // namespace detail
+
+    /// Calls func(i) for every i in [begin, end) on the thread pool
+    ///
+    /// A grainSize of 0 picks one automatically.
+    template<std::integral I, class F>
+        requires std::invocable<F&, I>
+    void parallelFor(I begin, I end, F func, std::size_t grainSize = 0)
+    {
+        if (end <= begin)
+        {
+            return;
+        }
+
+        auto chunk = [&](std::size_t chunkBegin, std::size_t chunkEnd)
+        {
+            for (std::size_t i = chunkBegin; i < chunkEnd; ++i)
+            {
+                func(static_cast<I>(begin + static_cast<I>(i)));
+            }
+        };
+
+        detail::forEachChunk(
+            static_cast<std::size_t>(end - begin), grainSize, chunk);
+    }
+
+    /// Calls func on every element of range on the thread pool
+    template<std::ranges::random_access_range R, class F>
+        requires std::invocable<F&, std::ranges::range_reference_t<R>>
+    void parallelFor(R&& range, F func, std::size_t grainSize = 0)
+    {
+        auto first = std::ranges::begin(range);
+
+        auto chunk = [&](std::size_t chunkBegin, std::size_t chunkEnd)
+        {
+            for (std::size_t i = chunkBegin; i < chunkEnd; ++i)
+            {
+                func(first[static_cast<std::ptrdiff_t>(i)]);
+            }
+        };
+
+        detail::forEachChunk(
+            static_cast<std::size_t>(std::ranges::distance(range)),
+            grainSize,
+            chunk);
+    }
+
+    /// Writes transform(input[i]) to output[i] for every element of input
+    template<
+        std::ranges::random_access_range I,
+        std::ranges::random_access_range O,
+        class F>
+        requires std::invocable<F&, std::ranges::range_reference_t<I>>
+    void parallelTransform(
+        I&& input, O&& output, F transform, std::size_t grainSize = 0)
+    {
+        util::assertFatal(
+            std::ranges::distance(output) >= std::ranges::distance(input),
+            "Output of parallelTransform is too small | {} < {}",
+            std::ranges::distance(output),
+            std::ranges::distance(input));
+
+        auto in  = std::ranges::begin(input);
+        auto out = std::ranges::begin(output);
+
+        auto chunk = [&](std::size_t chunkBegin, std::size_t chunkEnd)
+        {
+            for (std::size_t i = chunkBegin; i < chunkEnd; ++i)
+            {
+                const std::ptrdiff_t index = static_cast<std::ptrdiff_t>(i);
+
+                out[index] = transform(in[index]);
+            }
+        };
+
+        detail::forEachChunk(
+            static_cast<std::size_t>(std::ranges::distance(input)),
+            grainSize,
+            chunk);
+    }
+
+    /// Reduces transform(element) over every element of range with reduce,
+    /// which must be associative. Chunks are combined in order so reduce
+    /// doesn't need to be commutative.
+    template<std::ranges::random_access_range R, class T, class F, class Op>
+        requires std::invocable<F&, std::ranges::range_reference_t<R>>
+              && std::invocable<Op&, T, T>
+    T parallelReduce(
+        R&&         range,
+        T           identity,
+        F           transform,
+        Op          reduce,
+        std::size_t grainSize = 0)
+    {
+        const std::size_t numberOfElements =
+            static_cast<std::size_t>(std::ranges::distance(range));
+
+        if (numberOfElements == 0)
+        {
+            return identity;
+        }
+
+        const std::size_t grain =
+            detail::chooseGrainSize(numberOfElements, grainSize);
+
+        std::vector<T> partials(
+            (numberOfElements + grain - 1) / grain, identity);
+
+        auto first = std::ranges::begin(range);
+
+        auto chunk = [&](std::size_t chunkBegin, std::size_t chunkEnd)
+        {
+            T accumulator = identity;
+
+            for (std::size_t i = chunkBegin; i < chunkEnd; ++i)
+            {
+                accumulator = reduce(
+                    std::move(accumulator),
+                    transform(first[static_cast<std::ptrdiff_t>(i)]));
+            }
+
+            partials[chunkBegin / grain] = std::move(accumulator);
+        };
+
+        detail::forEachChunk(numberOfElements, grain, chunk);
+
+        T output = std::move(identity);
+
+        for (T& p : partials)
+        {
+            output = reduce(std::move(output), std::move(p));
+        }
+
+        return output;
+    }
+
+    /// Sorts chunks of range in parallel and then merges them pairwise, also
+    /// in parallel, not stable
+    template<std::ranges::random_access_range R, class C = std::ranges::less>
+        requires std::sortable<std::ranges::iterator_t<R>, C>
+    void parallelSort(R&& range, C compare = {}, std::size_t grainSize = 0)
+    {
+        const std::size_t numberOfElements =
+            static_cast<std::size_t>(std::ranges::distance(range));
+
+        if (numberOfElements < detail::MinimumParallelSize)
+        {
+            std::ranges::sort(range, compare);
+
+            return;
+        }
+
+        const std::size_t grain =
+            detail::chooseGrainSize(numberOfElements, grainSize);
+
+        auto first = std::ranges::begin(range);
+
+        const auto at = [&](std::size_t index)
+        {
+            return first
+                 + static_cast<std::ptrdiff_t>(
+                       std::min(index, numberOfElements));
+        };
+
+        auto sortChunk = [&](std::size_t chunkBegin, std::size_t chunkEnd)
+        {
+            std::sort(at(chunkBegin), at(chunkEnd), std::ref(compare));
+        };
+
+        detail::forEachChunk(numberOfElements, grain, sortChunk);
+
+        // Every pass merges neighbouring runs of width elements
+        for (std::size_t width = grain; width < numberOfElements; width *= 2)
+        {
+            const std::size_t numberOfMerges =
+                (numberOfElements + 2 * width - 1) / (2 * width);
+
+            auto merge = [&](std::size_t mergeBegin, std::size_t mergeEnd)
+            {
+                for (std::size_t m = mergeBegin; m < mergeEnd; ++m)
+                {
+                    std::inplace_merge(
+                        at(m * 2 * width),
+                        at(m * 2 * width + width),
+                        at(m * 2 * width + 2 * width),
+                        std::ref(compare));
+                }
+            };
+
+            // Each merge is already a large chunk of work
+            detail::forEachChunk(numberOfMerges, 1, merge);
+        }
+    }
+} // namespace util
+
+#endif // SRC_UTIL_PARALLEL_HPP
@@ -0,0 +1,233 @@
+#ifndef SRC_UTIL_STATISTICS_HPP
+#define SRC_UTIL_STATISTICS_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace util
+{
+    /// Counter with a single writer and any number of readers
+    ///
+    /// Only uses relaxed loads and stores, so unlike a fetch_add it never
+    /// needs a locked instruction. Intended for statistics that are always
+    /// on.
+    class Counter
+    {
+    public:
+        Counter()
+            : value {0}
+        {}
+
+        /// Writer only
+        void add(std::uint64_t amount = 1) noexcept
+        {
+            this->value.store(
+                this->value.load(std::memory_order_relaxed) + amount,
+                std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] std::uint64_t get() const noexcept
+        {
+            return this->value.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<std::uint64_t> value;
+    };
+
+    /// Log linear histogram in the style of HdrHistogram
+    ///
+    /// Values below SubBuckets are counted exactly, every power of two above
+    /// that is split into SubBuckets linear buckets, so every recorded value
+    /// is known to within 1 / SubBuckets of itself over the whole range of
+    /// std::uint64_t. Has the same single writer rules as Counter.
+    class Histogram
+    {
+    public:
+        static constexpr std::size_t SubBuckets {16};
+        static constexpr std::size_t NumberOfBuckets {
+            SubBuckets + (64 - std::bit_width(SubBuckets) + 1) * SubBuckets};
+
+        /// Plain copy of a Histogram that can be merged and queried
+        class Snapshot
+        {
+        public:
+            Snapshot()
+                : counts {}
+                , count {0}
+                , sum {0}
+                , maximum {0}
+            {}
+
+            /// For a single thread that both records and queries, where
+            /// Histogram's atomics buy nothing
+            void record(std::uint64_t value) noexcept
+            {
+                ++this->counts[getBucketIndex(value)];
+                ++this->count;
+                this->sum += value;
+                this->maximum = std::max(this->maximum, value);
+            }
+
+            void merge(const Snapshot& other)
+            {
+                for (std::size_t i = 0; i < NumberOfBuckets; ++i)
+                {
+                    this->counts[i] += other.counts[i];
+                }
+
+                this->count += other.count;
+                this->sum += other.sum;
+                this->maximum = std::max(this->maximum, other.maximum);
+            }
+
+            [[nodiscard]] std::uint64_t getCount() const
+            {
+                return this->count;
+            }
+
+            [[nodiscard]] std::uint64_t getMaximum() const
+            {
+                return this->maximum;
+            }
+
+            [[nodiscard]] std::uint64_t getMean() const
+            {
+                return this->count == 0 ? 0 : this->sum / this->count;
+            }
+
+            /// Upper bound of the bucket holding the given percentile, in
+            /// [0, 100]
+            [[nodiscard]] std::uint64_t getPercentile(double percentile) const
+            {
+                if (this->count == 0)
+                {
+                    return 0;
+                }
+
+                const std::uint64_t rank = std::max<std::uint64_t>(
+                    1,
+                    static_cast<std::uint64_t>(
+                        percentile / 100.0 * static_cast<double>(this->count)
+                        + 0.5));
+
+                std::uint64_t seen {0};
+
+                for (std::size_t i = 0; i < NumberOfBuckets; ++i)
+                {
+                    seen += this->counts[i];
+
+                    if (seen >= rank)
+                    {
+                        return std::min(getUpperBound(i), this->maximum);
+                    }
+                }
+
+                return this->maximum;
+            }
+
+        private:
+            friend class Histogram;
+
+            std::array<std::uint64_t, NumberOfBuckets> counts;
+            std::uint64_t                              count;
+            std::uint64_t                              sum;
+            std::uint64_t                              maximum;
+        };
+    public:
+        Histogram()
+            : counts {}
+            , count {}
+            , sum {}
+            , maximum {0}
+        {}
+        ~Histogram() = default;
+
+        Histogram(const Histogram&)             = delete;
+        Histogram(Histogram&&)                  = delete;
+        Histogram& operator= (const Histogram&) = delete;
+        Histogram& operator= (Histogram&&)      = delete;
+
+        /// Writer only
+        void record(std::uint64_t value) noexcept
+        {
+            std::atomic<std::uint64_t>& bucket =
+                this->counts[getBucketIndex(value)];
+
+            bucket.store(
+                bucket.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+
+            this->count.add();
+            this->sum.add(value);
+
+            if (value > this->maximum.load(std::memory_order_relaxed))
+            {
+                this->maximum.store(value, std::memory_order_relaxed);
+            }
+        }
+
+        /// Not atomic as a whole, the fields may be off from each other by
+        /// whatever was recorded while this was running
+        [[nodiscard]] Snapshot snapshot() const
+        {
+            Snapshot output {};
+
+            for (std::size_t i = 0; i < NumberOfBuckets; ++i)
+            {
+                output.counts[i] =
+                    this->counts[i].load(std::memory_order_relaxed);
+            }
+
+            output.count   = this->count.get();
+            output.sum     = this->sum.get();
+            output.maximum = this->maximum.load(std::memory_order_relaxed);
+
+            return output;
+        }
+
+    private:
+        static constexpr std::size_t SubBucketBits {
+            std::bit_width(SubBuckets) - 1};
+
+        static std::size_t getBucketIndex(std::uint64_t value) noexcept
+        {
+            if (value < SubBuckets)
+            {
+                return static_cast<std::size_t>(value);
+            }
+
+            // Leaves the top SubBucketBits + 1 bits of value
+            const std::size_t shift = static_cast<std::size_t>(
+                std::bit_width(value) - SubBucketBits - 1);
+
+            return SubBuckets + shift * SubBuckets
+                 + static_cast<std::size_t>((value >> shift) - SubBuckets);
+        }
+
+        static std::uint64_t getUpperBound(std::size_t index) noexcept
+        {
+            if (index < SubBuckets)
+            {
+                return index;
+            }
+
+            const std::size_t   shift = (index - SubBuckets) / SubBuckets;
+            const std::uint64_t top =
+                SubBuckets + (index - SubBuckets) % SubBuckets;
+
+            return ((top + 1) << shift) - 1;
+        }
+
+        std::array<std::atomic<std::uint64_t>, NumberOfBuckets> counts;
+        Counter                                                 count;
+        Counter                                                 sum;
+        std::atomic<std::uint64_t>                              maximum;
+    };
+} // namespace util
+
+#endif // SRC_UTIL_STATISTICS_HPP
@@ -0,0 +1,122 @@
+#include "task.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    class TimerThread
+    {
+    public:
+        TimerThread()
+            : mutex {}
+            , condition {}
+            , timers {}
+            , should_stop {false}
+            , thread {}
+        {
+            this->thread = std::thread {
+                [this]
+                {
+                    this->run();
+                }};
+        }
+
+        ~TimerThread()
+        {
+            {
+                std::unique_lock lock {this->mutex};
+
+                this->should_stop = true;
+            }
+
+            this->condition.notify_one();
+            this->thread.join();
+        }
+
+        TimerThread(const TimerThread&)             = delete;
+        TimerThread(TimerThread&&)                  = delete;
+        TimerThread& operator= (const TimerThread&) = delete;
+        TimerThread& operator= (TimerThread&&)      = delete;
+
+        void add(std::chrono::steady_clock::time_point deadline, util::Job job)
+        {
+            {
+                std::unique_lock lock {this->mutex};
+
+                this->timers.push_back(
+                    Timer {.deadline {deadline}, .job {std::move(job)}});
+                std::ranges::push_heap(this->timers, Later {});
+            }
+
+            // The new timer may be due before the one being waited on
+            this->condition.notify_one();
+        }
+
+    private:
+        struct Timer
+        {
+            std::chrono::steady_clock::time_point deadline;
+            util::Job                             job;
+        };
+
+        // Makes the heap a min heap on the deadline
+        struct Later
+        {
+            bool operator() (const Timer& l, const Timer& r) const
+            {
+                return l.deadline > r.deadline;
+            }
+        };
+
+        void run()
+        {
+            std::unique_lock lock {this->mutex};
+
+            while (!this->should_stop)
+            {
+                if (this->timers.empty())
+                {
+                    this->condition.wait(lock);
+
+                    continue;
+                }
+
+                const std::chrono::steady_clock::time_point next =
+                    this->timers.front().deadline;
+
+                if (std::chrono::steady_clock::now() < next)
+                {
+                    this->condition.wait_until(lock, next);
+
+                    continue;
+                }
+
+                std::ranges::pop_heap(this->timers, Later {});
+
+                util::Job job = std::move(this->timers.back().job);
+                this->timers.pop_back();
+
+                lock.unlock();
+                util::getThreadPool().addJob(std::move(job));
+                lock.lock();
+            }
+        }
+
+        std::mutex              mutex;
+        std::condition_variable condition;
+        std::vector<Timer>      timers;
+        bool                    should_stop;
+        std::thread             thread;
+    };
+} // namespace
+
+void util::detail::addTimer(
+    std::chrono::steady_clock::time_point deadline, Job job)
+{
+    static TimerThread timerThread {};
+
+    timerThread.add(deadline, std::move(job));
+}
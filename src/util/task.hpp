@@ -0,0 +1,402 @@
+#ifndef SRC_UTIL_TASK_HPP
+#define SRC_UTIL_TASK_HPP
+
+#include "util/threads.hpp"
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace util
+{
+    template<class T = void>
+    class Task;
+
+    namespace detail
+    {
+        /// Shared between Task<T> and Task<void>, everything except for
+        /// how the result is stored
+        class TaskPromiseBase
+        {
+        public:
+            TaskPromiseBase()
+                : continuation {std::noop_coroutine()}
+                , exception {nullptr}
+            {}
+
+            std::suspend_always initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            /// Resumes whatever was awaiting this task on the same thread
+            struct FinalAwaiter
+            {
+                bool await_ready() noexcept
+                {
+                    return false;
+                }
+
+                template<class P>
+                std::coroutine_handle<>
+                await_suspend(std::coroutine_handle<P> handle) noexcept
+                {
+                    return handle.promise().continuation;
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            FinalAwaiter final_suspend() noexcept
+            {
+                return {};
+            }
+
+            void unhandled_exception() noexcept
+            {
+                this->exception = std::current_exception();
+            }
+
+            std::coroutine_handle<> continuation;
+            std::exception_ptr      exception;
+        };
+
+        template<class T>
+        class TaskPromise : public TaskPromiseBase
+        {
+        public:
+            Task<T> get_return_object() noexcept;
+
+            template<class U>
+                requires std::convertible_to<U&&, T>
+            void return_value(U&& v)
+            {
+                this->value.emplace(std::forward<U>(v));
+            }
+
+            T getResult()
+            {
+                if (this->exception != nullptr)
+                {
+                    std::rethrow_exception(this->exception);
+                }
+
+                return std::move(*this->value);
+            }
+
+        private:
+            std::optional<T> value;
+        };
+
+        template<>
+        class TaskPromise<void> : public TaskPromiseBase
+        {
+        public:
+            Task<void> get_return_object() noexcept;
+
+            void return_void() noexcept {}
+
+            void getResult()
+            {
+                if (this->exception != nullptr)
+                {
+                    std::rethrow_exception(this->exception);
+                }
+            }
+        };
+    } // namespace detail
+
+    /// Lazily started coroutine
+    ///
+    /// Nothing runs until the Task is either co_awaited from another Task or
+    /// handed to util::spawn. A Task can co_await other Tasks, Futures,
+    /// util::scheduleOn and util::sleepFor, so that a chain of steps that
+    /// would otherwise block a thread or nest callbacks can be written in
+    /// order:
+    ///
+    ///     util::Task<Mesh> loadMesh(std::string path)
+    ///     {
+    ///         co_await util::scheduleOn();
+    ///
+    ///         std::string file = co_await readFile(path);
+    ///         Obj         obj  = parseObj(file);
+    ///
+    ///         co_return buildMesh(obj);
+    ///     }
+    ///
+    /// Exceptions thrown inside of a Task are rethrown by whatever awaits it.
+    template<class T>
+    class [[nodiscard]] Task
+    {
+    public:
+        using promise_type = detail::TaskPromise<T>;
+    public:
+        ~Task()
+        {
+            if (this->handle)
+            {
+                this->handle.destroy();
+            }
+        }
+
+        Task(const Task&) = delete;
+        Task(Task&& other) noexcept
+            : handle {std::exchange(other.handle, nullptr)}
+        {}
+        Task& operator= (const Task&) = delete;
+        Task& operator= (Task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (this->handle)
+                {
+                    this->handle.destroy();
+                }
+
+                this->handle = std::exchange(other.handle, nullptr);
+            }
+
+            return *this;
+        }
+
+        /// Starts this task on the thread that awaits it, which is resumed
+        /// on whatever thread this task finishes on
+        auto operator co_await () && noexcept
+        {
+            struct Awaiter
+            {
+                bool await_ready() noexcept
+                {
+                    return false;
+                }
+
+                std::coroutine_handle<>
+                await_suspend(std::coroutine_handle<> awaiting) noexcept
+                {
+                    this->handle.promise().continuation = awaiting;
+
+                    return this->handle;
+                }
+
+                T await_resume()
+                {
+                    return this->handle.promise().getResult();
+                }
+
+                std::coroutine_handle<promise_type> handle;
+            };
+
+            return Awaiter {this->handle};
+        }
+
+    private:
+        explicit Task(std::coroutine_handle<promise_type> handle_)
+            : handle {handle_}
+        {}
+
+        friend promise_type;
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    template<class T>
+    Task<T> detail::TaskPromise<T>::get_return_object() noexcept
+    {
+        return Task<T> {
+            std::coroutine_handle<TaskPromise<T>>::from_promise(*this)};
+    }
+
+    inline Task<void> detail::TaskPromise<void>::get_return_object() noexcept
+    {
+        return Task<void> {
+            std::coroutine_handle<TaskPromise<void>>::from_promise(*this)};
+    }
+
+    /// co_await to continue the current coroutine on one of pool's workers
+    inline auto scheduleOn(
+        AsynchronousThreadPool& pool     = getThreadPool(),
+        Priority                priority = Priority::Interactive)
+    {
+        struct Awaiter
+        {
+            bool await_ready() noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                this->pool.addJob(
+                    [handle]
+                    {
+                        handle.resume();
+                    },
+                    this->priority);
+            }
+
+            void await_resume() noexcept {}
+
+            AsynchronousThreadPool& pool;
+            Priority                priority;
+        };
+
+        return Awaiter {pool, priority};
+    }
+
+    namespace detail
+    {
+        /// Submits job to the thread pool once deadline has passed, timers
+        /// are kept on a single thread that sleeps until the next one is due
+        void addTimer(std::chrono::steady_clock::time_point deadline, Job job);
+    } // namespace detail
+
+    /// co_await to continue the current coroutine on a pool worker once
+    /// duration has passed, without blocking any thread in the meantime
+    template<class Rep, class Period>
+    auto sleepFor(std::chrono::duration<Rep, Period> duration)
+    {
+        struct Awaiter
+        {
+            bool await_ready() noexcept
+            {
+                return this->deadline <= std::chrono::steady_clock::now();
+            }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                detail::addTimer(
+                    this->deadline,
+                    [handle]
+                    {
+                        handle.resume();
+                    });
+            }
+
+            void await_resume() noexcept {}
+
+            std::chrono::steady_clock::time_point deadline;
+        };
+
+        return Awaiter {
+            std::chrono::steady_clock::now()
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                duration)};
+    }
+
+    namespace detail
+    {
+        template<class T>
+        struct FutureAwaiter
+        {
+            bool await_ready() noexcept
+            {
+                return FutureAccess::getState(this->future)->isReady();
+            }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                FutureAccess::getState(this->future)
+                    ->onReady(
+                        [handle]
+                        {
+                            handle.resume();
+                        });
+            }
+
+            T await_resume()
+            {
+                // Already ready, doesn't block
+                return this->future.await();
+            }
+
+            Future<T>& future;
+        };
+    } // namespace detail
+
+    /// Suspends until future is ready and resumes on a pool worker
+    template<class T>
+    detail::FutureAwaiter<T> operator co_await (Future<T>& future) noexcept
+    {
+        return detail::FutureAwaiter<T> {future};
+    }
+
+    template<class T>
+    detail::FutureAwaiter<T> operator co_await (Future<T>&& future) noexcept
+    {
+        return detail::FutureAwaiter<T> {future};
+    }
+
+    namespace detail
+    {
+        /// Coroutine that starts immediately and frees itself once it's done
+        struct DetachedTask
+        {
+            struct promise_type
+            {
+                DetachedTask get_return_object() noexcept
+                {
+                    return {};
+                }
+
+                std::suspend_never initial_suspend() noexcept
+                {
+                    return {};
+                }
+
+                std::suspend_never final_suspend() noexcept
+                {
+                    return {};
+                }
+
+                void return_void() noexcept {}
+
+                void unhandled_exception() noexcept
+                {
+                    std::terminate();
+                }
+            };
+        };
+
+        template<class T>
+        DetachedTask runToFuture(Task<T> task, FutureState<T>* state)
+        {
+            co_await scheduleOn();
+
+            if constexpr (std::same_as<T, void>)
+            {
+                co_await std::move(task);
+
+                state->fulfill(std::monostate {});
+            }
+            else
+            {
+                state->fulfill(co_await std::move(task));
+            }
+
+            state->release();
+        }
+    } // namespace detail
+
+    /// Starts task on the thread pool, this is how a chain of Tasks is
+    /// started from regular code
+    ///
+    /// An exception escaping task terminates the program, as there is
+    /// nowhere to rethrow it.
+    template<class T>
+    Future<T> spawn(Task<T> task)
+    {
+        detail::FutureState<T>* state = detail::FutureState<T>::create();
+
+        // One reference for the Future and another for the coroutine
+        state->retain();
+
+        detail::runToFuture(std::move(task), state);
+
+        return detail::FutureAccess::make(state);
+    }
+} // namespace util
+
+#endif // SRC_UTIL_TASK_HPP
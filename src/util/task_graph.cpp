@@ -0,0 +1,157 @@
+#include "task_graph.hpp"
+#include <atomic>
+#include <memory>
+
+namespace
+{
+    /// Everything a running graph needs, shared by all of its jobs
+    struct Execution
+    {
+        struct Node
+        {
+            util::Job                job;
+            std::vector<std::size_t> successors;
+            std::atomic<std::size_t> remaining_predecessors;
+        };
+
+        std::vector<Node>                nodes;
+        std::atomic<std::size_t>         unfinished;
+        util::detail::FutureState<void>* output;
+    };
+
+    void submit(const std::shared_ptr<Execution>& execution, std::size_t task)
+    {
+        util::getThreadPool().addJob(
+            [execution, task]
+            {
+                Execution::Node& node = execution->nodes[task];
+
+                node.job();
+
+                for (std::size_t s : node.successors)
+                {
+                    if (execution->nodes[s].remaining_predecessors.fetch_sub(
+                            1, std::memory_order_acq_rel)
+                        == 1)
+                    {
+                        submit(execution, s);
+                    }
+                }
+
+                if (execution->unfinished.fetch_sub(
+                        1, std::memory_order_acq_rel)
+                    == 1)
+                {
+                    execution->output->fulfill(std::monostate {});
+                    execution->output->release();
+                }
+            });
+    }
+} // namespace
+
+util::TaskGraph::TaskGraph()
+    : nodes {}
+{}
+
+util::TaskGraph::Task util::TaskGraph::add(Job job)
+{
+    this->nodes.push_back(Node {
+        .job {std::move(job)}, .successors {}, .predecessors {0}});
+
+    return this->nodes.size() - 1;
+}
+
+void util::TaskGraph::precede(Task before, Task after)
+{
+    util::assertFatal(
+        before < this->nodes.size() && after < this->nodes.size()
+            && before != after,
+        "Invalid TaskGraph edge {} -> {}",
+        before,
+        after);
+
+    this->nodes[before].successors.push_back(after);
+    ++this->nodes[after].predecessors;
+}
+
+util::Future<void> util::TaskGraph::run()
+{
+    detail::FutureState<void>* output = detail::FutureState<void>::create();
+
+    if (this->nodes.empty())
+    {
+        output->fulfill(std::monostate {});
+
+        return detail::FutureAccess::make(output);
+    }
+
+    // A cycle would leave the returned Future pending forever, so check for
+    // one up front with Kahn's algorithm
+    {
+        std::vector<std::size_t> predecessors {};
+        std::vector<Task>        ready {};
+
+        for (Task t = 0; t < this->nodes.size(); ++t)
+        {
+            predecessors.push_back(this->nodes[t].predecessors);
+
+            if (this->nodes[t].predecessors == 0)
+            {
+                ready.push_back(t);
+            }
+        }
+
+        std::size_t visited {0};
+
+        while (!ready.empty())
+        {
+            const Task t = ready.back();
+            ready.pop_back();
+            ++visited;
+
+            for (Task s : this->nodes[t].successors)
+            {
+                if (--predecessors[s] == 0)
+                {
+                    ready.push_back(s);
+                }
+            }
+        }
+
+        util::assertFatal(
+            visited == this->nodes.size(), "TaskGraph contains a cycle");
+    }
+
+    output->retain();
+
+    std::shared_ptr<Execution> execution = std::make_shared<Execution>();
+
+    execution->nodes = std::vector<Execution::Node>(this->nodes.size());
+    execution->unfinished.store(this->nodes.size());
+    execution->output = output;
+
+    std::vector<Task> roots {};
+
+    for (Task t = 0; t < this->nodes.size(); ++t)
+    {
+        Execution::Node& node = execution->nodes[t];
+
+        node.job        = std::move(this->nodes[t].job);
+        node.successors = std::move(this->nodes[t].successors);
+        node.remaining_predecessors.store(this->nodes[t].predecessors);
+
+        if (this->nodes[t].predecessors == 0)
+        {
+            roots.push_back(t);
+        }
+    }
+
+    this->nodes.clear();
+
+    for (Task t : roots)
+    {
+        submit(execution, t);
+    }
+
+    return detail::FutureAccess::make(output);
+}
@@ -0,0 +1,60 @@
+#ifndef SRC_UTIL_TASK__GRAPH_HPP
+#define SRC_UTIL_TASK__GRAPH_HPP
+
+#include "util/job.hpp"
+#include "util/threads.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace util
+{
+    /// Small dependency graph of jobs that runs on the thread pool
+    ///
+    /// Every task is submitted as soon as all of the tasks that precede it
+    /// have finished, so nothing ever blocks waiting on a dependency.
+    ///
+    ///     util::TaskGraph graph {};
+    ///
+    ///     const util::TaskGraph::Task a = graph.add(loadShaders);
+    ///     const util::TaskGraph::Task b = graph.add(buildFlatPipeline);
+    ///     const util::TaskGraph::Task c = graph.add(buildVoxelPipeline);
+    ///
+    ///     graph.precede(a, b);
+    ///     graph.precede(a, c);
+    ///
+    ///     graph.run().await();
+    class TaskGraph
+    {
+    public:
+        using Task = std::size_t;
+    public:
+        TaskGraph();
+        ~TaskGraph() = default;
+
+        TaskGraph(const TaskGraph&)             = delete;
+        TaskGraph(TaskGraph&&)                  = default;
+        TaskGraph& operator= (const TaskGraph&) = delete;
+        TaskGraph& operator= (TaskGraph&&)      = default;
+
+        Task add(Job);
+
+        /// before has to finish before after is started
+        void precede(Task before, Task after);
+
+        /// Submits every task, the returned Future is ready once all of them
+        /// have run. Leaves this graph empty.
+        Future<void> run();
+
+    private:
+        struct Node
+        {
+            Job               job;
+            std::vector<Task> successors;
+            std::size_t       predecessors;
+        };
+
+        std::vector<Node> nodes;
+    };
+} // namespace util
+
+#endif // SRC_UTIL_TASK__GRAPH_HPP
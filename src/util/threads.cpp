@@ -0,0 +1,852 @@
+#include "threads.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string_view>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace
+{
+    /// The pool and index of the worker running on this thread, if any
+    struct WorkerContext
+    {
+        const util::AsynchronousThreadPool* pool;
+        std::size_t                         index;
+    };
+
+    thread_local WorkerContext currentWorker {nullptr, 0};
+
+    // Number of times a worker looks for more work before parking, finding
+    // work again without a syscall is much cheaper than a wake up
+    constexpr std::size_t SpinsBeforeParking {64};
+
+    // Used when neither MANGO_WORKERS nor the platform say how many cpus
+    // there are
+    constexpr std::size_t FallbackNumberOfWorkers {4};
+
+    struct LogicalCpu
+    {
+        std::size_t index;
+        std::size_t package;
+        std::size_t core;
+    };
+
+    [[maybe_unused]] std::optional<std::size_t>
+    readTopology(std::size_t cpu, std::string_view name)
+    {
+        std::ifstream file {fmt::format(
+            "/sys/devices/system/cpu/cpu{}/topology/{}", cpu, name)};
+
+        std::size_t output {0};
+
+        if (file >> output)
+        {
+            return output;
+        }
+
+        return std::nullopt;
+    }
+
+    /// Every logical cpu this process is allowed to run on, with SMT
+    /// siblings next to each other. Empty if unknown.
+    std::vector<LogicalCpu> getAvailableCpus()
+    {
+        std::vector<LogicalCpu> output {};
+
+#ifdef __linux__
+        cpu_set_t allowed {};
+
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        {
+            return output;
+        }
+
+        for (std::size_t i = 0; i < CPU_SETSIZE; ++i)
+        {
+            if (!CPU_ISSET(i, &allowed))
+            {
+                continue;
+            }
+
+            // Without topology information every cpu is its own core
+            output.push_back(LogicalCpu {
+                .index {i},
+                .package {readTopology(i, "physical_package_id").value_or(0)},
+                .core {readTopology(i, "core_id").value_or(i)},
+            });
+        }
+
+        std::ranges::sort(
+            output,
+            [](const LogicalCpu& l, const LogicalCpu& r)
+            {
+                return std::tie(l.package, l.core, l.index)
+                     < std::tie(r.package, r.core, r.index);
+            });
+#endif // __linux__
+
+        return output;
+    }
+
+    struct CpuPlacement
+    {
+        std::vector<std::size_t> reserved;
+        /// In the order workers should be placed on them
+        std::vector<std::size_t> workers;
+    };
+
+    CpuPlacement placeWorkers(
+        const std::vector<LogicalCpu>& cpus,
+        util::PinningPolicy            policy,
+        std::size_t                    reservedCores)
+    {
+        std::vector<std::vector<std::size_t>> cores {};
+
+        for (std::size_t i = 0; i < cpus.size(); ++i)
+        {
+            if (i == 0 || cpus[i].package != cpus[i - 1].package
+                || cpus[i].core != cpus[i - 1].core)
+            {
+                cores.emplace_back();
+            }
+
+            cores.back().push_back(cpus[i].index);
+        }
+
+        CpuPlacement output {};
+
+        if (cores.empty())
+        {
+            return output;
+        }
+
+        if (reservedCores >= cores.size())
+        {
+            util::logWarn(
+                "Can't reserve {} of {} cores, reserving {}",
+                reservedCores,
+                cores.size(),
+                cores.size() - 1);
+
+            reservedCores = cores.size() - 1;
+        }
+
+        for (std::size_t c = 0; c < reservedCores; ++c)
+        {
+            output.reserved.insert(
+                output.reserved.end(), cores[c].begin(), cores[c].end());
+        }
+
+        if (policy == util::PinningPolicy::Compact)
+        {
+            for (std::size_t c = reservedCores; c < cores.size(); ++c)
+            {
+                output.workers.insert(
+                    output.workers.end(), cores[c].begin(), cores[c].end());
+            }
+        }
+        else
+        {
+            // First sibling of every core, then the second, and so on
+            for (std::size_t sibling = 0;
+                 output.reserved.size() + output.workers.size() < cpus.size();
+                 ++sibling)
+            {
+                for (std::size_t c = reservedCores; c < cores.size(); ++c)
+                {
+                    if (sibling < cores[c].size())
+                    {
+                        output.workers.push_back(cores[c][sibling]);
+                    }
+                }
+            }
+        }
+
+        return output;
+    }
+
+    std::string_view getPinningName(util::PinningPolicy policy)
+    {
+        switch (policy)
+        {
+        case util::PinningPolicy::None:
+            return "none";
+        case util::PinningPolicy::Compact:
+            return "compact";
+        case util::PinningPolicy::Spread:
+            return "spread";
+        }
+
+        util::panic("Invalid PinningPolicy {}", static_cast<int>(policy));
+    }
+
+    std::optional<std::size_t> getEnvironmentInteger(const char* name)
+    {
+        const char* value = std::getenv(name); // NOLINT: read once at startup
+
+        if (value == nullptr)
+        {
+            return std::nullopt;
+        }
+
+        const std::string_view string {value};
+
+        std::size_t output {0};
+
+        const auto [end, error] = std::from_chars(
+            string.data(), string.data() + string.size(), output);
+
+        if (error != std::errc {} || end != string.data() + string.size())
+        {
+            util::logWarn("Ignoring invalid {}={}", name, string);
+
+            return std::nullopt;
+        }
+
+        return output;
+    }
+
+    std::int64_t getNanoseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // Every job is timed three times, so the statistics use the cheapest
+    // clock available and are only converted to nanoseconds when formatted
+    std::uint64_t getTicks()
+    {
+#if defined(__x86_64__) || defined(_M_X64)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(getNanoseconds());
+#endif
+    }
+
+    // Ticks may come from different cores, which can be very slightly out of
+    // sync
+    std::uint64_t getElapsedTicks(std::uint64_t from, std::uint64_t to)
+    {
+        return to > from ? to - from : 0;
+    }
+
+    // Jobs are moved into pooled blocks so that the deques and the injection
+    // queue only have to deal with pointers. Templated as the node type is
+    // private to the pool.
+    template<class Node>
+    Node* allocateNode(util::Job&& job)
+    {
+        return ::new (util::BlockPool<sizeof(Node), alignof(Node)>::allocate())
+            Node {.job {std::move(job)}, .enqueue_time {getTicks()}};
+    }
+
+    template<class Node>
+    void freeNode(Node* node)
+    {
+        node->~Node();
+
+        util::BlockPool<sizeof(Node), alignof(Node)>::deallocate(node);
+    }
+
+    std::string formatTicks(std::uint64_t ticks, double nanosecondsPerTick)
+    {
+        const std::uint64_t nanoseconds = static_cast<std::uint64_t>(
+            static_cast<double>(ticks) * nanosecondsPerTick);
+
+        if (nanoseconds < 1000)
+        {
+            return fmt::format("{}ns", nanoseconds);
+        }
+        else if (nanoseconds < 1000000)
+        {
+            return fmt::format(
+                "{:.1f}us", static_cast<double>(nanoseconds) / 1e3);
+        }
+        else
+        {
+            return fmt::format(
+                "{:.1f}ms", static_cast<double>(nanoseconds) / 1e6);
+        }
+    }
+    /// One line of AsynchronousThreadPool::formatStatistics
+    struct StatisticsRow
+    {
+        std::uint64_t             jobs_run {0};
+        std::uint64_t             jobs_stolen {0};
+        std::uint64_t             jobs_injected {0};
+        std::uint64_t             busy_ticks {0};
+        std::uint64_t             idle_ticks {0};
+        util::Histogram::Snapshot start_latency;
+        util::Histogram::Snapshot run_time;
+        util::Histogram::Snapshot queue_depth;
+
+        void merge(const StatisticsRow& other)
+        {
+            this->jobs_run += other.jobs_run;
+            this->jobs_stolen += other.jobs_stolen;
+            this->jobs_injected += other.jobs_injected;
+            this->busy_ticks += other.busy_ticks;
+            this->idle_ticks += other.idle_ticks;
+            this->start_latency.merge(other.start_latency);
+            this->run_time.merge(other.run_time);
+            this->queue_depth.merge(other.queue_depth);
+        }
+
+        [[nodiscard]] std::string
+        format(std::string_view name, double nanosecondsPerTick) const
+        {
+            const std::uint64_t total = this->busy_ticks + this->idle_ticks;
+
+            const auto time = [&](std::uint64_t ticks)
+            {
+                return formatTicks(ticks, nanosecondsPerTick);
+            };
+
+            return fmt::format(
+                "{:>3} | jobs {} (stolen {}, injected {}) | busy {:.1f}% | "
+                "start latency p50 {} p99 {} max {} | run time p50 {} p99 {} "
+                "max {} | depth p50 {} p99 {} max {}",
+                name,
+                this->jobs_run,
+                this->jobs_stolen,
+                this->jobs_injected,
+                total == 0 ? 0.0
+                           : 100.0 * static_cast<double>(this->busy_ticks)
+                                 / static_cast<double>(total),
+                time(this->start_latency.getPercentile(50.0)),
+                time(this->start_latency.getPercentile(99.0)),
+                time(this->start_latency.getMaximum()),
+                time(this->run_time.getPercentile(50.0)),
+                time(this->run_time.getPercentile(99.0)),
+                time(this->run_time.getMaximum()),
+                this->queue_depth.getPercentile(50.0),
+                this->queue_depth.getPercentile(99.0),
+                this->queue_depth.getMaximum());
+        }
+    };
+} // namespace
+
+struct util::AsynchronousThreadPool::QueuedJob
+{
+    Job           job;
+    std::uint64_t enqueue_time;
+};
+
+util::ThreadPoolConfiguration util::ThreadPoolConfiguration::fromEnvironment()
+{
+    ThreadPoolConfiguration output {};
+
+    if (std::optional<std::size_t> workers =
+            getEnvironmentInteger("MANGO_WORKERS"))
+    {
+        output.number_of_workers = *workers;
+    }
+
+    if (std::optional<std::size_t> reserved =
+            getEnvironmentInteger("MANGO_RESERVED_CORES"))
+    {
+        output.reserved_cores = *reserved;
+    }
+
+    if (const char* pinning = std::getenv("MANGO_PINNING")) // NOLINT
+    {
+        const std::string_view policy {pinning};
+
+        if (policy == "none")
+        {
+            output.pinning = PinningPolicy::None;
+        }
+        else if (policy == "compact")
+        {
+            output.pinning = PinningPolicy::Compact;
+        }
+        else if (policy == "spread")
+        {
+            output.pinning = PinningPolicy::Spread;
+        }
+        else
+        {
+            util::logWarn("Ignoring invalid MANGO_PINNING={}", policy);
+        }
+    }
+
+    return output;
+}
+
+bool util::pinCurrentThread(std::span<const std::size_t> cpus)
+{
+#ifdef __linux__
+    cpu_set_t set {};
+    CPU_ZERO(&set);
+
+    for (std::size_t c : cpus)
+    {
+        if (c >= CPU_SETSIZE)
+        {
+            return false;
+        }
+
+        CPU_SET(c, &set);
+    }
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    std::ignore = cpus;
+
+    return false;
+#endif // __linux__
+}
+
+util::AsynchronousThreadPool::AsynchronousThreadPool(
+    ThreadPoolConfiguration configuration)
+    : injected_jobs {}
+    , workers {}
+    , reserved_cpus {}
+    , should_stop {false}
+    , wake_epoch {0}
+    , parked_workers {0}
+    , frame_deadline {0}
+    , created_ticks {getTicks()}
+    , created_nanoseconds {getNanoseconds()}
+{
+    std::vector<std::size_t> workerCpus {};
+
+    if (configuration.pinning != PinningPolicy::None)
+    {
+        CpuPlacement placement = placeWorkers(
+            getAvailableCpus(),
+            configuration.pinning,
+            configuration.reserved_cores);
+
+        if (placement.workers.empty())
+        {
+            util::logWarn("Unable to pin workers on this platform");
+        }
+        else
+        {
+            this->reserved_cpus = std::move(placement.reserved);
+            workerCpus          = std::move(placement.workers);
+        }
+    }
+
+    std::size_t numberOfWorkers = configuration.number_of_workers;
+
+    if (numberOfWorkers == 0 && !workerCpus.empty())
+    {
+        numberOfWorkers = workerCpus.size();
+    }
+
+    // Only needed when nothing else says how many workers to start, an
+    // explicit MANGO_WORKERS works on platforms that don't report this
+    if (numberOfWorkers == 0)
+    {
+        const std::size_t hardwareThreads = std::thread::hardware_concurrency();
+
+        if (hardwareThreads == 0)
+        {
+            util::logWarn(
+                "std::thread::hardware_concurrency() is unknown, starting {} "
+                "workers. Set MANGO_WORKERS to override",
+                FallbackNumberOfWorkers);
+
+            numberOfWorkers = FallbackNumberOfWorkers;
+        }
+        else
+        {
+            numberOfWorkers = hardwareThreads;
+        }
+    }
+
+    // Every deque has to exist before any worker starts stealing
+    for (std::size_t i = 0; i < numberOfWorkers; ++i)
+    {
+        this->workers.push_back(std::make_unique<Worker>());
+    }
+
+    for (std::size_t i = 0; i < numberOfWorkers; ++i)
+    {
+        std::optional<std::size_t> cpu {};
+
+        if (!workerCpus.empty())
+        {
+            cpu = workerCpus[i % workerCpus.size()];
+        }
+
+        this->workers[i]->thread = std::thread {
+            [this, i, cpu]
+            {
+                if (cpu.has_value() && !pinCurrentThread({&*cpu, 1}))
+                {
+                    util::logWarn("Failed to pin worker {} to cpu {}", i, *cpu);
+                }
+
+                util::setTraceThreadName(fmt::format("Worker {}", i));
+
+                this->workerLoop(i);
+            }};
+    }
+
+    util::logLog(
+        "Started {} workers | Pinning: {} | Reserved cpus: {}",
+        numberOfWorkers,
+        getPinningName(
+            workerCpus.empty() ? PinningPolicy::None : configuration.pinning),
+        this->reserved_cpus.size());
+}
+
+util::AsynchronousThreadPool::~AsynchronousThreadPool()
+{
+    // Nothing can be left behind in a paused lane
+    this->frame_deadline.store(0);
+    this->should_stop.store(true);
+
+    this->wake_epoch.fetch_add(1);
+    this->wake_epoch.notify_all();
+
+    // Workers drain all of the work they can see before exiting
+    for (std::unique_ptr<Worker>& w : this->workers)
+    {
+        w->thread.join();
+    }
+
+    QueuedJob* job {nullptr};
+
+    for (moodycamel::ConcurrentQueue<QueuedJob*>& queue : this->injected_jobs)
+    {
+        while (queue.try_dequeue(job))
+        {
+            job->job();
+            freeNode(job);
+        }
+    }
+}
+
+void util::AsynchronousThreadPool::addJob(Job job, Priority priority)
+{
+    const std::size_t lane = static_cast<std::size_t>(priority);
+
+    QueuedJob* node = allocateNode<QueuedJob>(std::move(job));
+
+    if (currentWorker.pool == this)
+    {
+        this->workers[currentWorker.index]->deques[lane].push(node);
+    }
+    else
+    {
+        if (!this->injected_jobs[lane].enqueue(node))
+        {
+            freeNode(node);
+
+            throw std::bad_alloc {};
+        }
+    }
+
+    this->wakeWorker();
+}
+
+std::size_t util::AsynchronousThreadPool::getNumberOfWorkers() const
+{
+    return this->workers.size();
+}
+
+std::span<const std::size_t>
+util::AsynchronousThreadPool::getReservedCpus() const
+{
+    return this->reserved_cpus;
+}
+
+void util::AsynchronousThreadPool::beginFrame(
+    std::chrono::steady_clock::time_point deadline)
+{
+    this->frame_deadline.store(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            deadline.time_since_epoch())
+            .count());
+}
+
+void util::AsynchronousThreadPool::endFrame()
+{
+    this->frame_deadline.store(0);
+
+    // Workers may have parked with only background work left
+    this->wake_epoch.fetch_add(1);
+    this->wake_epoch.notify_all();
+}
+
+bool util::AsynchronousThreadPool::isBackgroundPaused() const
+{
+    const std::int64_t deadline = this->frame_deadline.load();
+
+    if (deadline == 0)
+    {
+        return false;
+    }
+
+    return getNanoseconds()
+               + std::chrono::nanoseconds {BackgroundCutoff}.count()
+        >= deadline;
+}
+
+void util::AsynchronousThreadPool::workerLoop(std::size_t workerIndex)
+{
+    currentWorker = WorkerContext {.pool {this}, .index {workerIndex}};
+
+    Worker&           worker     = *this->workers[workerIndex];
+    WorkerStatistics& statistics = worker.statistics;
+
+    std::size_t   failedSearches {0};
+    std::uint64_t idleSince = getTicks();
+    bool          afterJob {false};
+
+    while (true)
+    {
+        if (QueuedJob* job = this->findJob(workerIndex); job != nullptr)
+        {
+            // Straight after another job the end of that one is close enough
+            const std::uint64_t start = afterJob ? idleSince : getTicks();
+
+            std::size_t depth {0};
+
+            for (const WorkStealingDeque<QueuedJob*>& d : worker.deques)
+            {
+                depth += d.size();
+            }
+
+            statistics.start_latency.record(
+                getElapsedTicks(job->enqueue_time, start));
+            statistics.idle_time.record(getElapsedTicks(idleSince, start));
+            statistics.idle_ticks.add(getElapsedTicks(idleSince, start));
+            statistics.queue_depth.record(depth);
+
+            {
+                util::TraceZone zone {"Job"};
+
+                job->job();
+            }
+            freeNode(job);
+
+            const std::uint64_t end = getTicks();
+
+            statistics.run_time.record(getElapsedTicks(start, end));
+            statistics.busy_ticks.add(getElapsedTicks(start, end));
+            statistics.jobs_run.add();
+
+            idleSince      = end;
+            afterJob       = true;
+            failedSearches = 0;
+            continue;
+        }
+
+        afterJob = false;
+
+        if (this->should_stop.load())
+        {
+            break;
+        }
+
+        if (++failedSearches < SpinsBeforeParking)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Read the epoch before checking for work one last time. Anything
+        // that's added after this check bumps the epoch and either sees this
+        // worker as parked or makes the wait return immediately.
+        const std::uint32_t epoch = this->wake_epoch.load();
+
+        this->parked_workers.fetch_add(1);
+
+        if (!this->hasVisibleWork() && !this->should_stop.load())
+        {
+            this->wake_epoch.wait(epoch);
+        }
+
+        this->parked_workers.fetch_sub(1);
+
+        failedSearches = 0;
+    }
+
+    currentWorker = WorkerContext {.pool {nullptr}, .index {0}};
+}
+
+util::AsynchronousThreadPool::QueuedJob*
+util::AsynchronousThreadPool::findJob(std::size_t workerIndex)
+{
+    // Start at a random victim so that thieves spread themselves out
+    thread_local std::minstd_rand generator {std::random_device {}()};
+
+    const std::size_t numberOfWorkers = this->workers.size();
+    const std::size_t firstVictim     = generator() % numberOfWorkers;
+
+    for (std::size_t lane = 0; lane < NumberOfPriorities; ++lane)
+    {
+        if (lane == static_cast<std::size_t>(Priority::Background)
+            && this->isBackgroundPaused())
+        {
+            break;
+        }
+
+        if (std::optional<QueuedJob*> job =
+                this->workers[workerIndex]->deques[lane].pop())
+        {
+            return *job;
+        }
+
+        QueuedJob* injected {nullptr};
+
+        if (this->injected_jobs[lane].try_dequeue(injected))
+        {
+            this->workers[workerIndex]->statistics.jobs_injected.add();
+
+            return injected;
+        }
+
+        for (std::size_t i = 0; i < numberOfWorkers; ++i)
+        {
+            const std::size_t victim = (firstVictim + i) % numberOfWorkers;
+
+            if (victim == workerIndex)
+            {
+                continue;
+            }
+
+            if (std::optional<QueuedJob*> job =
+                    this->workers[victim]->deques[lane].steal())
+            {
+                this->workers[workerIndex]->statistics.jobs_stolen.add();
+
+                return *job;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+bool util::AsynchronousThreadPool::hasVisibleWork() const
+{
+    const bool backgroundPaused = this->isBackgroundPaused();
+
+    for (std::size_t lane = 0; lane < NumberOfPriorities; ++lane)
+    {
+        if (lane == static_cast<std::size_t>(Priority::Background)
+            && backgroundPaused)
+        {
+            break;
+        }
+
+        if (this->injected_jobs[lane].size_approx() != 0)
+        {
+            return true;
+        }
+
+        for (const std::unique_ptr<Worker>& w : this->workers)
+        {
+            if (!w->deques[lane].empty())
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void util::AsynchronousThreadPool::wakeWorker()
+{
+    this->wake_epoch.fetch_add(1);
+
+    if (this->parked_workers.load() != 0)
+    {
+        this->wake_epoch.notify_one();
+    }
+}
+
+std::string util::AsynchronousThreadPool::formatStatistics() const
+{
+    const std::uint64_t ticks = getTicks() - this->created_ticks;
+    const std::int64_t  nanoseconds =
+        getNanoseconds() - this->created_nanoseconds;
+
+    const double nanosecondsPerTick =
+        ticks == 0 ? 1.0
+                   : static_cast<double>(nanoseconds)
+                         / static_cast<double>(ticks);
+
+    std::string output {};
+
+    StatisticsRow total {};
+
+    for (std::size_t i = 0; i < this->workers.size(); ++i)
+    {
+        const WorkerStatistics& s = this->workers[i]->statistics;
+
+        const StatisticsRow row {
+            .jobs_run {s.jobs_run.get()},
+            .jobs_stolen {s.jobs_stolen.get()},
+            .jobs_injected {s.jobs_injected.get()},
+            .busy_ticks {s.busy_ticks.get()},
+            .idle_ticks {s.idle_ticks.get()},
+            .start_latency {s.start_latency.snapshot()},
+            .run_time {s.run_time.snapshot()},
+            .queue_depth {s.queue_depth.snapshot()},
+        };
+
+        output += row.format(std::to_string(i), nanosecondsPerTick);
+        output += '\n';
+
+        total.merge(row);
+    }
+
+    output += total.format("All", nanosecondsPerTick);
+    output += '\n';
+
+    std::size_t injected {0};
+
+    for (const moodycamel::ConcurrentQueue<QueuedJob*>& q : this->injected_jobs)
+    {
+        injected += q.size_approx();
+    }
+
+    output += fmt::format("Jobs waiting to be picked up: {}", injected);
+
+    return output;
+}
+
+void util::AsynchronousThreadPool::logStatistics() const
+{
+    util::logLog("Thread pool statistics\n{}", this->formatStatistics());
+}
+
+void util::AsynchronousThreadPool::writeStatistics(
+    const std::filesystem::path& path) const
+{
+    std::ofstream file {path};
+
+    if (!file)
+    {
+        util::logWarn(
+            "Failed to open {} for the thread pool statistics", path.string());
+
+        return;
+    }
+
+    file << this->formatStatistics() << '\n';
+}
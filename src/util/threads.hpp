@@ -6,176 +6,158 @@
 #include "blockingconcurrentqueue.h"
 #pragma clang diagnostic pop
 
+#include "util/block_pool.hpp"
+#include "util/channel.hpp"
+#include "util/job.hpp"
+#include "util/lock.hpp"
 #include "util/log.hpp"
+#include "util/statistics.hpp"
+#include "util/work_stealing_deque.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <concepts>
 #include <condition_variable>
+#include <filesystem>
 #include <functional>
-#include <latch>
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <span>
+#include <string>
 #include <thread>
 #include <type_traits>
 #include <utility>
+#include <variant>
+#include <vector>
 
 namespace util
 {
-    namespace mpmc
-    {
-        template<class T>
-        class Sender;
-
-        template<class T>
-        class Receiver;
+    template<class T>
+        requires (
+            (std::is_move_constructible_v<T> && std::is_move_assignable_v<T>)
+            || std::same_as<T, void>)
+    class Future;
 
-        template<class T>
-        std::pair<Sender<T>, Receiver<T>> create()
-            requires std::is_move_assignable_v<T>;
+    namespace detail
+    {
+        struct FutureAccess;
 
+        /// Shared between a Future and the job that fulfills it, both hold a
+        /// reference and whichever releases last returns it to a BlockPool
+        ///
+        /// Continuations added with onReady are submitted to the thread pool
+        /// once the value is set.
         template<class T>
-        class Sender
+        class FutureState
         {
         public:
+            using Value =
+                std::conditional_t<std::same_as<T, void>, std::monostate, T>;
 
-            ~Sender() = default;
-
-            Sender(const Sender&)             = default;
-            Sender(Sender&&)                  = default;
-            Sender& operator= (const Sender&) = default;
-            Sender& operator= (Sender&&)      = default;
+            /// Starts with a single reference
+            [[nodiscard]] static FutureState* create()
+            {
+                return ::new (
+                    BlockPool<sizeof(FutureState), alignof(FutureState)>::
+                        allocate()) FutureState {};
+            }
 
-            void send(T&& t) const
+            void retain() noexcept
             {
-                assert(this->queue != nullptr);
+                this->references.fetch_add(1, std::memory_order_relaxed);
+            }
 
-                if (!this->queue->enqueue(std::forward<T>(t)))
+            void release() noexcept
+            {
+                if (this->references.fetch_sub(1, std::memory_order_acq_rel)
+                    == 1)
                 {
-                    throw std::bad_alloc {};
+                    this->~FutureState();
+
+                    BlockPool<sizeof(FutureState), alignof(FutureState)>::
+                        deallocate(this);
                 }
             }
 
-        private:
-            Sender(std::shared_ptr<moodycamel::ConcurrentQueue<T>> queue_)
-                : queue {std::move(queue_)}
-            {}
-
-            template<class Y>
-            friend std::pair<Sender<Y>, Receiver<Y>> create()
-                requires std::is_move_assignable_v<Y>;
+            /// Submits every continuation
+            void fulfill(Value&& v);
 
-            std::shared_ptr<moodycamel::ConcurrentQueue<T>> queue;
-        }; // class Sender
-
-        template<class T>
-        class Receiver
-        {
-        public:
+            /// Submits job to the thread pool once this is fulfilled, right
+            /// away if it already is
+            void onReady(Job job);
 
-            ~Receiver() = default;
-
-            Receiver(const Receiver&)             = default;
-            Receiver(Receiver&&)                  = default;
-            Receiver& operator= (const Receiver&) = default;
-            Receiver& operator= (Receiver&&)      = default;
-
-            std::optional<T> receive() const
+            [[nodiscard]] bool isReady() const noexcept
             {
-                std::optional<T> output;
-
-                util::assertFatal(
-                    this->queue->try_dequeue(output) == output.has_value(),
-                    "...!");
-
-                return output;
+                return this->ready.load(std::memory_order_acquire) != 0;
             }
 
-        private:
-            Receiver(std::shared_ptr<moodycamel::ConcurrentQueue<T>> queue_)
-                : queue {std::move(queue_)}
-            {}
-
-            template<class Y>
-            friend std::pair<Sender<Y>, Receiver<Y>> create()
-                requires std::is_move_assignable_v<Y>;
+            void wait() const noexcept
+            {
+                this->ready.wait(0, std::memory_order_acquire);
+            }
 
-            std::shared_ptr<moodycamel::ConcurrentQueue<T>> queue;
-        }; // class Sender
+            std::optional<Value> value;
 
-        template<class T>
-        std::pair<Sender<T>, Receiver<T>> create()
-            requires std::is_move_assignable_v<T>
-        {
-            auto queue = std::make_shared<moodycamel::ConcurrentQueue<T>>();
+        private:
+            struct Continuation
+            {
+                Job           job;
+                Continuation* next;
+            };
 
-            return {Sender<T> {queue}, Receiver<T> {std::move(queue)}};
-        }
-    } // namespace mpmc
+            using ContinuationPool =
+                BlockPool<sizeof(Continuation), alignof(Continuation)>;
 
-    template<class... T>
-    class Mutex
-    {
-    public:
+            // Swapped in as the head of the continuation list once the value
+            // is set, never run
+            static Continuation* getFulfilledMarker() noexcept
+            {
+                static Continuation marker {.job {}, .next {nullptr}};
 
-        Mutex(T... t)
-            : tuple {std::forward<T>(t)...}
-        {}
-        ~Mutex() = default;
+                return &marker;
+            }
 
-        Mutex(const Mutex&)             = delete;
-        Mutex(Mutex&&)                  = default;
-        Mutex& operator= (const Mutex&) = delete;
-        Mutex& operator= (Mutex&&)      = default;
+            FutureState()
+                : value {std::nullopt}
+                , references {1}
+                , ready {0}
+                , continuations {nullptr}
+            {}
+            ~FutureState() = default;
 
-        void lock(std::invocable<T&...> auto func) noexcept(noexcept(func))
-        {
-            std::unique_lock lock {this->mutex};
+            std::atomic<std::uint32_t> references;
+            std::atomic<std::uint32_t> ready;
+            std::atomic<Continuation*> continuations;
+        };
 
-            std::apply(func, this->tuple);
-        }
-
-        void lock(std::invocable<const T&...> auto func) const
-            noexcept(noexcept(func))
+        template<class T, class F>
+        struct ContinuationResult
         {
-            std::unique_lock lock {this->mutex};
-
-            std::apply(func, this->tuple);
-        }
+            using Type = std::invoke_result_t<F, T>;
+        };
 
-        bool try_lock(std::invocable<T&...> auto func) noexcept(noexcept(func))
+        template<class F>
+        struct ContinuationResult<void, F>
         {
-            std::unique_lock<std::mutex> lock {this->mutex, std::defer_lock};
-
-            if (lock.try_lock())
-            {
-                std::apply(func, this->tuple);
-                return true;
-            }
-            else
-            {
-                return false;
-            }
-        }
+            using Type = std::invoke_result_t<F>;
+        };
 
-        bool try_lock(std::invocable<const T&...> auto func) const
-            noexcept(noexcept(func))
+        /// Calls fn and stores what it returns in state
+        template<class R, class F>
+        void fulfillWith(FutureState<R>& state, F& fn)
         {
-            std::unique_lock<std::mutex> lock {this->mutex, std::defer_lock};
-
-            if (lock.try_lock())
+            if constexpr (std::same_as<R, void>)
             {
-                std::apply(func, this->tuple);
-                return true;
+                fn();
+                state.fulfill(std::monostate {});
             }
             else
             {
-                return false;
+                state.fulfill(fn());
             }
         }
-
-    private:
-        mutable std::mutex mutex;
-        std::tuple<T...>   tuple;
-    }; // class Mutex
+    } // namespace detail
 
     template<class T>
         requires (
@@ -184,199 +166,513 @@ namespace util
     class Future
     {
     public:
+        ~Future()
+        {
+            if (this->state != nullptr)
+            {
+                this->state->release();
+            }
+        }
 
-        Future()
-            : completed {new std::latch {1}}
+        Future(const Future&) = delete;
+        Future(Future&& other) noexcept
+            : state {std::exchange(other.state, nullptr)}
         {}
-        ~Future() = default;
-
-        Future(const Future&)             = delete;
-        Future(Future&&)                  = default;
         Future& operator= (const Future&) = delete;
-        Future& operator= (Future&&)      = default;
+        Future& operator= (Future&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (this->state != nullptr)
+                {
+                    this->state->release();
+                }
+
+                this->state = std::exchange(other.state, nullptr);
+            }
+
+            return *this;
+        }
 
         T await()
         {
-            this->completed->wait();
+            this->state->wait();
 
-            return std::move(*this->try_await());
+            if constexpr (!std::same_as<T, void>)
+            {
+                return std::move(*this->state->value);
+            }
         }
 
         std::optional<T> try_await()
+            requires (!std::same_as<T, void>)
         {
-            if (this->completed->try_wait())
+            if (this->state->isReady())
             {
-                return std::move(value);
+                return std::move(this->state->value);
             }
 
             return std::nullopt;
         }
 
-    private:
-        template<class R, class F>
-        friend std::shared_ptr<Future<R>> runAsynchronously(F fn)
-            requires std::is_invocable_r_v<R, F>;
+        bool try_await()
+            requires std::same_as<T, void>
+        {
+            return this->state->isReady();
+        }
 
-        void fulfillFuture(T&& t)
+        /// Runs func on the thread pool with the value of this Future once
+        /// it's ready, without blocking any thread in the meantime
+        ///
+        /// Consumes this Future.
+        template<class F>
+        Future<typename detail::ContinuationResult<T, F>::Type> then(F func) &&
         {
-            this->value = std::make_optional<T>(std::move(t));
+            using R = typename detail::ContinuationResult<T, F>::Type;
 
-            this->completed->count_down();
-        }
+            detail::FutureState<R>* output = detail::FutureState<R>::create();
 
-        std::unique_ptr<std::latch> completed;
-        std::optional<T>            value;
-    };
+            // One reference for the returned Future and another for the job
+            output->retain();
 
-    template<>
-    class Future<void>
-    {
-    public:
-        Future()
-            : completed {new std::latch {1}}
-        {}
-        ~Future() = default;
+            // This Future's reference is handed over to the job
+            detail::FutureState<T>* input = std::exchange(this->state, nullptr);
 
-        Future(const Future&)             = delete;
-        Future(Future&&)                  = delete;
-        Future& operator= (const Future&) = delete;
-        Future& operator= (Future&&)      = delete;
+            input->onReady(
+                [input, output, func = std::move(func)]() mutable
+                {
+                    auto call = [&]
+                    {
+                        if constexpr (std::same_as<T, void>)
+                        {
+                            return func();
+                        }
+                        else
+                        {
+                            return func(std::move(*input->value));
+                        }
+                    };
 
-        void await()
-        {
-            this->completed->wait();
-        }
+                    detail::fulfillWith(*output, call);
 
-        bool try_await()
-        {
-            return this->completed->try_wait();
+                    input->release();
+                    output->release();
+                });
+
+            return Future<R> {output};
         }
 
     private:
-        template<class R, class F>
-        friend std::shared_ptr<Future<R>> runAsynchronously(F fn)
-            requires std::is_invocable_r_v<R, F>;
+        explicit Future(detail::FutureState<T>* state_)
+            : state {state_}
+        {}
 
-        void fulfillFuture()
+        template<class U>
+            requires (
+                (std::is_move_constructible_v<U>
+                 && std::is_move_assignable_v<U>)
+                || std::same_as<U, void>)
+        friend class Future;
+        friend struct detail::FutureAccess;
+
+        detail::FutureState<T>* state;
+    };
+
+    namespace detail
+    {
+        /// Lets the combinators below create Futures and get at their state
+        struct FutureAccess
         {
-            this->completed->count_down();
-        }
+            template<class T>
+            static Future<T> make(FutureState<T>* state)
+            {
+                return Future<T> {state};
+            }
+
+            template<class T>
+            static FutureState<T>* getState(const Future<T>& future)
+            {
+                return future.state;
+            }
+        };
+    } // namespace detail
+
+    /// Workers always take the most important job that they can find
+    enum class Priority : std::uint8_t
+    {
+        /// Needed by the frame that's currently being built
+        FrameCritical,
+        /// Needed soon, but not by any particular frame
+        Interactive,
+        /// Everything else, such as generating chunks. Not started while a
+        /// frame is close to its deadline.
+        Background,
+    };
+
+    constexpr std::size_t NumberOfPriorities {3};
 
-        std::unique_ptr<std::latch> completed;
+    enum class PinningPolicy : std::uint8_t
+    {
+        /// Workers are left to the scheduler
+        None,
+        /// Workers fill up every logical cpu of a core before moving onto
+        /// the next one, keeping them close together
+        Compact,
+        /// Workers get a physical core each before any of them share one
+        /// with an SMT sibling
+        Spread,
     };
 
+    struct ThreadPoolConfiguration
+    {
+        /// 0 picks one worker per logical cpu that isn't reserved, or 4 when
+        /// the platform doesn't report how many there are
+        std::size_t   number_of_workers {0};
+        PinningPolicy pinning {PinningPolicy::None};
+        /// Physical cores, starting from the first one, that workers are kept
+        /// off of so that the render thread can be pinned to them. Only
+        /// applies when pinning.
+        std::size_t   reserved_cores {0};
+
+        /// Reads MANGO_WORKERS, MANGO_PINNING (none, compact or spread) and
+        /// MANGO_RESERVED_CORES, anything that's unset or invalid is left at
+        /// its default
+        static ThreadPoolConfiguration fromEnvironment();
+    };
+
+    /// Pins the calling thread to the given logical cpus, returns false if
+    /// that isn't supported on this platform or failed
+    bool pinCurrentThread(std::span<const std::size_t> cpus);
+
+    /// Thread pool where every worker owns a WorkStealingDeque per Priority
+    ///
+    /// Jobs added from a worker go onto its own deque and are popped back off
+    /// in LIFO order while their data is still in cache, idle workers steal
+    /// the oldest jobs from the other workers. Jobs added from any other
+    /// thread go through a shared injection queue. Workers that can't find
+    /// anything to do park on an atomic wait rather than polling.
+    ///
+    /// Jobs are never interrupted, so background work can only be held back
+    /// at job boundaries. Long running background work should be split up or
+    /// check isBackgroundPaused() between steps.
     class AsynchronousThreadPool
     {
     public:
+        explicit AsynchronousThreadPool(ThreadPoolConfiguration = {});
+        ~AsynchronousThreadPool();
+
+        AsynchronousThreadPool(const AsynchronousThreadPool&) = delete;
+        AsynchronousThreadPool(AsynchronousThreadPool&&)      = delete;
+        AsynchronousThreadPool&
+        operator= (const AsynchronousThreadPool&)                    = delete;
+        AsynchronousThreadPool& operator= (AsynchronousThreadPool&&) = delete;
+
+        void addJob(Job, Priority = Priority::Interactive);
+
+        [[nodiscard]] std::size_t getNumberOfWorkers() const;
+
+        /// Logical cpus of the reserved cores, empty unless pinning
+        [[nodiscard]] std::span<const std::size_t> getReservedCpus() const;
+
+        /// Once less than BackgroundCutoff is left before deadline no more
+        /// background jobs are started until endFrame is called
+        void beginFrame(std::chrono::steady_clock::time_point deadline);
+        void endFrame();
+
+        [[nodiscard]] bool isBackgroundPaused() const;
 
-        AsynchronousThreadPool()
+        static constexpr std::chrono::microseconds BackgroundCutoff {4000};
+
+        /// Per worker job counts, times and latency percentiles, one worker
+        /// per line followed by the whole pool
+        [[nodiscard]] std::string formatStatistics() const;
+        void                      logStatistics() const;
+        void writeStatistics(const std::filesystem::path&) const;
+
+    private:
+        /// A Job and when it was added
+        struct QueuedJob;
+
+        /// Only written by the worker they belong to, so they're cheap enough
+        /// to always keep track of. Times are in ticks of a clock that's
+        /// cheaper to read than std::chrono::steady_clock, see threads.cpp.
+        struct WorkerStatistics
         {
-            this->workers.resize(std::thread::hardware_concurrency());
+            Counter jobs_run;
+            Counter jobs_stolen;
+            Counter jobs_injected;
+            Counter busy_ticks;
+            Counter idle_ticks;
+
+            /// From being added to the pool to being started
+            Histogram start_latency;
+            Histogram run_time;
+            /// Time between two jobs, spinning or parked
+            Histogram idle_time;
+            /// Jobs in this worker's own deques whenever it starts one
+            Histogram queue_depth;
+        };
+
+        struct Worker
+        {
+            std::array<WorkStealingDeque<QueuedJob*>, NumberOfPriorities>
+                             deques;
+            WorkerStatistics statistics;
+            std::thread      thread;
+        };
 
-            const std::size_t Zero {0}; // TODO: replace with a literal
+        void workerLoop(std::size_t workerIndex);
 
-            util::assertFatal(
-                this->workers.size() != Zero || this->workers.size() != ~Zero,
-                "Invalid std::thread::hardware_concurrency() | Received value "
-                "of {}",
-                this->workers.size());
+        // returns nullptr if there is no work anywhere in the pool
+        QueuedJob* findJob(std::size_t workerIndex);
 
-            for (auto& [thread, shouldStop] : this->workers)
-            {
-                shouldStop = std::make_unique<std::atomic<bool>>();
-                shouldStop->store(false);
+        [[nodiscard]] bool hasVisibleWork() const;
+        void               wakeWorker();
 
-                thread = std::thread {
-                    [&]
-                    {
-                        while (!shouldStop->load())
-                        {
-                            std::optional<std::function<void()>> maybeFunc {};
+        std::array<moodycamel::ConcurrentQueue<QueuedJob*>, NumberOfPriorities>
+                                             injected_jobs;
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::vector<std::size_t>             reserved_cpus;
 
-                            if (this->queue.wait_dequeue_timed(
-                                    maybeFunc, 25000))
-                            {
-                                maybeFunc->operator() ();
-                                maybeFunc = std::nullopt;
-                            }
-                        }
-                    }};
-            }
+        std::atomic<bool>          should_stop;
+        std::atomic<std::uint32_t> wake_epoch;
+        std::atomic<std::uint32_t> parked_workers;
+
+        // Nanoseconds since the epoch of the steady clock, 0 outside of a
+        // frame
+        std::atomic<std::int64_t> frame_deadline;
+
+        // Used to convert the statistics' ticks to nanoseconds
+        std::uint64_t created_ticks;
+        std::int64_t  created_nanoseconds;
+    };
+
+    inline AsynchronousThreadPool& getThreadPool()
+    {
+        static AsynchronousThreadPool threadPool {
+            ThreadPoolConfiguration::fromEnvironment()};
+        return threadPool;
+    }
+
+    template<class T>
+    void detail::FutureState<T>::fulfill(Value&& v)
+    {
+        this->value.emplace(std::move(v));
+
+        this->ready.store(1, std::memory_order_release);
+        this->ready.notify_all();
+
+        Continuation* c = this->continuations.exchange(
+            getFulfilledMarker(), std::memory_order_acq_rel);
+
+        while (c != nullptr)
+        {
+            Continuation* next = c->next;
+
+            getThreadPool().addJob(std::move(c->job));
+
+            c->~Continuation();
+            ContinuationPool::deallocate(c);
+
+            c = next;
         }
-        ~AsynchronousThreadPool()
+    }
+
+    template<class T>
+    void detail::FutureState<T>::onReady(Job job)
+    {
+        Continuation* node = ::new (ContinuationPool::allocate()) Continuation {
+            .job {std::move(job)},
+            .next {this->continuations.load(std::memory_order_acquire)}};
+
+        while (true)
         {
-            for (auto& [thread, shouldStop] : this->workers)
+            if (node->next == getFulfilledMarker())
             {
-                shouldStop->store(true);
-            }
+                getThreadPool().addJob(std::move(node->job));
 
-            std::optional<std::function<void()>> maybeFunc {};
+                node->~Continuation();
+                ContinuationPool::deallocate(node);
 
-            for (std::size_t i = 0; i < 100; ++i) // good enough
-            {
-                while (queue.try_dequeue(maybeFunc))
-                {
-                    maybeFunc->operator() ();
-                }
+                return;
             }
 
-            for (auto& [thread, shouldStop] : this->workers)
+            if (this->continuations.compare_exchange_weak(
+                    node->next,
+                    node,
+                    std::memory_order_acq_rel,
+                    std::memory_order_acquire))
             {
-                thread.join();
+                return;
             }
         }
+    }
 
-        AsynchronousThreadPool(const AsynchronousThreadPool&) = delete;
-        AsynchronousThreadPool(AsynchronousThreadPool&&)      = default;
-        AsynchronousThreadPool&
-        operator= (const AsynchronousThreadPool&)                    = delete;
-        AsynchronousThreadPool& operator= (AsynchronousThreadPool&&) = default;
+    template<class R, class F>
+    inline Future<R>
+    runAsynchronously(F fn, Priority priority = Priority::Interactive)
+        requires std::is_invocable_r_v<R, F>
+    {
+        detail::FutureState<R>* state = detail::FutureState<R>::create();
 
-        void addJob(std::function<void()>&& func)
-        {
-            if (!this->queue.enqueue(std::move(func)))
+        // One reference for the Future and another for the job
+        state->retain();
+
+        getThreadPool().addJob(
+            [state, fn = std::move(fn)]() mutable
             {
-                throw std::bad_alloc {};
-            }
-        }
+                detail::fulfillWith(*state, fn);
 
-    private:
-        moodycamel::BlockingConcurrentQueue<std::function<void()>> queue;
-        std::vector<std::pair<std::thread, std::unique_ptr<std::atomic<bool>>>>
-            workers;
-    };
+                state->release();
+            },
+            priority);
 
-    inline AsynchronousThreadPool& getThreadPool()
-    {
-        static AsynchronousThreadPool threadPool {};
-        return threadPool;
+        return detail::FutureAccess::make(state);
     }
 
-    template<class R, class F>
-    inline std::shared_ptr<Future<R>> runAsynchronously(F fn)
-        requires std::is_invocable_r_v<R, F>
+    template<class T>
+    using WhenAllResult =
+        std::conditional_t<std::same_as<T, void>, void, std::vector<T>>;
+
+    /// Returns a Future that becomes ready once every one of futures is,
+    /// holding their values in the same order
+    template<class T>
+    Future<WhenAllResult<T>> whenAll(std::vector<Future<T>> futures)
     {
-        std::shared_ptr<Future<R>> future = std::make_shared<Future<R>>();
+        using Output = WhenAllResult<T>;
+
+        detail::FutureState<Output>* output =
+            detail::FutureState<Output>::create();
+
+        if (futures.empty())
+        {
+            output->fulfill(typename detail::FutureState<Output>::Value {});
+
+            return detail::FutureAccess::make(output);
+        }
+
+        output->retain();
 
-        if constexpr (std::same_as<R, void>)
+        struct Join
         {
-            getThreadPool().addJob(
-                [=]
+            std::atomic<std::size_t>     remaining;
+            std::vector<Future<T>>       inputs;
+            detail::FutureState<Output>* output;
+        };
+
+        std::shared_ptr<Join> join = std::make_shared<Join>(
+            futures.size(), std::move(futures), output);
+
+        for (const Future<T>& f : join->inputs)
+        {
+            detail::FutureAccess::getState(f)->onReady(
+                [join]
                 {
-                    fn();
-                    future->fulfillFuture();
+                    if (join->remaining.fetch_sub(1, std::memory_order_acq_rel)
+                        != 1)
+                    {
+                        return;
+                    }
+
+                    // Every input is ready, none of these block
+                    auto collect = [&]
+                    {
+                        if constexpr (std::same_as<T, void>)
+                        {
+                            for (Future<T>& i : join->inputs)
+                            {
+                                i.await();
+                            }
+                        }
+                        else
+                        {
+                            std::vector<T> values {};
+                            values.reserve(join->inputs.size());
+
+                            for (Future<T>& i : join->inputs)
+                            {
+                                values.push_back(i.await());
+                            }
+
+                            return values;
+                        }
+                    };
+
+                    detail::fulfillWith(*join->output, collect);
+
+                    join->output->release();
                 });
         }
-        else
+
+        return detail::FutureAccess::make(output);
+    }
+
+    template<class T>
+    struct WhenAnyResult
+    {
+        /// Of the first Future to become ready
+        std::size_t            index;
+        std::vector<Future<T>> futures;
+    };
+
+    /// Returns a Future that becomes ready as soon as any of futures is,
+    /// futures are handed back through the result
+    template<class T>
+    Future<WhenAnyResult<T>> whenAny(std::vector<Future<T>> futures)
+    {
+        util::assertFatal(!futures.empty(), "whenAny of no futures");
+
+        using Output = WhenAnyResult<T>;
+
+        detail::FutureState<Output>* output =
+            detail::FutureState<Output>::create();
+
+        output->retain();
+
+        struct Join
+        {
+            std::atomic<bool>            fired;
+            std::vector<Future<T>>       inputs;
+            detail::FutureState<Output>* output;
+        };
+
+        // The winner moves the inputs out of the join as soon as it fires, so
+        // hold onto the states while the continuations are being added
+        std::vector<detail::FutureState<T>*> states {};
+        states.reserve(futures.size());
+
+        for (const Future<T>& f : futures)
+        {
+            states.push_back(detail::FutureAccess::getState(f));
+            states.back()->retain();
+        }
+
+        std::shared_ptr<Join> join =
+            std::make_shared<Join>(false, std::move(futures), output);
+
+        for (std::size_t i = 0; i < states.size(); ++i)
         {
-            getThreadPool().addJob(
-                [=]
+            states[i]->onReady(
+                [join, i]
                 {
-                    future->fulfillFuture(fn());
+                    if (join->fired.exchange(true, std::memory_order_acq_rel))
+                    {
+                        return;
+                    }
+
+                    join->output->fulfill(Output {
+                        .index {i}, .futures {std::move(join->inputs)}});
+
+                    join->output->release();
                 });
         }
 
-        return future;
+        for (detail::FutureState<T>* s : states)
+        {
+            s->release();
+        }
+
+        return detail::FutureAccess::make(output);
     }
 
 } // namespace util
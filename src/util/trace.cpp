@@ -0,0 +1,292 @@
+#include "trace.hpp"
+#include "log.hpp"
+#include <array>
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#include <fmt/core.h>
+#pragma clang diagnostic pop
+
+namespace
+{
+    struct Zone
+    {
+        const char*  name;
+        std::int64_t begin;
+        std::int64_t end;
+    };
+
+    /// Filled by a single thread, size is published with a release store so
+    /// that finishTracing can read everything up to it while the thread
+    /// keeps recording
+    struct Chunk
+    {
+        static constexpr std::size_t Capacity {4096};
+
+        std::array<Zone, Capacity> zones;
+        std::atomic<std::size_t>   size;
+        std::atomic<Chunk*>        next;
+    };
+
+    struct ThreadTrace
+    {
+        std::size_t id;
+        /// Guarded by the registry's mutex
+        std::string         name;
+        /// Created by the first zone, naming a thread that never records
+        /// anything shouldn't cost a chunk
+        std::atomic<Chunk*> first;
+        /// Only used by the thread this belongs to
+        Chunk*              last;
+    };
+
+    struct TraceRegistry
+    {
+        std::mutex                           mutex;
+        std::vector<ThreadTrace*>            threads;
+        std::optional<std::filesystem::path> output;
+        std::int64_t                         started_at;
+    };
+
+    /// Leaked along with every ThreadTrace and Chunk, zones outlive the
+    /// threads that recorded them and threads may record during static
+    /// destruction
+    TraceRegistry& getTraceRegistry()
+    {
+        static TraceRegistry* registry = new TraceRegistry { // NOLINT
+            .mutex {},
+            .threads {},
+            .output {std::nullopt},
+            .started_at {0}};
+
+        return *registry;
+    }
+
+    Chunk* createChunk()
+    {
+        return new Chunk {.zones {}, .size {0}, .next {nullptr}}; // NOLINT
+    }
+
+    thread_local ThreadTrace* currentThreadTrace {nullptr};
+
+    ThreadTrace& getThreadTrace()
+    {
+        if (currentThreadTrace == nullptr)
+        {
+            TraceRegistry& registry = getTraceRegistry();
+
+            std::unique_lock lock {registry.mutex};
+
+            currentThreadTrace = new ThreadTrace { // NOLINT
+                .id {registry.threads.size()},
+                .name {},
+                .first {nullptr},
+                .last {nullptr}};
+
+            registry.threads.push_back(currentThreadTrace);
+        }
+
+        return *currentThreadTrace;
+    }
+
+    void appendEscaped(std::string& output, std::string_view string)
+    {
+        for (char c : string)
+        {
+            if (c == '"' || c == '\\')
+            {
+                output.push_back('\\');
+                output.push_back(c);
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                fmt::format_to(
+                    std::back_inserter(output),
+                    "\\u{:04x}",
+                    static_cast<unsigned>(c));
+            }
+            else
+            {
+                output.push_back(c);
+            }
+        }
+    }
+} // namespace
+
+void util::detail::recordZone(
+    const char* name, std::int64_t begin, std::int64_t end)
+{
+    ThreadTrace& trace = getThreadTrace();
+
+    Chunk* chunk = trace.last;
+
+    if (chunk == nullptr)
+    {
+        chunk = createChunk();
+
+        trace.first.store(chunk, std::memory_order_release);
+        trace.last = chunk;
+    }
+    else if (chunk->size.load(std::memory_order_relaxed) == Chunk::Capacity)
+    {
+        Chunk* next = createChunk();
+
+        chunk->next.store(next, std::memory_order_release);
+        trace.last = next;
+
+        chunk = next;
+    }
+
+    const std::size_t index = chunk->size.load(std::memory_order_relaxed);
+
+    chunk->zones[index] = Zone {.name {name}, .begin {begin}, .end {end}};
+    chunk->size.store(index + 1, std::memory_order_release);
+}
+
+void util::startTracing(std::filesystem::path output)
+{
+#if MANGO_TRACING
+    TraceRegistry& registry = getTraceRegistry();
+
+    std::unique_lock lock {registry.mutex};
+
+    registry.output     = std::move(output);
+    registry.started_at = detail::getTraceTimestamp();
+
+    detail::isTracing.store(true);
+#else
+    util::logWarn(
+        "Not tracing to {}, built with MANGO_TRACING=0", output.string());
+#endif // MANGO_TRACING
+}
+
+void util::finishTracing()
+{
+    detail::isTracing.store(false);
+
+    TraceRegistry& registry = getTraceRegistry();
+
+    std::unique_lock lock {registry.mutex};
+
+    if (!registry.output.has_value())
+    {
+        return;
+    }
+
+    const std::filesystem::path path = *std::exchange(registry.output, {});
+
+    std::ofstream file {path, std::ios::binary};
+
+    if (!file)
+    {
+        util::logWarn("Failed to open {} for the trace", path.string());
+
+        return;
+    }
+
+    // Written out in pieces, a trace can have millions of zones
+    constexpr std::size_t FlushSize {1024 * 1024};
+
+    std::string output {};
+    std::size_t numberOfZones {0};
+    bool        isFirstEvent {true};
+
+    output.reserve(FlushSize + 256);
+    output += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    const auto flush = [&]
+    {
+        file.write(output.data(), static_cast<std::streamsize>(output.size()));
+        output.clear();
+    };
+
+    const auto beginEvent = [&]
+    {
+        if (output.size() > FlushSize)
+        {
+            flush();
+        }
+
+        if (!std::exchange(isFirstEvent, false))
+        {
+            output += ",\n";
+        }
+    };
+
+    for (const ThreadTrace* trace : registry.threads)
+    {
+        if (!trace->name.empty())
+        {
+            beginEvent();
+
+            fmt::format_to(
+                std::back_inserter(output),
+                "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+                "\"tid\":{},\"args\":{{\"name\":\"",
+                trace->id);
+            appendEscaped(output, trace->name);
+            output += "\"}}";
+        }
+
+        const Chunk* chunk = trace->first.load(std::memory_order_acquire);
+
+        while (chunk != nullptr)
+        {
+            const std::size_t size =
+                chunk->size.load(std::memory_order_acquire);
+
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                const Zone& zone = chunk->zones[i];
+
+                // Left over from an earlier session
+                if (zone.begin < registry.started_at)
+                {
+                    continue;
+                }
+
+                beginEvent();
+
+                // Chrome trace event timestamps are in microseconds
+                output += "{\"name\":\"";
+                appendEscaped(output, zone.name);
+                fmt::format_to(
+                    std::back_inserter(output),
+                    "\",\"ph\":\"X\",\"pid\":0,\"tid\":{},\"ts\":{:.3f},"
+                    "\"dur\":{:.3f}}}",
+                    trace->id,
+                    static_cast<double>(zone.begin - registry.started_at)
+                        / 1000.0,
+                    static_cast<double>(zone.end - zone.begin) / 1000.0);
+
+                ++numberOfZones;
+            }
+
+            chunk = chunk->next.load(std::memory_order_acquire);
+        }
+    }
+
+    output += "\n]}\n";
+    flush();
+
+    util::logLog("Wrote {} trace zones to {}", numberOfZones, path.string());
+}
+
+void util::setTraceThreadName(std::string name)
+{
+    ThreadTrace& trace = getThreadTrace();
+
+    TraceRegistry& registry = getTraceRegistry();
+
+    std::unique_lock lock {registry.mutex};
+
+    trace.name = std::move(name);
+}
@@ -0,0 +1,96 @@
+#ifndef SRC_UTIL_TRACE_HPP
+#define SRC_UTIL_TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// Scoped timing zones that can be viewed in chrome://tracing or Perfetto
+//
+// Zones are recorded into a buffer owned by the thread that ran them, so
+// recording never takes a lock. Outside of startTracing and finishTracing a
+// zone costs a single relaxed load, with MANGO_TRACING=0 they compile to
+// nothing at all.
+
+#ifndef MANGO_TRACING
+#define MANGO_TRACING 1
+#endif // MANGO_TRACING
+
+namespace util
+{
+    namespace detail
+    {
+        inline std::atomic<bool> isTracing {false};
+
+        /// Nanoseconds since the epoch of the steady clock, never 0
+        inline std::int64_t getTraceTimestamp()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        }
+
+        void recordZone(const char* name, std::int64_t begin, std::int64_t end);
+    } // namespace detail
+
+#if MANGO_TRACING
+    /// Records the time between its construction and destruction under name,
+    /// which must have static storage duration
+    class TraceZone
+    {
+    public:
+        explicit TraceZone(const char* name_) noexcept
+            : name {name_}
+            , begin {
+                  detail::isTracing.load(std::memory_order_relaxed)
+                      ? detail::getTraceTimestamp()
+                      : 0}
+        {}
+        ~TraceZone()
+        {
+            if (this->begin != 0)
+            {
+                detail::recordZone(
+                    this->name, this->begin, detail::getTraceTimestamp());
+            }
+        }
+
+        TraceZone(const TraceZone&)             = delete;
+        TraceZone(TraceZone&&)                  = delete;
+        TraceZone& operator= (const TraceZone&) = delete;
+        TraceZone& operator= (TraceZone&&)      = delete;
+
+    private:
+        const char*  name;
+        /// 0 when this zone isn't being recorded
+        std::int64_t begin;
+    };
+#else
+    class TraceZone
+    {
+    public:
+        explicit constexpr TraceZone(const char*) noexcept {}
+        ~TraceZone() = default;
+
+        TraceZone(const TraceZone&)             = delete;
+        TraceZone(TraceZone&&)                  = delete;
+        TraceZone& operator= (const TraceZone&) = delete;
+        TraceZone& operator= (TraceZone&&)      = delete;
+    };
+#endif // MANGO_TRACING
+
+    /// Zones are recorded from here until finishTracing, which writes them
+    /// to output
+    void startTracing(std::filesystem::path output);
+
+    /// Writes every zone recorded since startTracing as Chrome trace event
+    /// JSON, does nothing if tracing wasn't started
+    void finishTracing();
+
+    /// Shown instead of the thread's id when viewing the trace
+    void setTraceThreadName(std::string);
+} // namespace util
+
+#endif // SRC_UTIL_TRACE_HPP
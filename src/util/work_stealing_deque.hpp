@@ -0,0 +1,207 @@
+#ifndef SRC_UTIL_WORK__STEALING__DEQUE_HPP
+#define SRC_UTIL_WORK__STEALING__DEQUE_HPP
+
+#include "cache_line.hpp"
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace util
+{
+    /// Chase-Lev work stealing deque
+    ///
+    /// One thread, the owner, pushes and pops at the bottom while any number
+    /// of other threads steal from the top. Uses the memory orderings from
+    /// "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê et
+    /// al. 2013). The buffer grows as required, old buffers are kept alive
+    /// until the deque is destroyed as a concurrent steal may still be reading
+    /// from them.
+    template<class T>
+        requires std::is_trivially_copyable_v<T>
+    class WorkStealingDeque
+    {
+    public:
+        explicit WorkStealingDeque(std::size_t initialCapacity = 256)
+            : top {0}
+            , bottom {0}
+            , array {nullptr}
+            , retired_arrays {}
+        {
+            this->retired_arrays.push_back(
+                std::make_unique<Array>(std::bit_ceil(initialCapacity)));
+
+            this->array.store(this->retired_arrays.back().get());
+        }
+        ~WorkStealingDeque() = default;
+
+        WorkStealingDeque(const WorkStealingDeque&)             = delete;
+        WorkStealingDeque(WorkStealingDeque&&)                  = delete;
+        WorkStealingDeque& operator= (const WorkStealingDeque&) = delete;
+        WorkStealingDeque& operator= (WorkStealingDeque&&)      = delete;
+
+        /// Owner only
+        void push(T element)
+        {
+            const std::int64_t b = this->bottom.load(std::memory_order_relaxed);
+            const std::int64_t t = this->top.load(std::memory_order_acquire);
+            Array*             a = this->array.load(std::memory_order_relaxed);
+
+            if (b - t > a->capacity - 1)
+            {
+                a = this->grow(a, b, t);
+            }
+
+            a->store(b, element);
+
+            std::atomic_thread_fence(std::memory_order_release);
+
+            this->bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        /// Owner only, takes the most recently pushed element
+        std::optional<T> pop()
+        {
+            const std::int64_t b =
+                this->bottom.load(std::memory_order_relaxed) - 1;
+            Array* a = this->array.load(std::memory_order_relaxed);
+
+            this->bottom.store(b, std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            std::int64_t t = this->top.load(std::memory_order_relaxed);
+
+            if (t > b)
+            {
+                // Empty
+                this->bottom.store(b + 1, std::memory_order_relaxed);
+
+                return std::nullopt;
+            }
+
+            std::optional<T> output {a->load(b)};
+
+            if (t == b)
+            {
+                // Last element, race any thieves for it
+                if (!this->top.compare_exchange_strong(
+                        t,
+                        t + 1,
+                        std::memory_order_seq_cst,
+                        std::memory_order_relaxed))
+                {
+                    output = std::nullopt;
+                }
+
+                this->bottom.store(b + 1, std::memory_order_relaxed);
+            }
+
+            return output;
+        }
+
+        /// Any thread, takes the least recently pushed element
+        ///
+        /// Spuriously returns std::nullopt if another thread won the race for
+        /// the same element.
+        std::optional<T> steal()
+        {
+            std::int64_t t = this->top.load(std::memory_order_acquire);
+
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            const std::int64_t b = this->bottom.load(std::memory_order_acquire);
+
+            if (t >= b)
+            {
+                return std::nullopt;
+            }
+
+            Array* a = this->array.load(std::memory_order_acquire);
+
+            const T output = a->load(t);
+
+            if (!this->top.compare_exchange_strong(
+                    t,
+                    t + 1,
+                    std::memory_order_seq_cst,
+                    std::memory_order_relaxed))
+            {
+                return std::nullopt;
+            }
+
+            return output;
+        }
+
+        /// Only a snapshot, may be stale by the time it's returned
+        [[nodiscard]] std::size_t size() const
+        {
+            const std::int64_t b = this->bottom.load(std::memory_order_relaxed);
+            const std::int64_t t = this->top.load(std::memory_order_relaxed);
+
+            return b > t ? static_cast<std::size_t>(b - t) : 0;
+        }
+
+        [[nodiscard]] bool empty() const
+        {
+            return this->size() == 0;
+        }
+
+    private:
+        struct Array
+        {
+            explicit Array(std::size_t capacity_)
+                : capacity {static_cast<std::int64_t>(capacity_)}
+                , buffer {std::make_unique<std::atomic<T>[]>(capacity_)}
+            {}
+
+            T load(std::int64_t index) const
+            {
+                return this->buffer[static_cast<std::size_t>(
+                                        index & (this->capacity - 1))]
+                    .load(std::memory_order_relaxed);
+            }
+
+            void store(std::int64_t index, T t)
+            {
+                this->buffer[static_cast<std::size_t>(
+                                 index & (this->capacity - 1))]
+                    .store(t, std::memory_order_relaxed);
+            }
+
+            std::int64_t                      capacity;
+            std::unique_ptr<std::atomic<T>[]> buffer;
+        };
+
+        Array* grow(Array* old, std::int64_t b, std::int64_t t)
+        {
+            std::unique_ptr<Array> grown = std::make_unique<Array>(
+                static_cast<std::size_t>(old->capacity) * 2);
+
+            for (std::int64_t i = t; i < b; ++i)
+            {
+                grown->store(i, old->load(i));
+            }
+
+            Array* output = grown.get();
+
+            this->retired_arrays.push_back(std::move(grown));
+            this->array.store(output, std::memory_order_release);
+
+            return output;
+        }
+
+        // top and bottom are written by different threads
+        alignas(CacheLineSize) std::atomic<std::int64_t> top;
+        alignas(CacheLineSize) std::atomic<std::int64_t> bottom;
+        alignas(CacheLineSize) std::atomic<Array*> array;
+
+        // Owner only
+        std::vector<std::unique_ptr<Array>> retired_arrays;
+    };
+} // namespace util
+
+#endif // SRC_UTIL_WORK__STEALING__DEQUE_HPP